@@ -1,3 +1,7 @@
+#define VERTEX_INPUT_POSITION_ONLY 1
+
+#include "worldVertexInput.hlsl"
+
 cbuffer cbPerObject : register(b1)
 {
 	float4x4 worldViewMatrix;
@@ -5,10 +9,6 @@ cbuffer cbPerObject : register(b1)
 	float4x4 projectionMatrix;
 };
 
-struct VS_IN
-{
-    float4 position : POSITION;
-};
 
 struct VS_OUT
 {
@@ -18,7 +18,7 @@ struct VS_OUT
 VS_OUT VS_Main(VS_IN input)
 {
 	VS_OUT output;
-	float4 viewPosition = mul(input.position, worldViewMatrix);
+	float4 viewPosition = mul(unpackPosition(input), worldViewMatrix);
 	output.position = mul(viewPosition, projectionMatrix);
 	return output;
 }
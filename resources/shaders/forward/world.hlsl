@@ -1,12 +1,6 @@
 #include "worldCommon.hlsl"
 #include "worldVertexInput.hlsl"
 
-struct StaticInstanceFeatures
-{
-    float3 dirLight;
-};
-StructuredBuffer<StaticInstanceFeatures> staticInstances : register(t2); // TODO all SRV should use t register type, including PS SRVs
-
 //--------------------------------------------------------------------------------------
 // Vertex Shader
 //--------------------------------------------------------------------------------------
@@ -53,7 +47,7 @@ float3 RescaleOntoAmbient(float3 light, float3 ambientLight, float max = 1)
 VS_OUT VS_Main(VS_IN input)
 {
     VS_OUT output;
-    float4 viewPosition = mul(input.position, worldViewMatrix);
+    float4 viewPosition = mul(unpackPosition(input), worldViewMatrix);
 
     // TODO doing light calculation in view space results in flickering,
     // so until we know whats going wrong just do it in world space.
@@ -122,7 +116,7 @@ VS_OUT VS_Main(VS_IN input)
     output.distance = length(viewPosition);
     
     output.uvTexColor = unpackUvTexColor(input);
-    output.iTexColor = input.iTexColor;
+    output.iTexColor = unpackTexIndexColor(input);
     output.uvTexLightmap = uviTexLightmap.xy;
     output.iTexLightmap = lightType == LIGHT_WORLD_LIGHTMAP ? uviTexLightmap.z : -1;
    
@@ -20,12 +20,12 @@ struct VS_OUT
 VS_OUT VS_Main(VS_IN input)
 {
     VS_OUT output;
-    float4 viewPosition = mul(input.position, worldViewMatrix);
+    float4 viewPosition = mul(unpackPosition(input), worldViewMatrix);
     
     output.position = mul(viewPosition, projectionMatrix);
     output.distance = length(viewPosition);
     output.uvTexColor = unpackUvTexColor(input);
-    output.iTexColor = input.iTexColor;
+    output.iTexColor = unpackTexIndexColor(input);
 	return output;
 }
 
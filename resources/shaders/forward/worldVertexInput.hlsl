@@ -1,9 +1,19 @@
-// see VertexPacker.cpp for packed format description
+// see VertexPacker.cpp for packed and compact format description
+
+// VERTEX_INPUT_POSITION_ONLY implies VERTEX_INPUT_LIGHT_DISABLED
+#if VERTEX_INPUT_POSITION_ONLY
+#define VERTEX_INPUT_LIGHT_DISABLED 1
+#endif
 
 struct VS_IN
 {
+#if VERTEX_INPUT_COMPACT
+    uint2 position : POSITION;
+#else
     float4 position : POSITION;
+#endif
     
+#if !VERTEX_INPUT_POSITION_ONLY
 #if VERTEX_INPUT_RAW 
     float4 normal : NORMAL0;
 #else
@@ -16,14 +26,17 @@ struct VS_IN
     uint uvTexColor : TEXCOORD0;
 #endif
     
-    uint iTexColor : INDEX0;
+    uint vertexId : SV_VertexID;
+#endif
 
 #if !VERTEX_INPUT_LIGHT_DISABLED
 #if VERTEX_INPUT_RAW
     float3 colLight : COLOR0;
-    uint instanceId : INDEX1;
+    uint instanceId : INDEX0;
     float3 uviTexLightmap : TEXCOORD1;
     uint lightType : OTHER0;
+#elif VERTEX_INPUT_COMPACT
+    uint light : OTHER0;
 #else
     uint lightFirst : OTHER0;
     uint lightSecond : OTHER1;
@@ -31,6 +44,28 @@ struct VS_IN
 #endif
 };
 
+#if VERTEX_INPUT_COMPACT
+struct ClusterBounds
+{
+    float3 posMin;
+    float3 posScale;
+};
+StructuredBuffer<ClusterBounds> clusterBounds : register(t3);
+#endif
+
+float4 unpackPosition(VS_IN input)
+{
+#if VERTEX_INPUT_COMPACT
+    uint3 posQuant = uint3(input.position.x & 0xFFFF, input.position.x >> 16, input.position.y & 0xFFFF);
+    ClusterBounds bounds = clusterBounds[input.position.y >> 16];
+    return float4(bounds.posMin + posQuant * bounds.posScale, 1);
+#else
+    return input.position;
+#endif
+}
+
+#if !VERTEX_INPUT_POSITION_ONLY
+
 static const uint LIGHT_WORLD_COLOR = 0;
 static const uint LIGHT_WORLD_LIGHTMAP = 1;
 static const uint LIGHT_OBJECT_COLOR = 2;
@@ -40,6 +75,15 @@ float3 unpackNormal(VS_IN input)
 {
 #if VERTEX_INPUT_RAW
     return input.normal.xyz;
+#elif VERTEX_INPUT_COMPACT
+    // octahedral mapping with y as hemisphere axis, sign-extend 16 bit x and z
+    float x = max((float) ((int) (input.normal << 16) >> 16) / 32767.f, -1.f);
+    float z = max((float) ((int) input.normal >> 16) / 32767.f, -1.f);
+    float3 normal = float3(x, 1.f - abs(x) - abs(z), z);
+    float unfold = saturate(-normal.y);
+    normal.x += normal.x >= 0.f ? -unfold : unfold;
+    normal.z += normal.z >= 0.f ? -unfold : unfold;
+    return normalize(normal);
 #else
     static const uint normalComponentBits = 14;
     static const uint normalComponentMask = (1 << normalComponentBits) - 1;
@@ -89,6 +133,43 @@ float2 unpackUv(uint packed)
     return uvNorm * (factor / scale);
 }
 
+struct TexIndexRange
+{
+    uint vertStart;
+    uint texIndex;
+};
+StructuredBuffer<TexIndexRange> texIndexRanges : register(t4);
+StructuredBuffer<uint> texIndexBuckets : register(t5);
+
+static const uint texIndexBucketVertCountBits = 6;
+static const uint texIndexBucketUniform = 0x80000000;
+
+cbuffer cbDrawBaseVertex : register(b6)
+{
+    uint baseVertex;
+}
+
+// Bucket of the vertex either stores the texture index directly (bucket only contains a single range) or the first range
+// overlapping the bucket, from where the last range starting at or before this vertex is found by scanning forward.
+// For indexed draws, SV_VertexID is the index value and does not include the base vertex of the draw, so it is added
+// here (always 0 for non-indexed draws, where SV_VertexID already includes the start vertex).
+uint unpackTexIndexColor(VS_IN input)
+{
+    uint vertIndex = input.vertexId + baseVertex;
+    uint bucket = texIndexBuckets[vertIndex >> texIndexBucketVertCountBits];
+    if (bucket & texIndexBucketUniform) {
+        return bucket & ~texIndexBucketUniform;
+    }
+    uint count, stride;
+    texIndexRanges.GetDimensions(count, stride);
+    uint rangeIndex = bucket;
+    [loop]
+    while (rangeIndex + 1 < count && texIndexRanges[rangeIndex + 1].vertStart <= vertIndex) {
+        rangeIndex++;
+    }
+    return texIndexRanges[rangeIndex].texIndex;
+}
+
 float2 unpackUvTexColor(VS_IN input)
 {
 #if VERTEX_INPUT_RAW
@@ -98,17 +179,35 @@ float2 unpackUvTexColor(VS_IN input)
 #endif
 }
 
+#endif
+
 #if !VERTEX_INPUT_LIGHT_DISABLED
 
-static const uint instanceIdBits = 14;
+struct StaticInstanceFeatures
+{
+    float3 dirLight;
+    float3 colLight;
+};
+StructuredBuffer<StaticInstanceFeatures> staticInstances : register(t2); // TODO all SRV should use t register type, including PS SRVs
+
+static const uint instanceIdBits = 30;
 static const uint instanceIdMask = (1 << instanceIdBits) - 1;
+static const uint instanceIdNone = 0xFFFFFFFF;
 static const uint lightComponentBits = 16;
 static const uint lightComponentMask = (1 << lightComponentBits) - 1;
 
+static const uint lightmapIndexBitsCompact = 8;
+static const uint lightmapUvBitsCompact = 11;
+static const uint lightmapUvMaskCompact = (1 << lightmapUvBitsCompact) - 1;
+static const uint lightColorBitsCompact = 10;
+static const uint lightColorMaskCompact = (1 << lightColorBitsCompact) - 1;
+
 uint unpackLightType(VS_IN input)
 {
 #if VERTEX_INPUT_RAW
     return input.lightType;
+#elif VERTEX_INPUT_COMPACT
+    return (input.light >> 30);
 #else
     return (input.lightFirst >> 30);
 #endif
@@ -118,15 +217,33 @@ uint unpackInstanceId(VS_IN input)
 {
 #if VERTEX_INPUT_RAW
     return input.instanceId;
+#elif VERTEX_INPUT_COMPACT
+    return unpackLightType(input) == LIGHT_OBJECT_COLOR ? input.light & instanceIdMask : instanceIdNone;
 #else
-    return (input.lightFirst >> 16) & instanceIdMask;
+    return unpackLightType(input) == LIGHT_OBJECT_COLOR ? input.lightFirst & instanceIdMask : instanceIdNone;
 #endif
 }
 
 float3 unpackColLight(VS_IN input)
 {
+    // object light color is stored per instance for all formats
+    if (unpackLightType(input) == LIGHT_OBJECT_COLOR) {
+        return staticInstances[unpackInstanceId(input)].colLight;
+    }
 #if VERTEX_INPUT_RAW
     return input.colLight;
+#elif VERTEX_INPUT_COMPACT
+    uint lightType = unpackLightType(input);
+    if (lightType == LIGHT_WORLD_LIGHTMAP) {
+        return (float3) 0;
+    }
+    else {
+        return float3(
+            (input.light >> (lightColorBitsCompact * 2)) & lightColorMaskCompact,
+            (input.light >> lightColorBitsCompact) & lightColorMaskCompact,
+            input.light & lightColorMaskCompact
+        ) / (float) lightColorMaskCompact;
+    }
 #else
     static const float invMaxVal = 1.f / lightComponentMask;
     return float3(
@@ -141,6 +258,12 @@ float3 unpackUviTexLightmap(VS_IN input)
 {
 #if VERTEX_INPUT_RAW
     return input.uviTexLightmap;
+#elif VERTEX_INPUT_COMPACT
+    return float3(
+        (float) ((input.light >> lightmapUvBitsCompact) & lightmapUvMaskCompact) / lightmapUvMaskCompact,
+        (float) (input.light & lightmapUvMaskCompact) / lightmapUvMaskCompact,
+        (input.light >> (lightmapUvBitsCompact * 2)) & ((1 << lightmapIndexBitsCompact) - 1)
+    );
 #else
     return float3(
         unpackUv(input.lightSecond),
@@ -0,0 +1,85 @@
+#include "stdafx.h"
+#include "Arena.h"
+
+#include "Win.h"
+
+namespace util
+{
+	size_t alignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	Arena::Arena(size_t blockSize) : blockSize(blockSize) {}
+
+	Arena::~Arena()
+	{
+		release();
+	}
+
+	Arena::Block Arena::allocateBlock(size_t minSize)
+	{
+		Block block;
+		block.size = std::max(blockSize, minSize);
+		block.data = (std::byte*) VirtualAlloc(nullptr, block.size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+		if (block.data == nullptr) {
+			throw std::bad_alloc();
+		}
+		bytesReserved += block.size;
+		bytesPeak = std::max(bytesPeak, bytesReserved);
+		return block;
+	}
+
+	void Arena::freeBlock(Block& block)
+	{
+		VirtualFree(block.data, 0, MEM_RELEASE);
+		bytesReserved -= block.size;
+		block = {};
+	}
+
+	void* Arena::allocate(size_t bytes, size_t alignment)
+	{
+		// blocks are page-aligned, so aligning offsets is enough
+		for (; currentBlock < blocks.size(); currentBlock++) {
+			Block& block = blocks[currentBlock];
+			size_t offset = alignUp(block.used, alignment);
+			if (offset + bytes <= block.size) {
+				block.used = offset + bytes;
+				return block.data + offset;
+			}
+		}
+		blocks.push_back(allocateBlock(bytes));
+		currentBlock = blocks.size() - 1;
+		blocks.back().used = bytes;
+		return blocks.back().data;
+	}
+
+	Arena::Mark Arena::mark() const
+	{
+		if (blocks.empty()) {
+			return {};
+		}
+		return { currentBlock, blocks[currentBlock].used };
+	}
+
+	void Arena::rewind(Mark mark)
+	{
+		if (blocks.empty()) {
+			return;
+		}
+		for (size_t i = mark.blockIndex + 1; i < blocks.size(); i++) {
+			blocks[i].used = 0;
+		}
+		currentBlock = mark.blockIndex;
+		blocks[currentBlock].used = mark.used;
+	}
+
+	void Arena::release()
+	{
+		for (auto& block : blocks) {
+			freeBlock(block);
+		}
+		blocks.clear();
+		currentBlock = 0;
+	}
+}
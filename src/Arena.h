@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+
+namespace util
+{
+	// Bump allocator for short-lived loader data. Single allocations are never freed, instead all memory allocated after
+	// a mark can be rewound (memory is kept for reuse) or all memory is released at once. Not thread-safe.
+	class Arena
+	{
+	public:
+		struct Mark {
+			size_t blockIndex = 0;
+			size_t used = 0;
+		};
+
+		explicit Arena(size_t blockSize = 64 * 1024 * 1024);
+		~Arena();
+		Arena(const Arena&) = delete;
+		Arena& operator=(const Arena&) = delete;
+
+		void* allocate(size_t bytes, size_t alignment);
+
+		Mark mark() const;
+		void rewind(Mark mark);
+		void release();
+
+		size_t getBytesReserved() const { return bytesReserved; }
+		size_t getBytesPeak() const { return bytesPeak; }
+
+	private:
+		struct Block {
+			std::byte* data = nullptr;
+			size_t size = 0;
+			size_t used = 0;
+		};
+
+		Block allocateBlock(size_t minSize);
+		void freeBlock(Block& block);
+
+		const size_t blockSize;
+		std::vector<Block> blocks;// blocks after currentBlock are always unused
+		size_t currentBlock = 0;
+		size_t bytesReserved = 0;
+		size_t bytesPeak = 0;
+	};
+
+	// Rewinds arena to the state at construction when going out of scope. All containers using the arena that were
+	// created inside the scope must be destroyed before the scope ends.
+	class ArenaScope
+	{
+	public:
+		explicit ArenaScope(Arena& arena) : arena(arena), mark(arena.mark()) {}
+		~ArenaScope() { arena.rewind(mark); }
+		ArenaScope(const ArenaScope&) = delete;
+		ArenaScope& operator=(const ArenaScope&) = delete;
+	private:
+		Arena& arena;
+		const Arena::Mark mark;
+	};
+
+	template <typename T>
+	struct ArenaAllocator
+	{
+		using value_type = T;
+
+		Arena* arena;
+
+		ArenaAllocator(Arena& arena) noexcept : arena(&arena) {}
+		template <typename U>
+		ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena(other.arena) {}
+
+		T* allocate(size_t count)
+		{
+			return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T)));
+		}
+		void deallocate(T*, size_t) noexcept {}
+
+		template <typename U>
+		bool operator==(const ArenaAllocator<U>& other) const noexcept
+		{
+			return arena == other.arena;
+		}
+	};
+
+	template <typename T>
+	using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+}
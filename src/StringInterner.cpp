@@ -0,0 +1,63 @@
+#include "stdafx.h"
+#include "StringInterner.h"
+
+namespace util
+{
+	// interned strings are usually short asset names
+	const size_t arenaBlockSize = 64 * 1024;
+
+	StringInterner::StringInterner() : arena(arenaBlockSize) {}
+
+	uint32_t StringInterner::getOrCreateId(std::string_view str)
+	{
+		{
+			std::shared_lock lock(mutex);
+			auto it = ids.find(str);
+			if (it != ids.end()) {
+				return it->second;
+			}
+		}
+		std::unique_lock lock(mutex);
+		auto it = ids.find(str);// might have been inserted after releasing shared lock
+		if (it != ids.end()) {
+			return it->second;
+		}
+		char* data = (char*) arena.allocate(str.size(), alignof(char));
+		for (size_t i = 0; i < str.size(); i++) {
+			data[i] = asciiToLower(str[i]);
+		}
+		std::string_view interned(data, str.size());
+		uint32_t id = strings.size();
+		strings.push_back(interned);
+		ids.emplace(interned, id);
+		return id;
+	}
+
+	std::string_view StringInterner::intern(std::string_view str)
+	{
+		uint32_t id = getOrCreateId(str);
+		return getString(id);
+	}
+
+	std::optional<uint32_t> StringInterner::getId(std::string_view str) const
+	{
+		std::shared_lock lock(mutex);
+		auto it = ids.find(str);
+		if (it != ids.end()) {
+			return it->second;
+		}
+		return std::nullopt;
+	}
+
+	std::string_view StringInterner::getString(uint32_t id) const
+	{
+		std::shared_lock lock(mutex);
+		return strings.at(id);
+	}
+
+	uint32_t StringInterner::size() const
+	{
+		std::shared_lock lock(mutex);
+		return strings.size();
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string_view>
+#include <shared_mutex>
+
+#include "Arena.h"
+#include "Util.h"
+
+namespace util
+{
+	// Maps strings to dense IDs (starting at 0, in insertion order) and back. Strings are lowercased (ASCII) on
+	// insertion and lookups are case-insensitive, so callers do not need to normalize. Looking up or inserting a string
+	// that already exists does not allocate. Interned strings are stored in an arena and are never moved or freed, so
+	// returned views stay valid for the interners lifetime. All methods are thread-safe, lookups can run concurrently.
+	class StringInterner
+	{
+	public:
+		StringInterner();
+		StringInterner(const StringInterner&) = delete;
+		StringInterner& operator=(const StringInterner&) = delete;
+
+		uint32_t getOrCreateId(std::string_view str);
+		std::optional<uint32_t> getId(std::string_view str) const;
+		std::string_view getString(uint32_t id) const;
+		// returns interned lowercase copy of given string
+		std::string_view intern(std::string_view str);
+		uint32_t size() const;
+
+	private:
+		mutable std::shared_mutex mutex;
+		Arena arena;
+		std::unordered_map<std::string_view, uint32_t, CaseInsensitiveHash, CaseInsensitiveEqual> ids;// keys point into arena
+		std::vector<std::string_view> strings;// indexed by ID
+	};
+}
@@ -65,6 +65,35 @@ namespace util
 		return result;
 	}
 
+	char asciiToLower(char c)
+	{
+		return (c >= 'A' && c <= 'Z') ? (c + ('a' - 'A')) : c;
+	}
+
+	size_t CaseInsensitiveHash::operator()(std::string_view str) const
+	{
+		// FNV-1a
+		uint64_t hash = 14695981039346656037ull;
+		for (char c : str) {
+			hash ^= (uint8_t) asciiToLower(c);
+			hash *= 1099511628211ull;
+		}
+		return (size_t) hash;
+	}
+
+	bool CaseInsensitiveEqual::operator()(std::string_view lhs, std::string_view rhs) const
+	{
+		if (lhs.size() != rhs.size()) {
+			return false;
+		}
+		for (size_t i = 0; i < lhs.size(); i++) {
+			if (asciiToLower(lhs[i]) != asciiToLower(rhs[i])) {
+				return false;
+			}
+		}
+		return true;
+	}
+
 	std::string leftPad(const std::string& string, const uint32_t count, const char paddingChar)
 	{
 		std::string result = string;
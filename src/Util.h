@@ -13,6 +13,7 @@ namespace util
 	bool startsWith(const std::string_view str, const std::string_view prefix);
 	void asciiToLowerMut(std::string& str);
 	std::string asciiToLower(const std::string_view str);
+	char asciiToLower(char c);
 
 	std::string leftPad(const std::string& string, const uint32_t count, const char paddingChar = ' ');
 	std::string join(const std::vector<std::string> strings, const std::string& delimiter);
@@ -47,6 +48,19 @@ namespace util
 		hash ^= hasher(value) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
 	}
 
+	// Transparent ASCII case-insensitive hash and equality, allows looking up string keys by string_view without allocating.
+	struct CaseInsensitiveHash {
+		using is_transparent = void;
+		size_t operator()(std::string_view str) const;
+	};
+	struct CaseInsensitiveEqual {
+		using is_transparent = void;
+		bool operator()(std::string_view lhs, std::string_view rhs) const;
+	};
+
+	template<typename Value>
+	using CaseInsensitiveMap = std::unordered_map<std::string, Value, CaseInsensitiveHash, CaseInsensitiveEqual>;
+
 	void throwError(const std::string& message);
 
 	template<typename Item>
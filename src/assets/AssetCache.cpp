@@ -2,8 +2,11 @@
 #include "AssetCache.h"
 
 #include "Util.h"
+#include "StringInterner.h"
 
 #include <limits>
+#include <list>
+#include <mutex>
 
 namespace assets
 {
@@ -15,17 +18,53 @@ namespace assets
 	using ::std::unordered_map;
 	using ::util::createOrGet;
 
-	unordered_map<string, MultiResolutionMesh> cacheMrm;
-	unordered_map<string, ModelHierarchy> cacheMdh;
-	unordered_map<string, ModelMesh> cacheMdm;
-	unordered_map<string, Model> cacheMdl;
+	// Parsed assets of all types share a single LRU list and byte budget, so that a single big model type can evict the others.
+	// Cached byte sizes are estimated from the source file size, which is close enough to the parsed size for budgeting.
+	// Levels can be loaded on the main and preload thread at the same time, so all cache state is guarded by cacheMutex.
+	// Assets are parsed without holding the lock.
+	// Every level holds one reference to each asset it uses, so that models shared between levels are not parsed again
+	// when switching. When over budget, unreferenced entries are evicted first, then referenced ones, least recently used first.
 
-	vector<string> cacheNames;
-	unordered_map<int32_t, uint32_t> nameHashToId;
-	vector<uint32_t> texIdToNameIndex;
+	struct CacheEntry {
+		const string name;
+		const uint64_t bytes;
+		uint32_t pinCount = 0;
+		uint32_t levelRefCount = 0;
+
+		CacheEntry(const string& name, uint64_t bytes) : name(name), bytes(bytes) {}
+		virtual ~CacheEntry() = default;
+		virtual void eraseFromIndex() = 0;
+	};
+
+	template<HAS_LOAD T>
+	struct CacheEntryTyped;
+
+	using LruList = std::list<std::unique_ptr<CacheEntry>>;// front is most recently used
+
+	template<HAS_LOAD T>
+	using CacheIndex = unordered_map<string, LruList::iterator>;
+
+	std::mutex cacheMutex;
+	LruList lru;
+	CacheIndex<MultiResolutionMesh> cacheMrm;
+	CacheIndex<ModelHierarchy> cacheMdh;
+	CacheIndex<ModelMesh> cacheMdm;
+	CacheIndex<Model> cacheMdl;
+
+	uint64_t budgetBytes = assetCacheBudgetDefault;
+	AssetCacheStats stats;
+
+	// pin scopes are owned by the thread that created them, entries pinned by any thread are never evicted
+	thread_local vector<vector<CacheEntry*>> pinScopes;
+
+	unordered_map<string, std::unordered_set<CacheEntry*>> levelToEntries;
+	thread_local string loadingLevel;// set by level scope, empty if none
+
+	util::StringInterner texNames;
+	util::StringInterner visualNames;
 
 	template<HAS_LOAD T>
-	unordered_map<string, T>& getCache() {
+	CacheIndex<T>& getCache() {
 		if constexpr (std::is_same_v<T, MultiResolutionMesh>) {
 			return cacheMrm;
 		}
@@ -41,57 +80,203 @@ namespace assets
 	}
 
 	template<HAS_LOAD T>
-	std::optional<const T*> getOrParse(const string& assetName)
+	struct CacheEntryTyped : public CacheEntry {
+		T asset;
+
+		CacheEntryTyped(const string& name, uint64_t bytes) : CacheEntry(name, bytes) {}
+		void eraseFromIndex() override {
+			getCache<T>().erase(name);
+		}
+	};
+
+	// requires cacheMutex
+	void evictUntilWithinBudget(const CacheEntry* keep = nullptr)
 	{
-		auto& cache = getCache<T>();
-		auto it = cache.find(assetName);
-		if (it == cache.end()) {
-			cacheMrm.clear();// right now we only cache at most one model per type
-
-			const auto& assetFileOpt = assets::getIfExists(assetName);
-			if (assetFileOpt.has_value()) {
-				auto [itNew, wasInserted] = cache.try_emplace(assetName);
-				auto visualData = assets::getData(assetFileOpt.value());
-				auto read = zenkit::Read::from(visualData.data, visualData.size);
-				itNew->second.load(read.get());
-				return &itNew->second;
+		// keep is the entry just returned by getOrParse, which must stay valid even if no pin scope is active
+		for (bool evictReferenced : { false, true }) {
+			auto it = lru.end();
+			while (stats.bytesCurrent > budgetBytes && it != lru.begin()) {
+				--it;
+				CacheEntry& entry = **it;
+				if (entry.pinCount > 0 || &entry == keep || (entry.levelRefCount > 0 && !evictReferenced)) {
+					continue;
+				}
+				if (entry.levelRefCount > 0) {
+					for (auto& [level, entries] : levelToEntries) {
+						entries.erase(&entry);
+					}
+				}
+				stats.bytesCurrent -= entry.bytes;
+				stats.evictions++;
+				entry.eraseFromIndex();
+				it = lru.erase(it);
 			}
-			else {
-				return std::nullopt;
+		}
+	}
+
+	// requires cacheMutex
+	void referenceIfLevelScopeActive(CacheEntry& entry)
+	{
+		if (!loadingLevel.empty()) {
+			auto [_, wasReferenced] = levelToEntries[loadingLevel].insert(&entry);
+			if (wasReferenced) {
+				entry.levelRefCount++;
 			}
 		}
-		else {
-			return &it->second;
+	}
+
+	// requires cacheMutex
+	void pinIfScopeActive(CacheEntry& entry)
+	{
+		if (!pinScopes.empty()) {
+			entry.pinCount++;
+			pinScopes.back().push_back(&entry);
 		}
 	}
 
-	template std::optional<const MultiResolutionMesh*> getOrParse(const string& assetName);
-	template std::optional<const ModelHierarchy*> getOrParse(const string& assetName);
-	template std::optional<const ModelMesh*> getOrParse(const string& assetName);
-	template std::optional<const Model*> getOrParse(const string& assetName);
+	AssetCachePinScope::AssetCachePinScope()
+	{
+		pinScopes.emplace_back();
+	}
 
+	AssetCachePinScope::~AssetCachePinScope()
+	{
+		std::scoped_lock lock(cacheMutex);
+		for (CacheEntry* entry : pinScopes.back()) {
+			entry->pinCount--;
+		}
+		pinScopes.pop_back();
+		evictUntilWithinBudget();
+	}
 
-	template <typename T, vector<uint32_t>& idToName>
-	T getOrCreateId(const std::string& name) {
-		std::hash<string> stringHasher;
-		int32_t nameHash = stringHasher(name);
+	AssetCacheLevelScope::AssetCacheLevelScope(const string& level)
+	{
+		assert(loadingLevel.empty());
+		loadingLevel = level;
+	}
 
-		uint32_t nextId = idToName.size();
-		auto [it, wasInserted] = nameHashToId.try_emplace(nameHash, nextId);
-		if (wasInserted) {
-			assert(nextId <= std::numeric_limits<TexId>::max());
-			uint32_t nextNameIndex = cacheNames.size();
-			idToName.push_back(nextNameIndex);
-			cacheNames.push_back(name);
+	AssetCacheLevelScope::~AssetCacheLevelScope()
+	{
+		loadingLevel.clear();
+	}
+
+	void releaseAssetCacheLevel(const string& level)
+	{
+		std::scoped_lock lock(cacheMutex);
+		auto it = levelToEntries.find(level);
+		if (it == levelToEntries.end()) {
+			return;
+		}
+		for (CacheEntry* entry : it->second) {
+			entry->levelRefCount--;
 		}
-		return (TexId) it->second;
+		levelToEntries.erase(it);
+		evictUntilWithinBudget();
 	}
 
-	// TODO this should probably also lowercase everything, not callers
-	TexId getTexId(const std::string& texName) {
-		return getOrCreateId<TexId, texIdToNameIndex>(texName);
+	// requires cacheMutex
+	template<HAS_LOAD T>
+	const T* useEntry(LruList::iterator lruIt)
+	{
+		lru.splice(lru.begin(), lru, lruIt);// iterators stay valid
+		auto& entry = static_cast<CacheEntryTyped<T>&>(**lruIt);
+		pinIfScopeActive(entry);
+		referenceIfLevelScopeActive(entry);
+		return &entry.asset;
+	}
+
+	template<HAS_LOAD T>
+	std::optional<const T*> getOrParse(const string& assetName)
+	{
+		{
+			std::scoped_lock lock(cacheMutex);
+			auto& cache = getCache<T>();
+			auto it = cache.find(assetName);
+			if (it != cache.end()) {
+				stats.hits++;
+				return useEntry<T>(it->second);
+			}
+		}
+
+		const auto& assetFileOpt = assets::getIfExists(assetName);
+		if (!assetFileOpt.has_value()) {
+			return std::nullopt;
+		}
+
+		auto visualData = assets::getData(assetFileOpt.value());
+		auto entryPtr = std::make_unique<CacheEntryTyped<T>>(assetName, visualData.size);
+		auto read = zenkit::Read::from(visualData.data, visualData.size);
+		entryPtr->asset.load(read.get());
+
+		std::scoped_lock lock(cacheMutex);
+		stats.misses++;
+		auto& cache = getCache<T>();
+		auto [it, wasInserted] = cache.try_emplace(assetName);
+		if (!wasInserted) {
+			// parsed by another thread in the meantime, that result is used so that all pointers stay valid
+			return useEntry<T>(it->second);
+		}
+		auto& entry = *entryPtr;
+		lru.push_front(std::move(entryPtr));
+		it->second = lru.begin();
+		stats.bytesCurrent += entry.bytes;
+		stats.bytesPeak = std::max(stats.bytesPeak, stats.bytesCurrent);
+
+		pinIfScopeActive(entry);
+		referenceIfLevelScopeActive(entry);
+		evictUntilWithinBudget(&entry);
+		return &entry.asset;
+	}
+
+	void setAssetCacheBudget(uint64_t budget)
+	{
+		std::scoped_lock lock(cacheMutex);
+		budgetBytes = budget;
+		evictUntilWithinBudget();
+	}
+
+	void clearAssetCache()
+	{
+		std::scoped_lock lock(cacheMutex);
+		assert(pinScopes.empty());
+		cacheMrm.clear();
+		cacheMdh.clear();
+		cacheMdm.clear();
+		cacheMdl.clear();
+		lru.clear();
+		levelToEntries.clear();
+		stats.bytesCurrent = 0;
+	}
+
+	AssetCacheStats getAssetCacheStats()
+	{
+		std::scoped_lock lock(cacheMutex);
+		return stats;
+	}
+
+	void printAndResetAssetCacheStats()
+	{
+		std::scoped_lock lock(cacheMutex);
+		LOG(INFO) << "Asset Cache: " << stats.hits << " hits, " << stats.misses << " misses, " << stats.evictions << " evictions";
+		LOG(INFO) << "Asset Cache: " << (stats.bytesCurrent / 1024) << " KB used, " << (stats.bytesPeak / 1024) << " KB peak, "
+			<< (budgetBytes / 1024) << " KB budget";
+		stats = { .bytesCurrent = stats.bytesCurrent, .bytesPeak = stats.bytesCurrent };
+	}
+
+	template std::optional<const MultiResolutionMesh*> getOrParse(const string& assetName);
+	template std::optional<const ModelHierarchy*> getOrParse(const string& assetName);
+	template std::optional<const ModelMesh*> getOrParse(const string& assetName);
+	template std::optional<const Model*> getOrParse(const string& assetName);
+
+
+	TexId getTexId(std::string_view texName) {
+		return texNames.getOrCreateId(texName);
 	}
 	std::string_view getTexName(TexId texId) {
-		return cacheNames.at(texIdToNameIndex.at(texId));
+		return texNames.getString(texId);
+	}
+
+	uint32_t getVisualId(std::string_view visualName) {
+		return visualNames.getOrCreateId(visualName);
 	}
 }
\ No newline at end of file
@@ -13,10 +13,52 @@ namespace assets
 			{ loadable.load((zenkit::Read*)nullptr) } -> std::same_as<void>;
 	};
 
+	struct AssetCacheStats {
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t evictions = 0;
+		uint64_t bytesCurrent = 0;
+		uint64_t bytesPeak = 0;
+	};
+
+	// While a pin scope is alive, all assets returned by getOrParse on the same thread are pinned and will not be evicted.
+	// Without an active scope, a returned pointer is only valid until the next call to getOrParse on any thread.
+	// All functions are thread-safe.
+	class AssetCachePinScope {
+	public:
+		AssetCachePinScope();
+		~AssetCachePinScope();
+		AssetCachePinScope(const AssetCachePinScope&) = delete;
+		AssetCachePinScope& operator=(const AssetCachePinScope&) = delete;
+	};
+
+	// While a level scope is alive, all assets returned by getOrParse on the same thread are referenced by the given level
+	// until releaseAssetCacheLevel is called for it. Referenced assets are only evicted if evicting all unreferenced
+	// assets does not suffice to get within budget. Level scopes cannot be nested.
+	class AssetCacheLevelScope {
+	public:
+		explicit AssetCacheLevelScope(const std::string& level);
+		~AssetCacheLevelScope();
+		AssetCacheLevelScope(const AssetCacheLevelScope&) = delete;
+		AssetCacheLevelScope& operator=(const AssetCacheLevelScope&) = delete;
+	};
+
 	template<HAS_LOAD T>
 	std::optional<const T*> getOrParse(const std::string& assetName);
 
-	render::TexId getTexId(const std::string& texName);
+	void releaseAssetCacheLevel(const std::string& level);
+
+	const uint64_t assetCacheBudgetDefault = sizeof(void*) == 4 ? (64 * 1024 * 1024) : (512 * 1024 * 1024);
+
+	// byte sizes are estimated from source file sizes
+	void setAssetCacheBudget(uint64_t budgetBytes);
+	void clearAssetCache();// must not be called while levels are being loaded
+	AssetCacheStats getAssetCacheStats();
+	void printAndResetAssetCacheStats();
+
+	// IDs are stable for the whole application lifetime, names are case-insensitive and returned in lowercase
+	render::TexId getTexId(std::string_view texName);
 	std::string_view getTexName(render::TexId texId);
+	uint32_t getVisualId(std::string_view visualName);
 }
 
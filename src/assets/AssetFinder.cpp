@@ -1,12 +1,16 @@
 #include "stdafx.h"
 #include "AssetFinder.h"
 
+#include "AssetIndex.h"
 #include "DebugTextures.h"
 #include "Util.h"
+#include "StringInterner.h"
 
 #include "zenkit/Logger.hh"
 #include "magic_enum.hpp"
 
+#include <mutex>
+
 
 namespace assets
 {
@@ -20,7 +24,7 @@ namespace assets
 	using std::string_view;
 
 	// name is lowercase
-	unordered_map<string, const fs::path> assetNamesToPaths;
+	util::CaseInsensitiveMap<const fs::path> assetNamesToPaths;
 	unordered_map<string, bool> zensFound;
 
 	unordered_set<AssetsIntern> assetsIntern = {
@@ -29,9 +33,28 @@ namespace assets
 	unordered_map<AssetsIntern, FileHandle> assetsInternHandles;
 	unordered_map<AssetsIntern, const fs::path> assetsInternPaths;
 
+	const util::FileExt VDF = util::FileExt::create(".VDF");
+	const util::FileExt MOD = util::FileExt::create(".MOD");
+
 	const std::string DEFAULT_TEXTURE = "default_texture.png";
 	const fs::path DEFAULT_TEXTURE_PATH = fs::path("./" + DEFAULT_TEXTURE);
 
+	// Caches for asset name resolution, including misses. Must be cleared whenever asset sources change.
+	// Base name results are cached per formats instance, which are inline singletons (see AssetFinder.h).
+	std::mutex resolveMutex;
+	util::CaseInsensitiveMap<std::optional<FileHandle>> resolvedNames;
+	unordered_map<const AssetFormats*, util::CaseInsensitiveMap<std::optional<std::pair<FileHandle, util::FileExt>>>> resolvedBaseNames;
+
+	// owns names of all file handles
+	util::StringInterner handleNames;
+
+	void clearResolvedNames()
+	{
+		std::scoped_lock lock(resolveMutex);
+		resolvedNames.clear();
+		resolvedBaseNames.clear();
+	}
+
 	struct Vfs {
 		zenkit::Vfs* zkit = nullptr;
 
@@ -42,19 +65,6 @@ namespace assets
 	} vfs;
 
 
-	void walkFilesRecursively(fs::path& rootDir, const std::function<void(const fs::path&, const string&)> onFile)
-	{
-		for (const auto& dirEntry : fs::recursive_directory_iterator(rootDir)) {
-			if (!std::filesystem::is_directory(dirEntry)) {
-				const auto& path = dirEntry.path();
-				auto filename = util::toString(path.filename());
-				util::asciiToLowerMut(filename);
-
-				onFile(path, filename);
-			}
-		}
-	}
-
 	void walkVfsNodesRecursively(const zenkit::VfsNode& parent, const std::function<void(const zenkit::VfsNode&)> onFile)
 	{
 		for (const auto& node : parent.children()) {
@@ -67,6 +77,18 @@ namespace assets
 		}
 	}
 
+	vector<string> getZensInVfs(const zenkit::Vfs& vfsToWalk)
+	{
+		vector<string> result;
+		walkVfsNodesRecursively(vfsToWalk.root(), [&](const zenkit::VfsNode& fileNode) -> void {
+			auto filenameLower = util::asciiToLower(fileNode.name());
+			if (util::endsWith(filenameLower, ".zen")) {
+				result.push_back(std::move(filenameLower));
+			}
+		});
+		return result;
+	}
+
 	FileHandle getInternal(const AssetsIntern asset)
 	{
 		auto it = assetsInternHandles.find(asset);
@@ -74,22 +96,35 @@ namespace assets
 		return it->second;
 	}
 
-	std::optional<FileHandle> getIfExistsAsFile(const string_view assetNameLower)
+	std::string_view getTexCompiledName(const string_view assetName, string& buffer)
 	{
 		// for tex we want to first look for -c suffix
-		if (util::endsWith(assetNameLower, ".tex") && !util::endsWith(assetNameLower, "-c.tex")) {
-			string assetNameNoExtLower = util::replaceExtension(assetNameLower, "");
-			auto result = getIfExistsAsFile(assetNameNoExtLower + "-c.tex");
+		const string_view compiledSuffix = "-c.tex";
+		bool isTexUncompiled = FormatsCompiled::TEX.isExtOf(assetName) && !(assetName.size() >= compiledSuffix.size()
+			&& util::CaseInsensitiveEqual()(assetName.substr(assetName.size() - compiledSuffix.size()), compiledSuffix));
+		if (!isTexUncompiled) {
+			return {};
+		}
+		buffer.assign(assetName.substr(0, assetName.size() - FormatsCompiled::TEX.extLower.size()));
+		buffer.append("-c.tex");
+		return buffer;
+	}
+
+	std::optional<FileHandle> getIfExistsAsFile(const string_view assetName)
+	{
+		string compiledNameBuffer;
+		string_view compiledName = getTexCompiledName(assetName, compiledNameBuffer);
+		if (!compiledName.empty()) {
+			auto result = getIfExistsAsFile(compiledName);
 			if (result.has_value()) {
 				return result;
 			}
 		}
 
-		auto assetNameStr = string(assetNameLower);
-		auto it = assetNamesToPaths.find(assetNameStr);
+		auto it = assetNamesToPaths.find(assetName);
 		if (it != assetNamesToPaths.end()) {
 			return FileHandle{
-				.name = std::move(assetNameStr),
+				.name = handleNames.intern(it->first),
 				.path = &(it->second),
 				.node = nullptr,
 			};
@@ -99,23 +134,23 @@ namespace assets
 		}
 	}
 
-	std::optional<FileHandle> getIfExistsInVfs(const string_view assetNameLower)
+	std::optional<FileHandle> getIfExistsInVfs(const string_view assetName)
 	{
 		assert(vfs.initialized());
 
-		// for tex we want to first look for -c suffix
-		if (util::endsWith(assetNameLower, ".tex") && !util::endsWith(assetNameLower, "-c.tex")) {
-			string assetNameNoExtLower = util::replaceExtension(assetNameLower, "");
-			auto result = getIfExistsInVfs(assetNameNoExtLower + "-c.tex");
+		string compiledNameBuffer;
+		string_view compiledName = getTexCompiledName(assetName, compiledNameBuffer);
+		if (!compiledName.empty()) {
+			auto result = getIfExistsInVfs(compiledName);
 			if (result.has_value()) {
 				return result;
 			}
 		}
 
-		const zenkit::VfsNode* node = vfs.zkit->find(assetNameLower);
+		const zenkit::VfsNode* node = vfs.zkit->find(assetName);
 		if (node != nullptr) {
 			return FileHandle{
-				.name = std::string(assetNameLower),
+				.name = handleNames.intern(assetName),
 				.path = nullptr,
 				.node = node,
 			};
@@ -125,29 +160,34 @@ namespace assets
 		}
 	}
 
-	std::optional<FileHandle> getIfExists(const string_view assetNameLower)
+	std::optional<FileHandle> getIfExists(const string_view assetName)
 	{
-		auto handle = getIfExistsAsFile(assetNameLower);
-		if (handle.has_value()) {
-			return handle;
+		std::scoped_lock lock(resolveMutex);
+
+		auto it = resolvedNames.find(assetName);
+		if (it == resolvedNames.end()) {
+			auto handle = getIfExistsAsFile(assetName);
+			if (!handle.has_value()) {
+				handle = getIfExistsInVfs(assetName);
+			}
+			it = resolvedNames.try_emplace(string(assetName), handle).first;
 		}
-		return getIfExistsInVfs(assetNameLower);
+		return it->second;
 	}
 
-	std::optional<std::pair<FileHandle, util::FileExt>> getIfAnyExists(const string_view assetNameAnyCase, const AssetFormats& formats)
+	std::optional<std::pair<FileHandle, util::FileExt>> resolveAnyFormat(const string_view assetNameNoExt, const AssetFormats& formats)
 	{
-		// remove extension if any
-		string assetNameNoExtLower = util::replaceExtension(assetNameAnyCase, "");
-		util::asciiToLowerMut(assetNameNoExtLower);
-
+		string assetName;
 		for (auto& ext : formats.formatsFile) {
-			auto handle = getIfExistsAsFile(assetNameNoExtLower + ext.extLower);
+			assetName.assign(assetNameNoExt).append(ext.extLower);
+			auto handle = getIfExistsAsFile(assetName);
 			if (handle.has_value()) {
 				return std::pair { handle.value(), ext };
 			}
 		}
 		for (auto& ext : formats.formatsVfs) {
-			auto handle = getIfExistsInVfs(assetNameNoExtLower + ext.extLower);
+			assetName.assign(assetNameNoExt).append(ext.extLower);
+			auto handle = getIfExistsInVfs(assetName);
 			if (handle.has_value()) {
 				return std::pair{ handle.value(), ext };
 			}
@@ -155,6 +195,21 @@ namespace assets
 		return std::nullopt;
 	}
 
+	std::optional<std::pair<FileHandle, util::FileExt>> getIfAnyExists(const string_view assetNameAnyCase, const AssetFormats& formats)
+	{
+		// remove extension if any
+		string_view assetNameNoExt = assetNameAnyCase.substr(0, assetNameAnyCase.find_last_of('.'));
+
+		std::scoped_lock lock(resolveMutex);
+
+		auto& resolved = resolvedBaseNames[&formats];
+		auto it = resolved.find(assetNameNoExt);
+		if (it == resolved.end()) {
+			it = resolved.try_emplace(string(assetNameNoExt), resolveAnyFormat(assetNameNoExt, formats)).first;
+		}
+		return it->second;
+	}
+
 	bool exists(const string_view assetName)
 	{
 		return getIfExists(assetName).has_value();
@@ -174,21 +229,23 @@ namespace assets
 	{
 		if (handle.path != nullptr) {
 			auto mmap = zenkit::Mmap(*handle.path);
-			return FileData(handle.name, mmap.data(), mmap.size(), std::move(mmap));
+			return FileData(string(handle.name), mmap.data(), mmap.size(), std::move(mmap));
 		}
 		if (handle.node != nullptr) {
 			phoenix::buffer buffer_view = handle.node->open();
-			return FileData(handle.name, buffer_view.array(), buffer_view.limit());
+			return FileData(string(handle.name), buffer_view.array(), buffer_view.limit());
 		}
 	}
 
 	void initAssetsIntern()
 	{
+		loadAssetIndex();
+
 		for (auto& enumVal : assetsIntern) {
 			std:string assetFileName = util::asciiToLower(magic_enum::enum_name(enumVal)) + ".png";
 			auto [ it, wasInserted ] = assetsInternPaths.insert({ enumVal , fs::path("./" + assetFileName) });
 			assetsInternHandles.insert({ enumVal, FileHandle {
-					.name = std::move(assetFileName),
+					.name = handleNames.intern(assetFileName),
 					.path = &(it->second),
 					.node = nullptr,
 				}
@@ -198,6 +255,7 @@ namespace assets
 
 	void initFileAssetSourceDir(fs::path& rootDir)
 	{
+		clearResolvedNames();
 		assetNamesToPaths.clear();
 
 		LOG(INFO) << "Scanning dir for asset files: " << util::toString(rootDir);
@@ -213,15 +271,14 @@ namespace assets
 			FormatsCompiled::MAN,
 		};
 
-		walkFilesRecursively(rootDir, [&](const fs::path& path, const string& filenameLower) -> void {
-			if (util::endsWithEither(filenameLower, extensions)) {
-				if (util::endsWith(filenameLower, ".zen")) {
-					auto [nameAndFoundInVfs, wasInserted] = zensFound.try_emplace(filenameLower);
-					nameAndFoundInVfs->second = false;// overwrite ZENs from VFS
-				}
-				assetNamesToPaths.insert(std::pair(filenameLower, path));
+		walkFilesIndexed(rootDir, extensions, [&](const fs::path& path, const string& filenameLower) -> void {
+			if (util::endsWith(filenameLower, ".zen")) {
+				auto [nameAndFoundInVfs, wasInserted] = zensFound.try_emplace(filenameLower);
+				nameAndFoundInVfs->second = false;// overwrite ZENs from VFS
 			}
+			assetNamesToPaths.insert(std::pair(filenameLower, path));
 		});
+		saveAssetIndex();
 
 		assets::initDebugTextures(&assetNamesToPaths);
 	}
@@ -240,41 +297,42 @@ namespace assets
 			}
 		});
 
+		clearResolvedNames();
 		if (vfs.zkit != nullptr) {
 			delete vfs.zkit;
 		}
 		vfs.zkit = new zenkit::Vfs();
 		zenkit::VfsOverwriteBehavior overwrite = zenkit::VfsOverwriteBehavior::NONE;
-			
-		walkFilesRecursively(rootDir, [&](const fs::path& path, const std::string& filename) -> void {
+		std::initializer_list<util::FileExt> extensions = { VDF, MOD };
+
+		vector<fs::path> mountedArchives;
+		walkFilesIndexed(rootDir, extensions, [&](const fs::path& path, const std::string& filename) -> void {
 			try {
-				if (util::endsWith(filename, ".vdf")) {
-					vfs.zkit->mount_disk(path, overwrite);
-					LOG(DEBUG) << "Loaded VDF: " << filename;
-				}
-				if (util::endsWith(filename, ".mod")) {
-					vfs.zkit->mount_disk(path, overwrite);
-					LOG(DEBUG) << "Loaded MOD: " << filename;
-				}
+				vfs.zkit->mount_disk(path, overwrite);
+				LOG(DEBUG) << "Loaded " << (VDF.isExtOf(filename) ? "VDF: " : "MOD: ") << filename;
+				mountedArchives.push_back(path);
 			}
 			catch (...) {
 				LOG(WARNING) << "Skipped unsupported VDF: " << filename;
 			}
 		});
 
-		walkVfsNodesRecursively(vfs.zkit->root(), [](const zenkit::VfsNode& fileNode) -> void {
-			const auto filenameLower = util::asciiToLower(fileNode.name());
-			if (util::endsWith(filenameLower, ".zen")) {
-				auto [nameAndFoundInVfs, wasInserted] = zensFound.try_emplace(filenameLower);
-				if (wasInserted) { // don't overwrite ZENs from files
-					nameAndFoundInVfs->second = true;
-				}
-			}
+		// walking all VFS nodes is slow, so we only do it if any archive changed since last startup
+		const auto& zensInArchives = getZensInArchivesIndexed(mountedArchives, [&]() -> vector<string> {
+			return getZensInVfs(*vfs.zkit);
 		});
+		for (const auto& filenameLower : zensInArchives) {
+			auto [nameAndFoundInVfs, wasInserted] = zensFound.try_emplace(filenameLower);
+			if (wasInserted) { // don't overwrite ZENs from files
+				nameAndFoundInVfs->second = true;
+			}
+		}
+		saveAssetIndex();
 	}
 
 	void cleanAssetSources()
 	{
+		clearResolvedNames();
 		if (vfs.zkit != nullptr) {
 			delete vfs.zkit;
 			vfs.zkit = nullptr;
@@ -16,7 +16,8 @@ namespace assets
 		std::initializer_list<util::FileExt> formatsVfs;
 	};
 
-	const AssetFormats FORMATS_TEXTURE = {
+	// single instance per program, so formats can be compared and cached by address
+	inline const AssetFormats FORMATS_TEXTURE = {
 		{
 			FormatsSource::TGA,
 			FormatsSource::PNG,
@@ -25,7 +26,7 @@ namespace assets
 			FormatsCompiled::TEX
 		}
 	};
-	const AssetFormats FORMATS_LEVEL = {
+	inline const AssetFormats FORMATS_LEVEL = {
 		{
 			FormatsCompiled::ZEN
 		}, {
@@ -40,7 +41,7 @@ namespace assets
 	// abstracts over real vs VFS files, allows getting byte contents
 	struct FileHandle {
 		// TODO forward declare the pointers and move to Loader.h
-		const std::string name = "";
+		std::string_view name = "";// lowercase, valid for application lifetime
 		const std::filesystem::path* path = nullptr;// -> if not null, this is a real file
 		const zenkit::VfsNode* node = nullptr;// -> if not null, this is a ZenKit VFS entry
 	};
@@ -48,9 +49,11 @@ namespace assets
 	const render::FileData getData(const FileHandle handle);
 
 	FileHandle getInternal(const AssetsIntern asset);
-	std::optional<FileHandle> getIfExistsAsFile(const std::string_view assetNameLower);
-	std::optional<FileHandle> getIfExistsInVfs(const std::string_view assetNameLower);
-	std::optional<FileHandle> getIfExists(const std::string_view assetNameLower);
+	// Asset names are case-insensitive. Results of getIfExists and getIfAnyExists (including misses) are cached until
+	// asset sources change, so repeated lookups do not allocate.
+	std::optional<FileHandle> getIfExistsAsFile(const std::string_view assetName);
+	std::optional<FileHandle> getIfExistsInVfs(const std::string_view assetName);
+	std::optional<FileHandle> getIfExists(const std::string_view assetName);
 	std::optional<std::pair<FileHandle, util::FileExt>> getIfAnyExists(const std::string_view assetNameAnyCase, const AssetFormats& formats);
 	bool exists(const std::string_view assetName);
 
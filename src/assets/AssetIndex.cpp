@@ -0,0 +1,251 @@
+#include "stdafx.h"
+#include "AssetIndex.h"
+
+#include <fstream>
+#include <sstream>
+
+namespace assets
+{
+	namespace fs = std::filesystem;
+	using std::string;
+	using std::vector;
+	using std::unordered_map;
+
+	// Index file is plain text, one record per line:
+	// R <root key>                 -> following D records belong to this root
+	// D <mtime> <relative dir>     -> following F/S records belong to this dir (in directory iteration order)
+	// F <filename>
+	// S <subdir name>
+	// A <size> <mtime> <archive>
+	// Z <zen name>                 -> ZEN contained in any of the A records (all archives are mounted into one VFS)
+
+	const fs::path assetIndexFile = "./cache/asset_index.txt";
+	const string assetIndexHeader = "ZenRen Asset Index 3";
+
+	struct IndexedEntry {
+		string name;
+		bool isDir = false;
+	};
+
+	struct IndexedDir {
+		int64_t mtime = 0;
+		vector<IndexedEntry> entries;// files and subdirs in the order returned by directory iteration
+	};
+
+	struct IndexedArchive {
+		uint64_t size = 0;
+		int64_t mtime = 0;
+
+		bool operator==(const IndexedArchive&) const = default;
+	};
+
+	using DirIndex = unordered_map<string, IndexedDir>;// key is relative dir
+
+	// root key is root dir + extensions, since the same dir may be indexed with different filters
+	unordered_map<string, DirIndex> dirIndices;
+	unordered_map<string, IndexedArchive> archiveIndex;
+	vector<string> archiveZens;
+
+	struct WalkStats {
+		uint32_t dirsReused = 0;
+		uint32_t dirsScanned = 0;
+	};
+
+	fs::path fromUtf8(const string& str)
+	{
+		return fs::path(util::utf8ToWide(str));
+	}
+
+	int64_t getMtime(const fs::path& path)
+	{
+		std::error_code error;
+		auto time = fs::last_write_time(path, error);
+		return error ? -1 : (int64_t) time.time_since_epoch().count();
+	}
+
+	string readRest(std::istringstream& line)
+	{
+		string rest;
+		std::getline(line >> std::ws, rest);
+		return rest;
+	}
+
+	void loadAssetIndex()
+	{
+		dirIndices.clear();
+		archiveIndex.clear();
+		archiveZens.clear();
+
+		std::ifstream in(assetIndexFile);
+		if (!in) {
+			return;
+		}
+		string lineStr;
+		if (!std::getline(in, lineStr) || lineStr != assetIndexHeader) {
+			LOG(INFO) << "Asset Index: Ignoring outdated index file.";
+			return;
+		}
+
+		DirIndex* currentRoot = nullptr;
+		IndexedDir* currentDir = nullptr;
+
+		while (std::getline(in, lineStr)) {
+			std::istringstream line(lineStr);
+			char type;
+			line >> type;
+			switch (type) {
+			case 'R': {
+				currentRoot = &dirIndices[readRest(line)];
+				currentDir = nullptr;
+			} break;
+			case 'D': {
+				int64_t mtime;
+				line >> mtime;
+				if (currentRoot != nullptr) {
+					currentDir = &(*currentRoot)[readRest(line)];
+					currentDir->mtime = mtime;
+				}
+			} break;
+			case 'F': {
+				if (currentDir != nullptr) currentDir->entries.push_back({ readRest(line), false });
+			} break;
+			case 'S': {
+				if (currentDir != nullptr) currentDir->entries.push_back({ readRest(line), true });
+			} break;
+			case 'A': {
+				uint64_t size;
+				int64_t mtime;
+				line >> size >> mtime;
+				archiveIndex[readRest(line)] = { size, mtime };
+			} break;
+			case 'Z': {
+				archiveZens.push_back(readRest(line));
+			} break;
+			}
+		}
+	}
+
+	void saveAssetIndex()
+	{
+		std::error_code error;
+		fs::create_directories(assetIndexFile.parent_path(), error);
+		fs::path fileTemp = assetIndexFile;
+		fileTemp += ".tmp";
+		{
+			std::ofstream out(fileTemp, std::ios::trunc);
+			out << assetIndexHeader << '\n';
+			for (const auto& [rootKey, dirs] : dirIndices) {
+				out << "R " << rootKey << '\n';
+				for (const auto& [relDir, dir] : dirs) {
+					out << "D " << dir.mtime << ' ' << relDir << '\n';
+					for (const auto& entry : dir.entries) {
+						out << (entry.isDir ? "S " : "F ") << entry.name << '\n';
+					}
+				}
+			}
+			for (const auto& [path, archive] : archiveIndex) {
+				out << "A " << archive.size << ' ' << archive.mtime << ' ' << path << '\n';
+			}
+			for (const auto& zen : archiveZens) {
+				out << "Z " << zen << '\n';
+			}
+			if (!out) {
+				LOG(WARNING) << "Asset Index: Failed to write index file: " << fileTemp;
+				return;
+			}
+		}
+		fs::rename(fileTemp, assetIndexFile, error);
+		if (error) {
+			LOG(WARNING) << "Asset Index: Failed to write index file: " << assetIndexFile << " (" << error.message() << ")";
+		}
+	}
+
+	IndexedDir scanDir(const fs::path& dir, const std::initializer_list<util::FileExt>& extensions)
+	{
+		IndexedDir result;
+		std::error_code error;
+		for (const auto& dirEntry : fs::directory_iterator(dir, error)) {
+			auto filename = util::toString(dirEntry.path().filename());
+			// symlinks and junctions are not followed into, since they may create cycles
+			if (dirEntry.symlink_status(error).type() == fs::file_type::directory) {
+				result.entries.push_back({ filename, true });
+			}
+			else if (dirEntry.is_directory(error)) {
+				LOG(DEBUG) << "Asset Index: Skipped linked dir: " << filename;
+			}
+			else if (util::endsWithEither(util::asciiToLower(filename), extensions)) {
+				result.entries.push_back({ filename, false });
+			}
+		}
+		return result;
+	}
+
+	void walkDirIndexed(
+		const fs::path& rootDir, const string& relDir, DirIndex& oldIndex, DirIndex& newIndex,
+		const std::initializer_list<util::FileExt>& extensions,
+		const std::function<void(const fs::path&, const string&)>& onFile, WalkStats& stats)
+	{
+		const fs::path dir = relDir.empty() ? rootDir : rootDir / fromUtf8(relDir);
+		int64_t mtime = getMtime(dir);
+
+		IndexedDir indexedDir;
+		auto it = oldIndex.find(relDir);
+		if (it != oldIndex.end() && it->second.mtime == mtime) {
+			indexedDir = std::move(it->second);
+			stats.dirsReused++;
+		}
+		else {
+			indexedDir = scanDir(dir, extensions);
+			indexedDir.mtime = mtime;
+			stats.dirsScanned++;
+		}
+
+		// same order as recursive_directory_iterator (subdirs are walked where they appear), which decides which of
+		// multiple files with the same name is found first
+		for (const auto& [name, isDir] : indexedDir.entries) {
+			if (isDir) {
+				string relSubdir = relDir.empty() ? name : (relDir + '/' + name);
+				walkDirIndexed(rootDir, relSubdir, oldIndex, newIndex, extensions, onFile, stats);
+			}
+			else {
+				onFile(dir / fromUtf8(name), util::asciiToLower(name));
+			}
+		}
+		newIndex[relDir] = std::move(indexedDir);
+	}
+
+	void walkFilesIndexed(
+		const fs::path& rootDir,
+		const std::initializer_list<util::FileExt>& extensions,
+		const std::function<void(const fs::path&, const string&)>& onFile)
+	{
+		string rootKey = util::toString(fs::absolute(rootDir));
+		for (const auto& ext : extensions) {
+			rootKey += '|' + ext.extLower;
+		}
+
+		DirIndex& oldIndex = dirIndices[rootKey];
+		DirIndex newIndex;
+		WalkStats stats;
+		walkDirIndexed(rootDir, "", oldIndex, newIndex, extensions, onFile, stats);
+		oldIndex = std::move(newIndex);// drops deleted dirs
+
+		LOG(DEBUG) << "Asset Index: " << stats.dirsReused << " dirs unchanged, " << stats.dirsScanned << " dirs rescanned";
+	}
+
+	const vector<string>& getZensInArchivesIndexed(
+		const vector<fs::path>& archives,
+		const std::function<vector<string>()>& scanArchives)
+	{
+		unordered_map<string, IndexedArchive> current;
+		for (const auto& archive : archives) {
+			std::error_code error;
+			current[util::toString(fs::absolute(archive))] = { fs::file_size(archive, error), getMtime(archive) };
+		}
+		if (current != archiveIndex) {
+			archiveIndex = std::move(current);
+			archiveZens = scanArchives();
+		}
+		return archiveZens;
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Util.h"
+
+#include <filesystem>
+
+namespace assets
+{
+	// Persisted index of asset source dirs and VDF archives, so that startup does not need to walk all files and VFS nodes.
+	// Directories are revalidated by their modification time (changes whenever entries are added, removed or renamed),
+	// archives by size and modification time. Only changed directories are rescanned, ZENs of archives are only listed
+	// again if any archive changed.
+
+	void loadAssetIndex();
+	void saveAssetIndex();
+
+	// Calls onFile for every file below rootDir with any of the given extensions (filename is passed lowercase). Files are
+	// visited in the same order as std::filesystem::recursive_directory_iterator would visit them.
+	void walkFilesIndexed(
+		const std::filesystem::path& rootDir,
+		const std::initializer_list<util::FileExt>& extensions,
+		const std::function<void(const std::filesystem::path&, const std::string&)>& onFile);
+
+	// Returns cached list of ZEN names (lowercase) contained in the given archives or calls scanArchives if any archive
+	// was added, removed or changed since the list was cached.
+	const std::vector<std::string>& getZensInArchivesIndexed(
+		const std::vector<std::filesystem::path>& archives,
+		const std::function<std::vector<std::string>()>& scanArchives);
+}
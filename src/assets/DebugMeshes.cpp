@@ -53,7 +53,7 @@ namespace assets
         return result;
     }
 
-    void loadInstanceMeshBboxDebugVisual(MatToChunksToVertsBasic& target, const StaticInstance& instance)
+    void loadInstanceMeshBboxDebugVisual(MeshDataBasic& target, const StaticInstance& instance)
     {
         vector<VertexPos> facesPos;
         vector<VertexNorUv> facesNormalUv;
@@ -100,7 +100,7 @@ namespace assets
         return result;
     }
 
-    void loadPointDebugVisual(MatToChunksToVertsBasic& target, const Vec3& pos, const Vec3& scale, const Color& color)
+    void loadPointDebugVisual(MeshDataBasic& target, const Vec3& pos, const Vec3& scale, const Color& color)
     {
         vector<VertexPos> facesPos;
         vector<VertexNorUv> facesNormalUv;
@@ -142,7 +142,7 @@ namespace assets
         return result;
     }
 
-    void loadLineDebugVisual(MatToChunksToVertsBasic& target, const Vec3& posStart, Vec3& posEnd, const Color& color)
+    void loadLineDebugVisual(MeshDataBasic& target, const Vec3& posStart, Vec3& posEnd, const Color& color)
     {
         vector<VertexPos> facesPos;
         vector<VertexNorUv> facesNormalUv;
@@ -23,7 +23,7 @@ namespace assets {
 		}
 	}
 
-	void initDebugTextures(std::unordered_map<std::string, const fs::path>* assetNamesToPaths)
+	void initDebugTextures(util::CaseInsensitiveMap<const fs::path>* assetNamesToPaths)
 	{
 		const bool numberTexturesEnabled = false;
 		if (numberTexturesEnabled) {
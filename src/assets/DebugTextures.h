@@ -2,7 +2,9 @@
 
 #include <filesystem>
 
+#include "Util.h"
+
 namespace assets
 {
-	void initDebugTextures(std::unordered_map<std::string, const std::filesystem::path>* assetNamesToPaths);
+	void initDebugTextures(util::CaseInsensitiveMap<const std::filesystem::path>* assetNamesToPaths);
 }
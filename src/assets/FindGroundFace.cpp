@@ -122,7 +122,7 @@ namespace assets
         return currentBestIndex;
     }
 
-    std::optional<VertKey> getGroundFaceAtPos(const XMVECTOR pos, const MatToChunksToVertsBasic& meshData, const VertLookupTree& vertLookup)
+    std::optional<WorldFace> getGroundFaceAtPos(const XMVECTOR pos, const MeshDataBasic& meshData, const VertLookupTree& vertLookup)
     {
         // TODO calculate UV here instead of in caller
 
@@ -146,13 +146,13 @@ namespace assets
                 return std::nullopt;
             }
             else {
-                return vertKeys[closestIndex];
+                return createWorldFace(meshData, vertKeys[closestIndex]);
             }
         }
         else {
             auto lookupResult = rayDownIntersected(vertLookup, pos3, 100);
             if (lookupResult.has_value()) {
-                return lookupResult.value().vertKey;
+                return *lookupResult.value().face;
             }
             else {
                 return std::nullopt;
@@ -5,7 +5,7 @@
 
 namespace assets
 {
-	Color interpolateColor(const Vec3& pos, const render::MatToChunksToVertsBasic& meshData, const render::VertKey& vertKey);
-	std::optional<render::VertKey> getGroundFaceAtPos(const DirectX::XMVECTOR pos, const render::MatToChunksToVertsBasic& meshData, const VertLookupTree& vertLookup);
+	Color interpolateColor(const Vec3& pos, const render::MeshDataBasic& meshData, const render::VertKey& vertKey);
+	std::optional<WorldFace> getGroundFaceAtPos(const DirectX::XMVECTOR pos, const render::MeshDataBasic& meshData, const VertLookupTree& vertLookup);
 }
 
@@ -2,6 +2,7 @@
 #include "LookupTrees.h"
 
 #include "render/basic/MeshUtil.h"
+#include "render/Loader.h"
 
 #include "bvh/v2/vec.h"
 #include "bvh/v2/ray.h"
@@ -10,6 +11,12 @@
 #include "bvh/v2/thread_pool.h"
 #include "bvh/v2/executor.h"
 #include "bvh/v2/stack.h"
+#include "bvh/v2/stream.h"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <format>
 
 namespace assets
 {
@@ -18,6 +25,7 @@ namespace assets
     using ::std::unordered_map;
     using ::std::array;
     using DirectX::XMVECTOR;
+    namespace fs = std::filesystem;
 
     const float rayIntersectTolerance = 0.001f;
 
@@ -46,7 +54,7 @@ namespace assets
     }
 
     /*
-    VertLookupTree createVertLookup(const MatToChunksToVertsBasic& meshData)
+    VertLookupTree createVertLookup(const MeshDataBasic& meshData)
     {
         // TODO bboxes for each face could be created during mesh loading ideally (?)
         vector<OrthoBoundingBox3D> bboxes;
@@ -116,7 +124,7 @@ namespace assets
         return !(pos.y >= (maxY + rayIntersectTolerance + searchSizeY) || pos.y >= (minY - rayIntersectTolerance));
     }
 
-    std::vector<VertKey> rayDownIntersectedNaive(const MatToChunksToVertsBasic& meshData, const Vec3& pos, float searchSizeY)
+    std::vector<VertKey> rayDownIntersectedNaive(const MeshDataBasic& meshData, const Vec3& pos, float searchSizeY)
     {
         vector<VertKey> result;
         forEachFace(meshData, [&](const VertKey& vertKey) -> void {
@@ -163,31 +171,164 @@ namespace assets
         return { result.x, result.y, result.z };
     }
 
+    // ##############################################################################################################################
+    // World Faces
+    // ##############################################################################################################################
+
     // Permuting the primitive data allows to remove indirections during traversal, which makes it faster.
-    static constexpr bool should_permute = false;
+    static constexpr bool should_permute = true;
+
+    WorldFace createWorldFace(const MeshDataBasic& meshData, const VertKey& vertKey)
+    {
+        const VertRange& range = vertKey.get(meshData);
+        return {
+            .pos = vertKey.getPos(meshData),
+            .other = vertKey.getOther(meshData),
+            .matId = range.matId,
+            .cellId = range.cellId,
+        };
+    }
+
+    vector<WorldFace> permuteWorldFaces(const Bvh& bvh, vector<WorldFace>&& faces)
+    {
+        if (!should_permute) {
+            return std::move(faces);
+        }
+        vector<WorldFace> result;
+        result.reserve(faces.size());
+        for (size_t primId : bvh.prim_ids) {
+            result.push_back(faces[primId]);
+        }
+        return result;
+    }
+
+    const fs::path vertLookupCacheDir = "./cache/bvh";
+    const std::array<char, 4> vertLookupCacheMagic = { 'Z', 'R', 'B', 'V' };
+    constexpr uint32_t vertLookupCacheVersion = 1;
 
-    VertLookupTree createVertLookup2(const MatToChunksToVertsBasic& meshData)
+    // makes temp file names unique when multiple threads write the same tree at once
+    std::atomic<uint32_t> vertLookupTempCounter = 0;
+
+    struct VertLookupCacheHeader {
+        std::array<char, 4> magic;
+        uint32_t version;
+        uint64_t meshHash;
+        uint32_t quality;
+        uint32_t faceCount;
+        uint8_t permuted;
+    };
+
+    bvh::v2::DefaultBuilder<BvhNode>::Quality toBvhQuality(LookupTreeQuality quality)
     {
+        using Quality = bvh::v2::DefaultBuilder<BvhNode>::Quality;
+        switch (quality) {
+        case LookupTreeQuality::LOW: return Quality::Low;
+        case LookupTreeQuality::MEDIUM: return Quality::Medium;
+        default: return Quality::High;
+        }
+    }
+
+    fs::path getVertLookupCachePath(const VertLookupCacheHeader& header)
+    {
+        // name contains everything the file content depends on, so an existing file never needs to be replaced,
+        // which would fail on Windows while another thread is still reading it
+        return vertLookupCacheDir / std::format("{:016x}_{}_{}_{}.v{}.bvh",
+            header.meshHash, header.quality, header.faceCount, (uint32_t) header.permuted, header.version);
+    }
+
+    std::optional<VertLookupTree> loadVertLookupFile(const fs::path& path, const VertLookupCacheHeader& expected)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            return std::nullopt;
+        }
+        VertLookupCacheHeader header;
+        in.read((char*) &header, sizeof(header));
+        if (!in
+                || header.magic != expected.magic
+                || header.version != expected.version
+                || header.meshHash != expected.meshHash
+                || header.quality != expected.quality
+                || header.faceCount != expected.faceCount
+                || header.permuted != expected.permuted) {
+            LOG(WARNING) << "Face Lookup: Ignoring corrupted cache file: " << path;
+            return std::nullopt;
+        }
+
         VertLookupTree result;
-        std::vector<BvhTri> tris;
-        
-        uint32_t index = 0;
-        forEachFace(meshData, [&](const VertKey& vertKey) -> void {
-            const auto& verts = vertKey.getPos(meshData);
-            tris.push_back({
-                { verts[0].x, verts[0].y, verts[0].z },
-                { verts[1].x, verts[1].y, verts[1].z },
-                { verts[2].x, verts[2].y, verts[2].z },
-            });
-            result.treeIndexToVert.insert({ index, vertKey });
-            index++;
-        });
+        bvh::v2::StdInputStream stream(in);
+        result.bvh = Bvh::deserialize(stream);
+
+        static_assert(std::is_trivially_copyable_v<BvhPrecomp>);
+        result.precomputed.resize(header.faceCount);
+        in.read((char*) result.precomputed.data(), result.precomputed.size() * sizeof(BvhPrecomp));
+        if (!in || result.bvh.prim_ids.size() != header.faceCount) {
+            LOG(WARNING) << "Face Lookup: Ignoring corrupted cache file: " << path;
+            return std::nullopt;
+        }
+        return result;
+    }
+
+    std::optional<VertLookupTree> loadVertLookup(const fs::path& path, const VertLookupCacheHeader& expected)
+    {
+        std::error_code error;
+        if (!fs::is_regular_file(path, error)) {
+            return std::nullopt;
+        }
+        auto result = loadVertLookupFile(path, expected);
+        if (!result.has_value()) {
+            // invalid file is closed at this point, removing it allows the rebuilt tree to be saved again
+            fs::remove(path, error);
+        }
+        return result;
+    }
+
+    void saveVertLookup(const fs::path& path, const VertLookupCacheHeader& header, const VertLookupTree& tree)
+    {
+        std::error_code error;
+        if (fs::is_regular_file(path, error)) {
+            // already stored by another thread
+            return;
+        }
+        fs::create_directories(path.parent_path(), error);
+        fs::path pathTemp = path;
+        pathTemp += std::format(".{}.tmp", vertLookupTempCounter++);
+        {
+            std::ofstream out(pathTemp, std::ios::binary | std::ios::trunc);
+            out.write((const char*) &header, sizeof(header));
+            bvh::v2::StdOutputStream stream(out);
+            tree.bvh.serialize(stream);
+            out.write((const char*) tree.precomputed.data(), tree.precomputed.size() * sizeof(BvhPrecomp));
+            if (!out) {
+                LOG(WARNING) << "Face Lookup: Failed to write cache file: " << pathTemp;
+                out.close();
+                fs::remove(pathTemp, error);
+                return;
+            }
+        }
+        fs::rename(pathTemp, path, error);
+        if (error) {
+            // if another thread stored the same tree in the meantime, it may still be open and cannot be replaced
+            std::error_code existsError;
+            if (!fs::is_regular_file(path, existsError)) {
+                LOG(WARNING) << "Face Lookup: Failed to write cache file: " << path << " (" << error.message() << ")";
+            }
+            fs::remove(pathTemp, error);
+        }
+    }
 
-        bvh::v2::ThreadPool thread_pool;
+    Bvh buildVertLookupBvh(const vector<BvhTri>& tris, vector<BvhPrecomp>& precomputedOut, LookupTreeQuality quality)
+    {
+        // parallel build needs per-thread working memory, so build single-threaded if already over budget
+        bool overBudget = isLoadMemoryOverBudget();
+        if (overBudget) {
+            LOG(INFO) << "Face Lookup: Memory over load budget, building BVH single-threaded";
+        }
+        bvh::v2::ThreadPool thread_pool(overBudget ? 1 : 0);
         bvh::v2::ParallelExecutor executor(thread_pool);
 
-        std::vector<BvhBBox> bboxes;
-        std::vector<BvhVec3> centers;
+        std::vector<BvhBBox> bboxes(tris.size());
+        std::vector<BvhVec3> centers(tris.size());
         executor.for_each(0, tris.size(), [&](size_t begin, size_t end) {
             for (size_t i = begin; i < end; ++i) {
                 bboxes[i] = tris[i].get_bbox();
@@ -196,17 +337,68 @@ namespace assets
         });
 
         typename bvh::v2::DefaultBuilder<BvhNode>::Config config;
-        config.quality = bvh::v2::DefaultBuilder<BvhNode>::Quality::Medium;
-        result.bvh = bvh::v2::DefaultBuilder<BvhNode>::build(thread_pool, bboxes, centers, config);
+        config.quality = toBvhQuality(quality);
+        Bvh bvh = bvh::v2::DefaultBuilder<BvhNode>::build(thread_pool, bboxes, centers, config);
 
-        result.precomputed.resize(tris.size());
+        precomputedOut.resize(tris.size());
         executor.for_each(0, tris.size(), [&](size_t begin, size_t end) {
             for (size_t i = begin; i < end; ++i) {
-                auto j = should_permute ? result.bvh.prim_ids[i] : i;
-                result.precomputed[i] = tris[j];
+                auto j = should_permute ? bvh.prim_ids[i] : i;
+                precomputedOut[i] = tris[j];
             }
         });
+        return bvh;
+    }
 
+    VertLookupTree createVertLookup(const MeshDataBasic& meshData, LookupTreeQuality quality, bool cached)
+    {
+        // face order of forEachFace defines the original primitive indices, and hashing the positions in that order
+        // guarantees that a cached tree is only used if its primitive indices still map to the same faces
+        std::vector<BvhTri> tris;
+        std::vector<WorldFace> faces;
+        size_t meshHash = 0;
+
+        forEachFace(meshData, [&](const VertKey& vertKey) -> void {
+            const WorldFace& face = faces.emplace_back(createWorldFace(meshData, vertKey));
+            const auto& verts = face.pos;
+            tris.push_back({
+                { verts[0].x, verts[0].y, verts[0].z },
+                { verts[1].x, verts[1].y, verts[1].z },
+                { verts[2].x, verts[2].y, verts[2].z },
+            });
+            for (const auto& vert : verts) {
+                util::hashCombine(meshHash, vert.x);
+                util::hashCombine(meshHash, vert.y);
+                util::hashCombine(meshHash, vert.z);
+            }
+        });
+
+        VertLookupCacheHeader header = {
+            .magic = vertLookupCacheMagic,
+            .version = vertLookupCacheVersion,
+            .meshHash = meshHash,
+            .quality = (uint32_t) quality,
+            .faceCount = (uint32_t) tris.size(),
+            .permuted = should_permute,
+        };
+        fs::path cachePath = getVertLookupCachePath(header);
+
+        if (cached) {
+            auto loaded = loadVertLookup(cachePath, header);
+            if (loaded.has_value()) {
+                loaded->faces = permuteWorldFaces(loaded->bvh, std::move(faces));
+                LOG(DEBUG) << "Face Lookup: Loaded cached BVH: " << cachePath;
+                return std::move(loaded.value());
+            }
+        }
+
+        VertLookupTree result;
+        result.bvh = buildVertLookupBvh(tris, result.precomputed, quality);
+        result.faces = permuteWorldFaces(result.bvh, std::move(faces));
+
+        if (cached) {
+            saveVertLookup(cachePath, header, result);
+        }
         return result;
     }
 
@@ -233,7 +425,7 @@ namespace assets
             for (size_t i = begin; i < end; ++i) {
                 size_t j = should_permute ? i : lookup.bvh.prim_ids[i];
                 if (auto hit = lookup.precomputed[j].intersect(ray)) {
-                    hitId = i;
+                    hitId = j;// index into precomputed and faces
                     std::tie(ray.tmax, hitPoint.u, hitPoint.v) = *hit;
                 }
             }
@@ -242,7 +434,7 @@ namespace assets
 
         if (hitId != invalidId) {
             return VertLookupResult{
-                .vertKey = lookup.treeIndexToVert.at(hitId),
+                .face = &lookup.faces[hitId],
                 .hitPoint = hitPoint,
                 .hitDistance = ray.tmax,
             };
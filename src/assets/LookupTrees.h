@@ -32,9 +32,9 @@ namespace assets
 	//	}
 	//};
 
-	//VertLookupTree createVertLookup(const render::MatToChunksToVertsBasic& meshData);
+	//VertLookupTree createVertLookup(const render::MeshDataBasic& meshData);
 	//std::vector<render::VertKey> rayDownIntersected(const VertLookupTree& lookup, const Vec3& pos, float searchSizeY);
-	std::vector<render::VertKey> rayDownIntersectedNaive(const render::MatToChunksToVertsBasic& meshData, const Vec3& pos, float searchSizeY);
+	std::vector<render::VertKey> rayDownIntersectedNaive(const render::MeshDataBasic& meshData, const Vec3& pos, float searchSizeY);
 	//std::vector<render::VertKey> rayIntersected(const VertLookupTree& lookup, const DirectX::XMVECTOR& rayPosStart, const DirectX::XMVECTOR& rayPosEnd);
 
 	struct LightLookupTree {
@@ -46,7 +46,7 @@ namespace assets
 	//struct FaceLookupContext
 	//{
 	//	assets::VertLookupTree spatialTree;
-	//	const render::MatToChunksToVertsBasic& data;
+	//	const render::MeshDataBasic& data;
 	//};
 
 	struct LightLookupContext
@@ -61,11 +61,21 @@ namespace assets
 	using BvhNode = bvh::v2::Node<float, 3>;
 	using Bvh = bvh::v2::Bvh<BvhNode>;
 
+	// Copy of all data of a single world face that is needed by lookups, so that hits do not need to access mesh data
+	struct WorldFace {
+		std::array<render::VertexPos, 3> pos;
+		std::array<render::VertexBasic, 3> other;
+		render::MatId matId;
+		render::CellId cellId;
+	};
+
+	WorldFace createWorldFace(const render::MeshDataBasic& meshData, const render::VertKey& vertKey);
+
 	struct VertLookupTree
 	{
 		Bvh bvh;
-		std::vector<BvhPrecomp> precomputed;
-		std::unordered_map<uint32_t, render::VertKey> treeIndexToVert;
+		std::vector<BvhPrecomp> precomputed;// permuted into BVH primitive order
+		std::vector<WorldFace> faces;// parallel to precomputed
 
 		//const std::vector<render::VertKey> bboxIdsToVertIds(const std::vector<size_t>& bboxIds) const {
 		//    std::vector<render::VertKey> result;
@@ -78,18 +88,21 @@ namespace assets
 	};
 
 	struct VertLookupResult {
-		render::VertKey vertKey;
+		const WorldFace* face;
 		Uv hitPoint;
 		float hitDistance;
 	};
 
+	// If cached is true, tree is loaded from / saved to disk, keyed by world mesh face positions and quality.
+	VertLookupTree createVertLookup(const render::MeshDataBasic& meshData, LookupTreeQuality quality, bool cached);
+
 	std::optional<VertLookupResult> rayDownIntersected(const VertLookupTree& lookup, const Vec3& pos, float searchSizeY);
 	std::optional<VertLookupResult> rayIntersected(const VertLookupTree& lookup, const DirectX::XMVECTOR& rayPosStart, const DirectX::XMVECTOR& rayPosEnd);
 
 	struct FaceLookupContext
 	{
 		VertLookupTree spatialTree;
-		const render::MatToChunksToVertsBasic& data;
+		const render::MeshDataBasic& data;
 	};
 
 }
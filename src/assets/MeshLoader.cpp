@@ -9,6 +9,7 @@
 
 #include "AssetCache.h"
 #include "MeshOpt.h"
+#include "Arena.h"
 #include "render/basic/MeshPrimitives.h"
 #include "render/basic/MeshUtil.h"
 #include "Util.h"
@@ -16,6 +17,10 @@
 #include "magic_enum.hpp"
 #include "glm/gtc/type_ptr.hpp"
 
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 namespace assets
 {
     using namespace render;
@@ -31,7 +36,6 @@ namespace assets
 	using ::util::getOrCreate;
 
     constexpr bool meshoptOptimize = true;
-    constexpr bool manualReservation = false;
 
     // 0.20f preserves most objects
     // 0.42f preserves single barrels slightly (addon beach)
@@ -81,13 +85,6 @@ namespace assets
     template<typename MESH, typename SUBMESH>
     concept IS_MODEL_MESH = std::is_same_v<MESH, zenkit::MultiResolutionMesh> && std::is_same_v<SUBMESH, zenkit::SubMesh>;
 
-    struct Face {
-        array<VertexPos, 3> pos;
-        array<VertexNorUv, 3> normalUv;
-        array<VertexBasic, 3> features;
-        GridPos gridPos;
-    };
-
     // ###########################################################################
     // POSITIONS
     // ###########################################################################
@@ -141,11 +138,6 @@ namespace assets
     template <typename MESH, typename SUBMESH>
     using GetNormal = XMVECTOR (*) (const MESH& mesh, const SUBMESH& submesh, uint32_t vertIndex);
 
-    inline XMVECTOR getNormalZkit(const zenkit::Mesh& mesh, const Unused& _, uint32_t vertIndex)
-    {
-        return toXM4Pos(mesh.features.at(mesh.polygons.feature_indices.at(vertIndex)).normal);
-    }
-
     // TODO pass face index as well for models or everywhere or return entire face
 
     inline XMVECTOR getNormalModelZkit(const Unused& _, const zenkit::SubMesh& submesh, uint32_t vertIndex)
@@ -238,84 +230,10 @@ namespace assets
         return toUv(submesh.wedges.at(wedgeIndex).texture);
     }
 
-    // ###########################################################################
-    // LIGHTMAP UVs
-    // ###########################################################################
-
-    template <typename MESH>
-    using GetLightmapUvs = Uvi (*) (const MESH&, uint32_t index);
-
-    template <XYZ V3>
-    Uv calculateLightmapUvs(V3 lmOrigin, V3 lmNormalUp, V3 lmNormalRight, XMVECTOR posXm)
-    {
-        XMVECTOR rescale = toXM4Pos(Vec3{ 100, 100, 100 });
-        XMVECTOR lmDir = XMVectorMultiply(posXm, rescale) - toXM4Pos(lmOrigin);
-        float u = XMVectorGetX(XMVector3Dot(lmDir, toXM4Dir(lmNormalRight)));
-        float v = XMVectorGetX(XMVector3Dot(lmDir, toXM4Dir(lmNormalUp)));
-        return { u, v };
-    }
-
-    Uvi getLightmapUvsZkit(const zenkit::Mesh& mesh, uint32_t faceIndex, XMVECTOR posXm)
-    {
-        int16_t lightmapIndex = mesh.polygons.lightmap_indices.at(faceIndex);
-        if (lightmapIndex != -1) {
-            zenkit::LightMap lightmap = mesh.lightmaps.at(lightmapIndex);
-            auto [u, v] = calculateLightmapUvs(lightmap.origin, lightmap.normals[0], lightmap.normals[1], posXm).vec;
-            float i = lightmap.texture_index;
-            return { u, v, i };
-        }
-        else {
-            return { 0, 0, -1 };
-        }
-    }
-
     // ###########################################################################
     // UTIL FUNCTIONS
     // ###########################################################################
 
-    template <VERTEX_FEATURE F>
-    void insertFace(Verts<F>& target, const array<VertexPos, 3>& facePos, const array<VertexNorUv, 3>& faceNormalUv, const array<F, 3>& faceOther) {
-        // manual reservation strategy helps with big vectors
-        // TODO find out what our actual memory problem is, we should be able to allocate 3.2G!! does DX11 driver take a lot?
-        if constexpr (manualReservation) {
-            uint32_t vertReserveCount = 200 * 3;
-            size_t blockSize = vertReserveCount;
-            size_t currentSize = target.vecPos.size();
-            if (currentSize == 0) {
-                target.vecPos.reserve(vertReserveCount);
-                target.vecNormalUv.reserve(vertReserveCount);
-                target.vecOther.reserve(vertReserveCount);
-            }
-            else if (currentSize >= (vertReserveCount * 128)) {
-                blockSize = vertReserveCount * 128;
-            }
-            else if (currentSize >= (vertReserveCount * 12)) {
-                blockSize = vertReserveCount * 48;
-            }
-            else if (currentSize >= (vertReserveCount * 4)) {
-                blockSize = vertReserveCount * 12;
-            }
-            else if (currentSize >= (vertReserveCount * 1)) {
-                blockSize = vertReserveCount * 4;
-            }
-            if (currentSize != 0 && currentSize % vertReserveCount == 0) {
-                uint32_t blocks = (currentSize / blockSize) + 1;
-                target.vecPos.reserve(blocks * blockSize);
-                target.vecNormalUv.reserve(blocks * blockSize);
-                target.vecOther.reserve(blocks * blockSize);
-            }
-        }
-        target.vecPos.push_back(facePos[0]);
-        target.vecPos.push_back(facePos[1]);
-        target.vecPos.push_back(facePos[2]);
-        target.vecNormalUv.push_back(faceNormalUv[0]);
-        target.vecNormalUv.push_back(faceNormalUv[1]);
-        target.vecNormalUv.push_back(faceNormalUv[2]);
-        target.vecOther.push_back(faceOther[0]);
-        target.vecOther.push_back(faceOther[1]);
-        target.vecOther.push_back(faceOther[2]);
-    }
-
     array<Vec3, 2> createVertlistBbox(const vector<VertexPos>& verts)
     {
         BoundingBox bbox;
@@ -415,13 +333,13 @@ namespace assets
         bool isLinear = blendType == BlendType::MULTIPLY;
 
         return Material {
-            .texBaseColor = getTexId(util::asciiToLower(material.texture)),
+            .texBaseColor = getTexId(material.texture),
             .blendType = blendType,
             .colorSpace = isLinear ? ColorSpace::LINEAR : ColorSpace::SRGB,
         };
     }
 
-    optional<Material> createMaterialDecal(const std::string textureName, const Decal& decal, bool debugChecksEnabled)
+    optional<Material> createMaterialDecal(std::string_view textureName, const Decal& decal, bool debugChecksEnabled)
     {
         if (debugChecksEnabled) {
             util::getOrCreateDefault(loadStats.materialAlphas, decal.alpha)++;
@@ -435,7 +353,7 @@ namespace assets
         bool isLinear = blendType == BlendType::MULTIPLY;
 
         return Material {
-            .texBaseColor = getTexId(util::asciiToLower(textureName)),
+            .texBaseColor = getTexId(textureName),
             .blendType = blendType,
             .colorSpace = isLinear ? ColorSpace::LINEAR : ColorSpace::SRGB,
         };
@@ -445,8 +363,8 @@ namespace assets
     // WORLD PACKING
     // ###########################################################################
 
-    template <VERTEX_FEATURE F>
-    uint32_t createIndicesAndRemap(Verts<F>& verts)
+    template <typename VERTS>
+    uint32_t createIndicesAndRemap(VERTS& verts)
     {
         uint32_t vertexCount = verts.vecPos.size();
         assert(verts.vecIndex.empty());
@@ -459,7 +377,7 @@ namespace assets
             meshopt::createStream(verts.vecOther)
         };
         auto remap = meshopt::generateIndicesRemap(vertexCount, streams);
-        verts.vecIndex = meshopt::createIndexBuffer(remap);
+        meshopt::createIndexBuffer(remap, verts.vecIndex);
         meshopt::remapVertexBuffer(verts.vecPos, remap);
         meshopt::remapVertexBuffer(verts.vecNormalUv, remap);
         meshopt::remapVertexBuffer(verts.vecOther, remap);
@@ -467,8 +385,8 @@ namespace assets
         return remap.vertCountRemapped;
     }
 
-    template <VERTEX_FEATURE F>
-    void optimizeIndicesAndVerts(Verts<F>& verts)
+    template <typename VERTS>
+    void optimizeIndicesAndVerts(VERTS& verts)
     {
         uint32_t vertexCount = verts.vecPos.size();
         assert(verts.vecIndex.size() >= vertexCount);
@@ -489,57 +407,378 @@ namespace assets
     // WORLD LOADING
     // ###########################################################################
 
-    Face loadWorldFace(
-        const zenkit::Mesh& mesh,
-        const Grid& grid,
-        uint32_t faceIndex,
-        uint32_t vertIndex,
-        bool debugChecksEnabled,
-        NormalsStats& normalStats)
+    // Temporary per-level loader data, released after level has been loaded.
+    util::Arena loadArena;
+
+    // Like Verts, but allocated from loadArena.
+    struct VertsTemp {
+        util::ArenaVector<VertexIndex> vecIndex;
+        util::ArenaVector<VertexPos> vecPos;
+        util::ArenaVector<VertexNorUv> vecNormalUv;
+        util::ArenaVector<VertexBasic> vecOther;
+
+        VertsTemp(util::Arena& arena, uint32_t vertCount) :
+            vecIndex(arena), vecPos(arena), vecNormalUv(arena), vecOther(arena)
+        {
+            vecPos.reserve(vertCount);
+            vecNormalUv.reserve(vertCount);
+            vecOther.reserve(vertCount);
+        }
+    };
+
+    void append(MeshDataBasic& target, const Material& material, GridPos gridPos, const VertsTemp& verts, bool indexed)
     {
-        // positions
-        auto facePosXm = facePosToXm<zenkit::Mesh, Unused, true, false>(mesh, {}, faceIndex, vertIndex);
+        uint32_t vertOffset = target.beginAppend(material, gridPos, indexed);
+        if (indexed) {
+            for (VertexIndex index : verts.vecIndex) {
+                target.vecIndex.push_back(vertOffset + index);
+            }
+        }
+        target.vecPos.insert(target.vecPos.end(), verts.vecPos.begin(), verts.vecPos.end());
+        target.vecNormalUv.insert(target.vecNormalUv.end(), verts.vecNormalUv.begin(), verts.vecNormalUv.end());
+        target.vecOther.insert(target.vecOther.end(), verts.vecOther.begin(), verts.vecOther.end());
+    }
 
-        // normals
-        array<XMVECTOR, 3> faceNormalsXm;
-        NormalsStats faceNormalStats;
-        if (debugChecksEnabled) {
-            std::tie(faceNormalStats, faceNormalsXm) = faceNormalsToXm<zenkit::Mesh, Unused, getNormalZkit, false, true>(
-                mesh, {}, vertIndex, facePosXm);
+    // If target is allocated from loadArena, it must already have enough capacity reserved (packing uses a nested arena scope).
+    template <bool IS_PACKED, typename ALLOC>
+    void appendNormalUvs(
+        std::vector<VertexNorUvTemplate<IS_PACKED>, ALLOC>& target,
+        std::span<const float> normalX, std::span<const float> normalY, std::span<const float> normalZ,
+        std::span<const float> uvU, std::span<const float> uvV)
+    {
+        uint32_t vertCount = normalX.size();
+        if constexpr (IS_PACKED) {
+            util::ArenaScope arenaScope(loadArena);
+            util::ArenaVector<uint32_t> normalsPacked(vertCount, loadArena);
+            util::ArenaVector<uint32_t> uvsPacked(vertCount, loadArena);
+            packNormals(normalX, normalY, normalZ, normalsPacked);
+            packUvs(uvU, uvV, uvsPacked);
+            for (uint32_t i = 0; i < vertCount; i++) {
+                target.push_back(VertexNorUvTemplate<true>::fromPacked(normalsPacked[i], uvsPacked[i]));
+            }
         }
         else {
-            std::tie(faceNormalStats, faceNormalsXm) = faceNormalsToXm<zenkit::Mesh, Unused, getNormalZkit, false, false>(
-                mesh, {}, vertIndex, facePosXm);
+            for (uint32_t i = 0; i < vertCount; i++) {
+                target.push_back({ Vec3 { normalX[i], normalY[i], normalZ[i] }, Uv { uvU[i], uvV[i] } });
+            }
         }
-        normalStats += faceNormalStats;
+    }
 
-        // other
-        array<VertexPos, 3> facePos;
-        array<VertexNorUv, 3> faceNormalUv;
-        array<VertexBasic, 3> faceOther;
+    template <bool IS_PACKED, typename ALLOC>
+    void appendLights(std::vector<VertexLightTemplate<IS_PACKED>, ALLOC>& target, const LightStreams& lights)
+    {
+        uint32_t vertCount = lights.type.size();
+        if constexpr (IS_PACKED) {
+            util::ArenaScope arenaScope(loadArena);
+            util::ArenaVector<uint32_t> packedFirst(vertCount, loadArena);
+            util::ArenaVector<uint32_t> packedSecond(vertCount, loadArena);
+            packLights(lights, packedFirst, packedSecond);
+            for (uint32_t i = 0; i < vertCount; i++) {
+                target.push_back(VertexLightTemplate<true>::fromPacked({ packedFirst[i], packedSecond[i] }));
+            }
+        }
+        else {
+            for (uint32_t i = 0; i < vertCount; i++) {
+                target.push_back({
+                    lights.type[i],
+                    Color(lights.colR[i], lights.colG[i], lights.colB[i], 1.f),
+                    { lights.lightmapU[i], lights.lightmapV[i], lights.lightmapI[i] },
+                    lights.instanceId[i],
+                });
+            }
+        }
+    }
 
-        for (uint32_t i = 0; i < 3; i++) {
-            VertexPos& pos = facePos.at(i);
-            pos = toVec3(facePosXm[i]);
+    void validateWorldMeshIndicesZkit(const zenkit::Mesh& mesh)
+    {
+        // indices are checked once, so that faces can be gathered without bounds checks
+        const auto& polygons = mesh.polygons;
+        size_t faceCount = polygons.material_indices.size();
+        if (polygons.vertex_indices.size() != faceCount * 3
+            || polygons.feature_indices.size() != faceCount * 3
+            || polygons.lightmap_indices.size() != faceCount) {
+            ::util::throwError("World mesh polygon lists have inconsistent sizes!");
+        }
+        for (auto index : polygons.vertex_indices) {
+            if (index >= mesh.vertices.size()) {
+                ::util::throwError("World mesh vertex index out of range!");
+            }
+        }
+        for (auto index : polygons.feature_indices) {
+            if (index >= mesh.features.size()) {
+                ::util::throwError("World mesh feature index out of range!");
+            }
+        }
+        for (auto index : polygons.lightmap_indices) {
+            if (index != -1 && (index < 0 || index >= (int64_t) mesh.lightmaps.size())) {
+                ::util::throwError("World mesh lightmap index out of range!");
+            }
+        }
+    }
 
-            const auto& featureZkit = mesh.features.at(mesh.polygons.feature_indices.at(vertIndex));
+    // Lightmap projections as SoA, so they can be gathered per vertex
+    struct LightmapsSoa {
+        vector<float> originX, originY, originZ;
+        vector<float> upX, upY, upZ;
+        vector<float> rightX, rightY, rightZ;
+        vector<float> texIndex;
+    };
 
-            faceNormalUv.at(i) = {
-                toVec3(faceNormalsXm[i]),
-                toUv(featureZkit.texture)
-            };
+    LightmapsSoa gatherLightmapsZkit(const zenkit::Mesh& mesh)
+    {
+        LightmapsSoa result;
+        for (const zenkit::LightMap& lightmap : mesh.lightmaps) {
+            result.originX.push_back(lightmap.origin.x);
+            result.originY.push_back(lightmap.origin.y);
+            result.originZ.push_back(lightmap.origin.z);
+            result.upX.push_back(lightmap.normals[0].x);
+            result.upY.push_back(lightmap.normals[0].y);
+            result.upZ.push_back(lightmap.normals[0].z);
+            result.rightX.push_back(lightmap.normals[1].x);
+            result.rightY.push_back(lightmap.normals[1].y);
+            result.rightZ.push_back(lightmap.normals[1].z);
+            result.texIndex.push_back((float) lightmap.texture_index);
+        }
+        return result;
+    }
 
-            Uvi lightmap = getLightmapUvsZkit(mesh, faceIndex, facePosXm[i]);
-            faceOther.at(i) = {
-                lightmap.i < 0 ? VertexLightType::WORLD_COLOR : VertexLightType::WORLD_LIGHTMAP,
-                fromSRGB(Color(featureZkit.light)),
-                lightmap,
-            };
+    // light colors are 8-bit sRGB, so conversion to linear is a lookup (same result as fromSRGB(Color(argb)))
+    const array<float, 256> srgbToLinear = []() -> array<float, 256> {
+        array<float, 256> result;
+        for (uint32_t i = 0; i < result.size(); i++) {
+            result[i] = fromSRGB((1.0f / 255.0f) * (float) i);
+        }
+        return result;
+    }();
+
+    // World faces of a single material as SoA. Vertex streams are corner-major: corner c of face f is stored at
+    // (c * faceStride + f), where faceStride is face count padded to a multiple of worldBatchSize (padding is zeroed).
+    constexpr uint32_t worldBatchSize = 8;
+
+    struct WorldFacesSoa {
+        uint32_t faceCount;
+        uint32_t faceStride;
+
+        util::ArenaVector<float> posX, posY, posZ;
+        util::ArenaVector<float> normalX, normalY, normalZ;
+        util::ArenaVector<float> uvU, uvV;
+        util::ArenaVector<uint32_t> colorArgb;
+        util::ArenaVector<float> colR, colG, colB;
+        util::ArenaVector<int32_t> lightmapIndex;// -1 if vertex is not lightmapped
+        util::ArenaVector<float> lightmapU, lightmapV, lightmapI;
+        util::ArenaVector<VertexLightType> lightType;
+        util::ArenaVector<uint32_t> instanceId;
+        util::ArenaVector<GridPos> gridPos;// per face
+
+        WorldFacesSoa(util::Arena& arena, uint32_t faceCount) :
+            faceCount(faceCount),
+            faceStride(((faceCount + worldBatchSize - 1) / worldBatchSize) * worldBatchSize),
+            posX(arena), posY(arena), posZ(arena), normalX(arena), normalY(arena), normalZ(arena), uvU(arena), uvV(arena),
+            colorArgb(arena), colR(arena), colG(arena), colB(arena),
+            lightmapIndex(arena), lightmapU(arena), lightmapV(arena), lightmapI(arena),
+            lightType(arena), instanceId(arena), gridPos(arena)
+        {
+            uint32_t vertCount = faceStride * 3;
+            for (auto* stream : { &posX, &posY, &posZ, &normalX, &normalY, &normalZ, &uvU, &uvV,
+                    &colR, &colG, &colB, &lightmapU, &lightmapV, &lightmapI }) {
+                stream->resize(vertCount, 0.f);
+            }
+            colorArgb.resize(vertCount, 0);
+            lightmapIndex.resize(vertCount, -1);
+            lightType.resize(vertCount, VertexLightType::WORLD_COLOR);
+            instanceId.resize(vertCount, instanceIdNone);
+            gridPos.resize(faceStride);
+        }
+
+        uint32_t vertCount() const
+        {
+            return faceStride * 3;
+        }
+        uint32_t vertIndex(uint32_t face, uint32_t corner) const
+        {
+            return corner * faceStride + face;
+        }
+    };
+
+    void gatherWorldFacesZkit(const zenkit::Mesh& mesh, const vector<uint32_t>& faceIndices, WorldFacesSoa& faces)
+    {
+        const auto& polygons = mesh.polygons;
+        for (uint32_t face = 0; face < faces.faceCount; face++) {
+            uint32_t faceZkit = faceIndices[face];
+            int32_t lightmapIndex = polygons.lightmap_indices[faceZkit];
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                uint32_t i = faces.vertIndex(face, corner);
+                const auto& pos = mesh.vertices[polygons.vertex_indices[faceZkit * 3 + corner]];
+                const auto& feature = mesh.features[polygons.feature_indices[faceZkit * 3 + corner]];
+                faces.posX[i] = pos.x;
+                faces.posY[i] = pos.y;
+                faces.posZ[i] = pos.z;
+                faces.normalX[i] = feature.normal.x;
+                faces.normalY[i] = feature.normal.y;
+                faces.normalZ[i] = feature.normal.z;
+                faces.uvU[i] = feature.texture.x;
+                faces.uvV[i] = feature.texture.y;
+                faces.colorArgb[i] = feature.light;
+                faces.lightmapIndex[i] = lightmapIndex;
+            }
+        }
+    }
 
-            vertIndex++;
+    void rescalePositions(WorldFacesSoa& faces)
+    {
+        for (auto* stream : { &faces.posX, &faces.posY, &faces.posZ }) {
+            for (float& value : *stream) {
+                value *= G_ASSET_RESCALE;
+            }
         }
-        GridPos gridPos = toGridPos(grid, centroidPos(facePosXm));
-        return { facePos, faceNormalUv, faceOther, gridPos };
+    }
+
+    void calculateLightmapUvs(const LightmapsSoa& lightmaps, WorldFacesSoa& faces)
+    {
+        uint32_t vertCount = faces.vertCount();
+        uint32_t i = 0;
+        // lightmap projection expects original scale
+        constexpr float undoRescale = 100.f;
+#ifdef __AVX2__
+        if (!lightmaps.texIndex.empty()) {
+            for (; i < vertCount; i += worldBatchSize) {
+                __m256i index = _mm256_loadu_si256((const __m256i*) &faces.lightmapIndex[i]);
+                __m256 hasLightmap = _mm256_castsi256_ps(_mm256_cmpgt_epi32(index, _mm256_set1_epi32(-1)));
+                auto gather = [&](const vector<float>& source) -> __m256 {
+                    return _mm256_mask_i32gather_ps(_mm256_setzero_ps(), source.data(), index, hasLightmap, 4);
+                };
+                __m256 dirX = _mm256_sub_ps(_mm256_mul_ps(_mm256_loadu_ps(&faces.posX[i]), _mm256_set1_ps(undoRescale)), gather(lightmaps.originX));
+                __m256 dirY = _mm256_sub_ps(_mm256_mul_ps(_mm256_loadu_ps(&faces.posY[i]), _mm256_set1_ps(undoRescale)), gather(lightmaps.originY));
+                __m256 dirZ = _mm256_sub_ps(_mm256_mul_ps(_mm256_loadu_ps(&faces.posZ[i]), _mm256_set1_ps(undoRescale)), gather(lightmaps.originZ));
+                __m256 u = _mm256_add_ps(_mm256_add_ps(
+                    _mm256_mul_ps(dirX, gather(lightmaps.rightX)), _mm256_mul_ps(dirY, gather(lightmaps.rightY))), _mm256_mul_ps(dirZ, gather(lightmaps.rightZ)));
+                __m256 v = _mm256_add_ps(_mm256_add_ps(
+                    _mm256_mul_ps(dirX, gather(lightmaps.upX)), _mm256_mul_ps(dirY, gather(lightmaps.upY))), _mm256_mul_ps(dirZ, gather(lightmaps.upZ)));
+                __m256 texIndex = _mm256_mask_i32gather_ps(_mm256_set1_ps(-1.f), lightmaps.texIndex.data(), index, hasLightmap, 4);
+
+                _mm256_storeu_ps(&faces.lightmapU[i], _mm256_and_ps(u, hasLightmap));
+                _mm256_storeu_ps(&faces.lightmapV[i], _mm256_and_ps(v, hasLightmap));
+                _mm256_storeu_ps(&faces.lightmapI[i], texIndex);
+            }
+        }
+#endif
+        for (; i < vertCount; i++) {
+            int32_t index = faces.lightmapIndex[i];
+            if (index >= 0) {
+                float dirX = faces.posX[i] * undoRescale - lightmaps.originX[index];
+                float dirY = faces.posY[i] * undoRescale - lightmaps.originY[index];
+                float dirZ = faces.posZ[i] * undoRescale - lightmaps.originZ[index];
+                faces.lightmapU[i] = dirX * lightmaps.rightX[index] + dirY * lightmaps.rightY[index] + dirZ * lightmaps.rightZ[index];
+                faces.lightmapV[i] = dirX * lightmaps.upX[index] + dirY * lightmaps.upY[index] + dirZ * lightmaps.upZ[index];
+                faces.lightmapI[i] = lightmaps.texIndex[index];
+            }
+            else {
+                faces.lightmapU[i] = 0;
+                faces.lightmapV[i] = 0;
+                faces.lightmapI[i] = -1;
+            }
+        }
+        for (i = 0; i < vertCount; i++) {
+            faces.lightType[i] = faces.lightmapIndex[i] >= 0 ? VertexLightType::WORLD_LIGHTMAP : VertexLightType::WORLD_COLOR;
+        }
+    }
+
+    void convertColors(WorldFacesSoa& faces)
+    {
+        uint32_t vertCount = faces.vertCount();
+        uint32_t i = 0;
+#ifdef __AVX2__
+        const __m256i channelMask = _mm256_set1_epi32(0xFF);
+        for (; i < vertCount; i += worldBatchSize) {
+            __m256i argb = _mm256_loadu_si256((const __m256i*) &faces.colorArgb[i]);
+            __m256i r = _mm256_and_si256(_mm256_srli_epi32(argb, 16), channelMask);
+            __m256i g = _mm256_and_si256(_mm256_srli_epi32(argb, 8), channelMask);
+            __m256i b = _mm256_and_si256(argb, channelMask);
+            _mm256_storeu_ps(&faces.colR[i], _mm256_i32gather_ps(srgbToLinear.data(), r, 4));
+            _mm256_storeu_ps(&faces.colG[i], _mm256_i32gather_ps(srgbToLinear.data(), g, 4));
+            _mm256_storeu_ps(&faces.colB[i], _mm256_i32gather_ps(srgbToLinear.data(), b, 4));
+        }
+#endif
+        for (; i < vertCount; i++) {
+            uint32_t argb = faces.colorArgb[i];
+            faces.colR[i] = srgbToLinear[(argb >> 16) & 0xFF];
+            faces.colG[i] = srgbToLinear[(argb >> 8) & 0xFF];
+            faces.colB[i] = srgbToLinear[argb & 0xFF];
+        }
+    }
+
+    // same as grid::getGridPosForPoint for face centroids
+    void assignGridCells(const Grid& grid, WorldFacesSoa& faces)
+    {
+        const float oneThird = 1.f / 3.f;
+        uint32_t stride = faces.faceStride;
+        uint32_t face = 0;
+#ifdef __AVX2__
+        auto toIndex = [&](__m256 coord, float min, float max) -> __m256i {
+            const __m256i indexMax = _mm256_set1_epi32(grid.cellCountXY - 1);
+            __m256 distanceNorm = _mm256_div_ps(_mm256_sub_ps(coord, _mm256_set1_ps(min)), _mm256_set1_ps(max - min));
+            __m256i index = _mm256_cvttps_epi32(_mm256_mul_ps(distanceNorm, _mm256_set1_ps(grid.cellCountXY)));
+            index = _mm256_min_epi32(index, indexMax);
+            index = _mm256_andnot_si256(_mm256_castps_si256(_mm256_cmp_ps(coord, _mm256_set1_ps(min), _CMP_LE_OQ)), index);
+            return _mm256_blendv_epi8(index, indexMax, _mm256_castps_si256(_mm256_cmp_ps(coord, _mm256_set1_ps(max), _CMP_GE_OQ)));
+        };
+        for (; face < stride; face += worldBatchSize) {
+            __m256 centerX = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(
+                _mm256_loadu_ps(&faces.posX[face]), _mm256_loadu_ps(&faces.posX[stride + face])), _mm256_loadu_ps(&faces.posX[stride * 2 + face])),
+                _mm256_set1_ps(oneThird));
+            __m256 centerZ = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(
+                _mm256_loadu_ps(&faces.posZ[face]), _mm256_loadu_ps(&faces.posZ[stride + face])), _mm256_loadu_ps(&faces.posZ[stride * 2 + face])),
+                _mm256_set1_ps(oneThird));
+
+            array<uint32_t, worldBatchSize> indexX;
+            array<uint32_t, worldBatchSize> indexY;
+            _mm256_storeu_si256((__m256i*) indexX.data(), toIndex(centerX, grid.boundsMin.x, grid.boundsMax.x));
+            _mm256_storeu_si256((__m256i*) indexY.data(), toIndex(centerZ, grid.boundsMin.y, grid.boundsMax.y));
+            for (uint32_t lane = 0; lane < worldBatchSize; lane++) {
+                faces.gridPos[face + lane] = { (uint16_t) indexX[lane], (uint16_t) indexY[lane] };
+            }
+        }
+#endif
+        for (; face < stride; face++) {
+            float centerX = (faces.posX[face] + faces.posX[stride + face] + faces.posX[stride * 2 + face]) * oneThird;
+            float centerZ = (faces.posZ[face] + faces.posZ[stride + face] + faces.posZ[stride * 2 + face]) * oneThird;
+            faces.gridPos[face] = grid::getGridPosForPoint(grid, { centerX, centerZ });
+        }
+    }
+
+    NormalsStats validateNormals(WorldFacesSoa& faces)
+    {
+        // zero normals are replaced with flat face normal
+        NormalsStats normalStats;
+        for (uint32_t face = 0; face < faces.faceCount; face++) {
+            array<XMVECTOR, 3> facePosXm;
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                uint32_t i = faces.vertIndex(face, corner);
+                facePosXm[corner] = XMVectorSet(faces.posX[i], faces.posY[i], faces.posZ[i], 1.f);
+            }
+            XMVECTOR flatNormalXm = calcFlatFaceNormal(facePosXm);
+
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                uint32_t i = faces.vertIndex(face, corner);
+                XMVECTOR normalXm = XMVectorSet(faces.normalX[i], faces.normalY[i], faces.normalZ[i], 1.f);
+                normalStats.total++;
+                if (isZero(normalXm, zeroThreshold)) {
+                    normalXm = flatNormalXm;
+                    faces.normalX[i] = XMVectorGetX(normalXm);
+                    faces.normalY[i] = XMVectorGetY(normalXm);
+                    faces.normalZ[i] = XMVectorGetZ(normalXm);
+                    normalStats.zero++;
+                }
+                else {
+                    warnIfNotNormalized(normalXm);
+                }
+                float normalFlatnessRadian = XMVectorGetX(XMVector3AngleBetweenNormals(flatNormalXm, normalXm));
+                if (normalFlatnessRadian * (180.f / 3.141592653589793238463f) > 90) {
+                    normalStats.extreme++;
+                }
+            }
+        }
+        return normalStats;
     }
 
     array<Vec2, 2> calculateBbox2d(const vector<glm::vec3>& verts)
@@ -555,7 +794,7 @@ namespace assets
     }
 
     Grid loadWorldMeshActual(
-        MatToChunksToVertsBasic& target,
+        MeshDataBasic& target,
         const zenkit::Mesh& worldMesh,
         bool indexed,
         bool debugChecksEnabled)
@@ -599,69 +838,93 @@ namespace assets
             }
         }
 
+        validateWorldMeshIndicesZkit(worldMesh);
+        const LightmapsSoa lightmaps = gatherLightmapsZkit(worldMesh);
+
         // Per material: load vertex data and calculate chunkIndex
         for (auto& [material, faceIndices] : matToFaceIndex) {
+            util::ArenaScope arenaScope(loadArena);
             uint32_t faceCountMat = faceIndices.size();
-            uint32_t vertexCountMat = faceCountMat * 3;
 
-            auto [it, wasInserted] = target.try_emplace(material);
-            assert(wasInserted);
-            unordered_map<GridPos, VertsBasic>& chunks = it->second;
+            // Convert all faces of this material in batches, each pass over a single attribute
+            WorldFacesSoa faces(loadArena, faceCountMat);
+            gatherWorldFacesZkit(worldMesh, faceIndices, faces);
+            rescalePositions(faces);
+            if (debugChecksEnabled) {
+                normalStats += validateNormals(faces);
+            }
+            calculateLightmapUvs(lightmaps, faces);
+            convertColors(faces);
+            assignGridCells(grid, faces);
+
+            util::ArenaVector<VertexNorUv> normalUvs(loadArena);
+            normalUvs.reserve(faces.vertCount());
+            appendNormalUvs(normalUvs, faces.normalX, faces.normalY, faces.normalZ, faces.uvU, faces.uvV);
+
+            util::ArenaVector<VertexBasic> lights(loadArena);
+            lights.reserve(faces.vertCount());
+            appendLights(lights, {
+                .type = faces.lightType,
+                .colR = faces.colR, .colG = faces.colG, .colB = faces.colB,
+                .lightmapU = faces.lightmapU, .lightmapV = faces.lightmapV, .lightmapI = faces.lightmapI,
+                .instanceId = faces.instanceId,
+            });
+
+            // Find cell of each face, so we can allocate exact per-cell buffers. Cells are kept in order
+            // of first occurence to keep output independent of hash map iteration order.
+            util::ArenaVector<uint32_t> faceToCell(loadArena);
+            faceToCell.reserve(faceCountMat);
+            unordered_map<GridPos, uint32_t> cellIndices;
+            vector<pair<GridPos, uint32_t>> cellFaceCounts;
+
+            for (uint32_t i = 0; i < faceCountMat; i++) {
+                GridPos gridPos = faces.gridPos[i];
+                auto [it, wasInserted] = cellIndices.try_emplace(gridPos, (uint32_t) cellFaceCounts.size());
+                if (wasInserted) {
+                    cellFaceCounts.push_back({ gridPos, 0 });
+                }
+                cellFaceCounts[it->second].second++;
+                faceToCell.push_back(it->second);
+            }
 
             // In theory we could write all data to target (chunks) directly for world mesh, because worldmesh
             // is only loaded once, but to keep things consistent with VOB loading, we use temporary buffers here also.
-            unordered_map<GridPos, VertsBasic> chunksTemp;
-
-            // Create vertex data and group by chunkIndex
-            for (uint32_t i = 0; i < faceCountMat; i++)
-            {
-                uint32_t currentFace = faceIndices.at(i);
-                uint32_t currentVert = currentFace * 3;
+            vector<VertsTemp> cellsTemp;
+            cellsTemp.reserve(cellFaceCounts.size());
+            for (auto& [gridPos, faceCount] : cellFaceCounts) {
+                cellsTemp.emplace_back(loadArena, faceCount * 3);
+            }
 
-                const Face face = loadWorldFace(worldMesh, grid, currentFace, currentVert, debugChecksEnabled, normalStats);
-                auto [it, wasInserted] = chunksTemp.try_emplace(face.gridPos);
-                auto& vertsTemp = it->second;
-                if (wasInserted) {
-                    // initialize with space relative to full material data to hopefully keep resizing reallocations low
-                    uint32_t estimatedPerChunkSize = vertexCountMat * .25f + 1;
-                    vertsTemp.vecPos.reserve(estimatedPerChunkSize);
-                    vertsTemp.vecNormalUv.reserve(estimatedPerChunkSize);
-                    vertsTemp.vecOther.reserve(estimatedPerChunkSize);
+            for (uint32_t i = 0; i < faceCountMat; i++) {
+                VertsTemp& vertsTemp = cellsTemp[faceToCell[i]];
+                for (uint32_t corner = 0; corner < 3; corner++) {
+                    uint32_t vertIndex = faces.vertIndex(i, corner);
+                    vertsTemp.vecPos.push_back({ faces.posX[vertIndex], faces.posY[vertIndex], faces.posZ[vertIndex] });
+                    vertsTemp.vecNormalUv.push_back(normalUvs[vertIndex]);
+                    vertsTemp.vecOther.push_back(lights[vertIndex]);
                 }
-                insertFace(vertsTemp, face.pos, face.normalUv, face.features);// maybe use struct Face as parameter directly?
             }
 
             // Per material and chunkIndex: generate indices and optimize vertex and index data with meshoptimizer
-            for (auto& [chunkIndex, vertsTemp] : chunksTemp) {
+            for (uint32_t cellIndex = 0; cellIndex < cellsTemp.size(); cellIndex++) {
+                GridPos chunkIndex = cellFaceCounts[cellIndex].first;
+                VertsTemp& vertsTemp = cellsTemp[cellIndex];
+                assert(vertsTemp.vecPos.size() == cellFaceCounts[cellIndex].second * 3);
+
                 // update grid bbox
                 grid::updateBounds(grid, chunkIndex, createBboxFromPoints(vertsTemp.vecPos));
 
-                uint32_t vertexCount = vertsTemp.vecPos.size();
-
                 // Create indices to reduce vertexCount, optimize
                 if (indexed) {
-                    uint32_t indexCount = vertexCount;
-                    vertexCount = createIndicesAndRemap(vertsTemp);
+                    createIndicesAndRemap(vertsTemp);
                     if (meshoptOptimize) {
                         optimizeIndicesAndVerts(vertsTemp);
                     }
                 }
-
-                auto [it, wasInserted] = chunks.try_emplace(chunkIndex);
-                assert(wasInserted);
-                VertsBasic& verts = it->second;
-                    
-                if (indexed) {
-                    verts.useIndices = true;
-                    verts.vecIndex = std::move(vertsTemp.vecIndex);
-                    verts.vecIndexLod = std::move(vertsTemp.vecIndexLod);
-                }
-                // we copy vertex data so we don't have to shrink_to_fit (since initial capacity was just a guess)
-                verts.vecPos = vertsTemp.vecPos;
-                verts.vecNormalUv = vertsTemp.vecNormalUv;
-                verts.vecOther = vertsTemp.vecOther;
+                append(target, material, chunkIndex, vertsTemp, indexed);
             }
         }
+        target.finalize();
 
         if (debugChecksEnabled) {
             loadStats.normalsWorldMesh = normalStats;
@@ -670,7 +933,7 @@ namespace assets
     }
 
     Grid loadWorldMesh(
-        MatToChunksToVertsBasic& target,
+        MeshDataBasic& target,
         const zenkit::Mesh& worldMesh,
         bool indexed,
         bool debugChecksEnabled)
@@ -737,7 +1000,7 @@ namespace assets
 
     optional<unordered_map<Material, VertsPrecomp>> precompute(
         const zenkit::MultiResolutionMesh& mesh,
-        const string& visualName,
+        std::string_view visualName,
         bool debugChecksEnabled)
     {
         if (mesh.sub_meshes.size() == 0) {
@@ -746,29 +1009,42 @@ namespace assets
         }
 
         NormalsStats normalStats;
-        bool createNormalStats = debugChecksEnabled && !util::hasKey(loadStats.normalsInstances, visualName);
+        bool createNormalStats = debugChecksEnabled && !util::hasKey(loadStats.normalsInstances, string(visualName));
 
-        unordered_map<Material, VertsPrecomp> result;
+        // First pass: resolve materials and count verts per material, since multiple submeshes can share a material
+        vector<optional<Material>> submeshMaterials;
+        submeshMaterials.reserve(mesh.sub_meshes.size());
+        unordered_map<Material, uint32_t> vertexCounts;
 
         for (const auto& submesh : mesh.sub_meshes) {
-            zenkit::Material meshMat = submesh.mat;
-            if (meshMat.texture.empty() && !util::hasKey(loadStats.skippedNoTexSubmeshInstances, visualName)) {
-                loadStats.skippedNoTexSubmeshInstances[visualName] = true;
+            const zenkit::Material& meshMat = submesh.mat;
+            if (meshMat.texture.empty() && !util::hasKey(loadStats.skippedNoTexSubmeshInstances, string(visualName))) {
+                loadStats.skippedNoTexSubmeshInstances[string(visualName)] = true;
+                submeshMaterials.push_back(std::nullopt);
                 continue;
             }
             const optional<Material> materialOpt = createMaterial(meshMat, debugChecksEnabled);
+            if (materialOpt.has_value()) {
+                vertexCounts[materialOpt.value()] += submesh.triangles.size() * 3;
+            }
+            submeshMaterials.push_back(materialOpt);
+        }
+
+        unordered_map<Material, VertsPrecomp> result;
+        for (auto& [material, vertexCount] : vertexCounts) {
+            result[material].reserve(vertexCount);
+        }
+
+        // Second pass: create vertex data
+        for (uint32_t submeshIndex = 0; submeshIndex < mesh.sub_meshes.size(); submeshIndex++) {
+            const auto& submesh = mesh.sub_meshes[submeshIndex];
+            const optional<Material>& materialOpt = submeshMaterials[submeshIndex];
             if (!materialOpt.has_value()) {
                 continue;
             }
 
             uint32_t faceCountMat = submesh.triangles.size();
-            uint32_t vertexCountMat = faceCountMat * 3;
-
-            auto [it, wasInserted] = result.try_emplace(materialOpt.value());
-            auto& verts = it->second;
-            if (wasInserted) {
-                verts.reserve(verts.size() + vertexCountMat);
-            }
+            auto& verts = result.at(materialOpt.value());
 
             for (uint32_t currentFace = 0, currentVert = 0;
                 currentFace < faceCountMat;
@@ -788,12 +1064,45 @@ namespace assets
     // VOB PACKING
     // ###########################################################################
 
+    // Verts as SoA streams, padded with zeroes to a multiple of transformBatchSize, so they can be transformed in batches
+    constexpr uint32_t transformBatchSize = 8;
+
+    struct VertsSoa {
+        uint32_t count = 0;
+        vector<float> posX, posY, posZ;
+        vector<float> normalX, normalY, normalZ;
+        vector<float> uvU, uvV;
+    };
+
     struct VertsPacked {
-        VertsPrecomp vertsPacked;
+        VertsPrecomp vertsPacked;// only needed until indices are created, released by convertToSoa
         vector<VertexIndex> indices;
         vector<VertexIndex> indicesLod;
+        VertsSoa vertsSoa;
     };
 
+    void convertToSoa(VertsPacked& verts)
+    {
+        VertsSoa& soa = verts.vertsSoa;
+        soa.count = verts.vertsPacked.size();
+        uint32_t paddedCount = ((soa.count + transformBatchSize - 1) / transformBatchSize) * transformBatchSize;
+        for (auto* stream : { &soa.posX, &soa.posY, &soa.posZ, &soa.normalX, &soa.normalY, &soa.normalZ, &soa.uvU, &soa.uvV }) {
+            stream->assign(paddedCount, 0.f);
+        }
+        for (uint32_t i = 0; i < soa.count; i++) {
+            const VertexPrecomp& vert = verts.vertsPacked[i];
+            soa.posX[i] = vert.pos.x;
+            soa.posY[i] = vert.pos.y;
+            soa.posZ[i] = vert.pos.z;
+            soa.normalX[i] = vert.normal.x;
+            soa.normalY[i] = vert.normal.y;
+            soa.normalZ[i] = vert.normal.z;
+            soa.uvU[i] = vert.uvColor.u;
+            soa.uvV[i] = vert.uvColor.v;
+        }
+        verts.vertsPacked = {};
+    }
+
     vector<VertexIndex> createIndicesAndRemap(VertsPrecomp& verts)
     {
         array streams = { meshopt::createStream(verts) };
@@ -831,175 +1140,204 @@ namespace assets
         return result;
     }
 
-    // TODO maybe debug stats should be part of value
-    unordered_map<uint32_t, unordered_map<Material, VertsPacked>> cacheMeshes;
-
-    unordered_map<Material, VertsPacked>& getOrPrecompute(
-        uint32_t meshId, bool indexed, bool generateLod, float bboxMaxDim, std::function<optional<unordered_map<Material, VertsPrecomp>>()> precompute)
+    unordered_map<Material, VertsPacked> precomputePacked(
+        bool indexed, bool generateLod, float bboxMaxDim, std::function<optional<unordered_map<Material, VertsPrecomp>>()> precompute)
     {
-        // get cached vertex attributes and index buffers, or init cache
-        auto [it, wasInserted] = cacheMeshes.try_emplace(meshId);
-        unordered_map<Material, VertsPacked>& cachedVerts = it->second;
-        if (wasInserted) {
-            optional<unordered_map<Material, VertsPrecomp>> preVertsOpt = precompute();
-            if (preVertsOpt.has_value()) {
-                for (auto& [material, verts] : preVertsOpt.value()) {
-                    if (indexed) {
-                        cachedVerts.emplace(material, std::move(indexAndOptimize(verts, generateLod, bboxMaxDim)));
-                    }
-                    else {
-                        cachedVerts.emplace(material, VertsPacked{ .vertsPacked = std::move(verts) });
-                    }
-                }
+        unordered_map<Material, VertsPacked> result;
+        optional<unordered_map<Material, VertsPrecomp>> preVertsOpt = precompute();
+        if (preVertsOpt.has_value()) {
+            for (auto& [material, verts] : preVertsOpt.value()) {
+                VertsPacked packed = indexed
+                    ? indexAndOptimize(verts, generateLod, bboxMaxDim)
+                    : VertsPacked{ .vertsPacked = std::move(verts) };
+                convertToSoa(packed);
+                result.emplace(material, std::move(packed));
             }
         }
-        return cachedVerts;
+        return result;
     }
 
     // ###########################################################################
     // VOB LOADING
     // ###########################################################################
 
-    struct Vertex {
-        VertexPos pos;
-        VertexNorUv normalUv;
-        VertexBasic other;
+
+    struct VertsTransformed {
+        std::span<float> posX, posY, posZ;
+        std::span<float> normalX, normalY, normalZ;
     };
 
-    template <bool transform>
-    Vertex finalizeCompressVertex(
-        const VertexPrecomp& vert,
-        const StaticInstance& instance,
-        bool isDecal,
-        OPT_PARAM<transform, const XMMATRIX&> posTransform,
-        OPT_PARAM<transform, const XMMATRIX&> normalTransform)
+    // Same as XMVector4Transform (with w = 1) for positions and XMVector3TransformNormal + XMVector3Normalize for normals.
+    // Target streams must have the same padded size as the source streams.
+    void transformVerts(const VertsSoa& verts, const XMMATRIX& transform, const VertsTransformed& target)
     {
-        // TODO compress further by quantizing to necessary bits
-        Vertex result;
-
-        XMFLOAT4 pos = vert.pos;
-        if constexpr (transform) {
-            XMVECTOR posXm = XMVector4Transform(XMLoadFloat4(&pos), posTransform);
-            XMStoreFloat4(&pos, posXm);
+        XMFLOAT4X4 m;
+        XMStoreFloat4x4(&m, transform);
+        uint32_t paddedCount = verts.posX.size();
+#ifdef __AVX2__
+        auto dot3 = [](__m256 x, __m256 y, __m256 z, float mx, float my, float mz) -> __m256 {
+            return _mm256_add_ps(_mm256_add_ps(
+                _mm256_mul_ps(x, _mm256_set1_ps(mx)), _mm256_mul_ps(y, _mm256_set1_ps(my))), _mm256_mul_ps(z, _mm256_set1_ps(mz)));
+        };
+        for (uint32_t i = 0; i < paddedCount; i += transformBatchSize) {
+            __m256 x = _mm256_loadu_ps(&verts.posX[i]);
+            __m256 y = _mm256_loadu_ps(&verts.posY[i]);
+            __m256 z = _mm256_loadu_ps(&verts.posZ[i]);
+            _mm256_storeu_ps(&target.posX[i], _mm256_add_ps(dot3(x, y, z, m._11, m._21, m._31), _mm256_set1_ps(m._41)));
+            _mm256_storeu_ps(&target.posY[i], _mm256_add_ps(dot3(x, y, z, m._12, m._22, m._32), _mm256_set1_ps(m._42)));
+            _mm256_storeu_ps(&target.posZ[i], _mm256_add_ps(dot3(x, y, z, m._13, m._23, m._33), _mm256_set1_ps(m._43)));
+
+            x = _mm256_loadu_ps(&verts.normalX[i]);
+            y = _mm256_loadu_ps(&verts.normalY[i]);
+            z = _mm256_loadu_ps(&verts.normalZ[i]);
+            __m256 normalX = dot3(x, y, z, m._11, m._21, m._31);
+            __m256 normalY = dot3(x, y, z, m._12, m._22, m._32);
+            __m256 normalZ = dot3(x, y, z, m._13, m._23, m._33);
+
+            // zero length normals stay zero like with XMVector3Normalize
+            __m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(
+                _mm256_mul_ps(normalX, normalX), _mm256_mul_ps(normalY, normalY)), _mm256_mul_ps(normalZ, normalZ)));
+            __m256 isNonZero = _mm256_cmp_ps(length, _mm256_setzero_ps(), _CMP_GT_OQ);
+            _mm256_storeu_ps(&target.normalX[i], _mm256_and_ps(_mm256_div_ps(normalX, length), isNonZero));
+            _mm256_storeu_ps(&target.normalY[i], _mm256_and_ps(_mm256_div_ps(normalY, length), isNonZero));
+            _mm256_storeu_ps(&target.normalZ[i], _mm256_and_ps(_mm256_div_ps(normalZ, length), isNonZero));
         }
-        XMFLOAT4 normal = vert.normal;
-        if constexpr (transform) {
-            XMVECTOR normalXm = XMVector3TransformNormal(XMLoadFloat4(&normal), normalTransform);
+#else
+        for (uint32_t i = 0; i < paddedCount; i++) {
+            XMVECTOR posXm = XMVector4Transform(XMVectorSet(verts.posX[i], verts.posY[i], verts.posZ[i], 1.f), transform);
+            XMVECTOR normalXm = XMVector3TransformNormal(XMVectorSet(verts.normalX[i], verts.normalY[i], verts.normalZ[i], 0.f), transform);
             normalXm = XMVector3Normalize(normalXm);
-            XMStoreFloat4(&normal, normalXm);
+            target.posX[i] = XMVectorGetX(posXm);
+            target.posY[i] = XMVectorGetY(posXm);
+            target.posZ[i] = XMVectorGetZ(posXm);
+            target.normalX[i] = XMVectorGetX(normalXm);
+            target.normalY[i] = XMVectorGetY(normalXm);
+            target.normalZ[i] = XMVectorGetZ(normalXm);
         }
-
-        result.pos = toVec3(pos);
-        auto normalVec3 = toVec3(normal);
-        result.normalUv = {
-            normalVec3,
-            vert.uvColor,
-        };
-        result.other = {
-            isDecal ? VertexLightType::OBJECT_DECAL : VertexLightType::OBJECT_COLOR,
-            instance.lighting.color,
-            { 0, 0, -1 },
-            instance.id,
-        };
-        return result;
+#endif
     }
 
     void instantiateAndInsert(
-        MatToChunksToVertsBasic& target,
+        MeshDataBasic& target,
         const GridPos& gridPos,
         const unordered_map<Material, VertsPacked>& verts,
         const StaticInstance& instance,
+        const XMMATRIX& transform,
         bool isDecal)
     {
-        uint32_t minReserve = 300;// TODO print stats about how much index buffer an LOD reduce vert count
+        // light is identical for all verts of an instance, so we only compress it once
+        const VertexBasic other = {
+            isDecal ? VertexLightType::OBJECT_DECAL : VertexLightType::OBJECT_COLOR,
+            instance.lighting.color,
+            { 0, 0, -1 },
+            instance.id,
+        };
 
         // transform pos/normal, compress and copy into target buffer
         for (auto& [material, packed] : verts) {
             bool indexed = !packed.indices.empty();
-            auto& chunks = util::getOrCreateDefault(target, material);
-            auto [it, wasInserted] = chunks.try_emplace(gridPos);
-            VertsBasic& targetVerts = it->second;
-            if (wasInserted) {
-                targetVerts.useIndices = indexed;
-                if (indexed) {
-                    targetVerts.vecIndex.reserve(minReserve);
-                    targetVerts.vecIndexLod.reserve(minReserve * 0.8f);
-                }
-                targetVerts.vecPos.reserve(minReserve * 0.7f);
-                targetVerts.vecNormalUv.reserve(minReserve * 0.7f);
-                targetVerts.vecOther.reserve(minReserve * 0.7f);
-            }
-            assert(targetVerts.useIndices == indexed);
+            uint32_t vertOffset = target.beginAppend(material, gridPos, indexed);
 
             if (indexed) {
-                uint32_t vertOffset = targetVerts.vecPos.size();
                 for (uint32_t index : packed.indices) {
-                    targetVerts.vecIndex.push_back(vertOffset + index);
+                    target.vecIndex.push_back(vertOffset + index);
                 }
                 for (uint32_t index : packed.indicesLod) {
-                    targetVerts.vecIndexLod.push_back(vertOffset + index);
+                    target.vecIndexLod.push_back(vertOffset + index);
                 }
             }
 
-            uint32_t vertCount = packed.vertsPacked.size();
-            for (const VertexPrecomp& vert : packed.vertsPacked) {
-                auto [pos, normalUv, other] = finalizeCompressVertex<true>(vert, instance, isDecal, instance.transform, instance.transform);
-                targetVerts.vecPos.push_back(pos);
-                targetVerts.vecNormalUv.push_back(normalUv);
-                targetVerts.vecOther.push_back(other);
+            const VertsSoa& soa = packed.vertsSoa;
+            uint32_t paddedCount = soa.posX.size();
+
+            util::ArenaScope arenaScope(loadArena);
+            util::ArenaVector<float> streams(paddedCount * 6, loadArena);
+            VertsTransformed transformed = {
+                .posX = { streams.data() + paddedCount * 0, paddedCount },
+                .posY = { streams.data() + paddedCount * 1, paddedCount },
+                .posZ = { streams.data() + paddedCount * 2, paddedCount },
+                .normalX = { streams.data() + paddedCount * 3, paddedCount },
+                .normalY = { streams.data() + paddedCount * 4, paddedCount },
+                .normalZ = { streams.data() + paddedCount * 5, paddedCount },
+            };
+            transformVerts(soa, transform, transformed);
+
+            for (uint32_t i = 0; i < soa.count; i++) {
+                target.vecPos.push_back({ transformed.posX[i], transformed.posY[i], transformed.posZ[i] });
             }
+            appendNormalUvs(target.vecNormalUv,
+                transformed.normalX.first(soa.count), transformed.normalY.first(soa.count), transformed.normalZ.first(soa.count),
+                std::span(soa.uvU).first(soa.count), std::span(soa.uvV).first(soa.count));
+            target.vecOther.insert(target.vecOther.end(), soa.count, other);
         }
     }
 
-    void loadInstanceMesh(
-        MatToChunksToVertsBasic& target,
+    GridPos placeInstance(Grid& grid, const StaticInstance& instance)
+    {
+        XMVECTOR centerXm = bboxCenter(instance.bbox);
+        XMVECTOR halfWidthXm = centerXm - instance.bbox[0];
+
+        GridPos gridPos = toGridPos(grid, centerXm);
+        grid::updateBounds(grid, gridPos, BoundingBox(toFloat3(centerXm), toFloat3(halfWidthXm)));
+        return gridPos;
+    }
+
+    // single mesh of a visual, transform is relative to instance
+    struct VisualSubmesh {
+        const zenkit::MultiResolutionMesh* mesh;
+        XMMATRIX transform;
+    };
+
+    void loadInstanceSubmeshes(
+        MeshDataBasic& target,
         Grid& grid,
-        const zenkit::MultiResolutionMesh& mesh,
-        const StaticInstance& instance,
-        uint32_t submeshId,
+        std::span<const VisualSubmesh> submeshes,
+        std::string_view visualName,
+        std::span<const StaticInstance> instances,
         bool indexed,
         bool debugChecksEnabled)
     {
-        // TODO we cannot just pass all instances of a single visual at once because one visual model
-        // might have several meshes. But cache should be cleared after every single-mesh or model.
+        assert(!instances.empty());
 
-        NormalsStats normalStats;
-        bool createNormalStats = debugChecksEnabled && !util::hasKey(loadStats.normalsInstances, instance.visual_name);
-
-        size_t hash = 0;
-        util::hashCombine(hash, instance.visual_name);
-        util::hashCombine(hash, submeshId);
+        // instances are only placed into grid if visual has any geometry
+        vector<GridPos> gridPositions;
 
-        // oriented bb might be tighter than aabb, so we don't use instance.bbox here
-        Vec3 halfWidth = toVec3(mesh.obbox.half_width);
-        float bboxMaxDim = std::max(std::max(halfWidth.x, halfWidth.y), halfWidth.z) * 2 * G_ASSET_RESCALE;
+        for (const auto& [mesh, transformSubmesh] : submeshes) {
+            // oriented bb might be tighter than aabb, so we don't use instance.bbox here
+            Vec3 halfWidth = toVec3(mesh->obbox.half_width);
+            float bboxMaxDim = std::max(std::max(halfWidth.x, halfWidth.y), halfWidth.z) * 2 * G_ASSET_RESCALE;
 
-        unordered_map<Material, VertsPacked>& cachedVerts = getOrPrecompute((uint32_t)hash, indexed, true, bboxMaxDim, [&]() {
-            return precompute(mesh, instance.visual_name, debugChecksEnabled);
-        });
-        
-        if (cachedVerts.empty()) {
-            return;
+            // all instances of this visual are created from these verts, so they are released (evicted) afterwards
+            unordered_map<Material, VertsPacked> verts = precomputePacked(indexed, true, bboxMaxDim, [&]() {
+                return precompute(*mesh, visualName, debugChecksEnabled);
+            });
+            if (verts.empty()) {
+                continue;
+            }
+            if (gridPositions.empty()) {
+                for (const StaticInstance& instance : instances) {
+                    gridPositions.push_back(placeInstance(grid, instance));
+                }
+            }
+            for (uint32_t i = 0; i < instances.size(); i++) {
+                const StaticInstance& instance = instances[i];
+                XMMATRIX transform = XMMatrixMultiply(transformSubmesh, instance.transform);
+                instantiateAndInsert(target, gridPositions[i], verts, instance, transform, false);
+            }
         }
-
-        XMVECTOR centerXm = bboxCenter(instance.bbox);
-        XMVECTOR halfWidthXm = centerXm - instance.bbox[0];
-
-        GridPos gridPos = toGridPos(grid, centerXm);
-        grid::updateBounds(grid, gridPos, BoundingBox(toFloat3(centerXm), toFloat3(halfWidthXm)));
-        instantiateAndInsert(target, gridPos, cachedVerts, instance, false);
     }
 
     void loadInstanceMesh(
-        MatToChunksToVertsBasic& target,
+        MeshDataBasic& target,
         Grid& grid,
         const zenkit::MultiResolutionMesh& mesh,
-        const StaticInstance& instance,
+        std::string_view visualName,
+        std::span<const StaticInstance> instances,
         bool indexed,
         bool debugChecksEnabled)
     {
-        // TODO pass all instances of a single mesh together here so we can clear mesh cache after all are done
-        loadInstanceMesh(target, grid, mesh, instance, 0, indexed, debugChecksEnabled);
+        array submeshes = { VisualSubmesh { &mesh, identity } };
+        loadInstanceSubmeshes(target, grid, submeshes, visualName, instances, indexed, debugChecksEnabled);
     }
 
     XMMATRIX rescale(const XMMATRIX& transform)
@@ -1012,25 +1350,24 @@ namespace assets
     }
 
     void loadInstanceModel(
-        MatToChunksToVertsBasic& target,
+        MeshDataBasic& target,
         Grid& grid,
         const zenkit::ModelHierarchy& hierarchy,
         const zenkit::ModelMesh& model,
-        const StaticInstance& instance,
+        std::string_view visualName,
+        std::span<const StaticInstance> instances,
         bool indexed,
         bool debugChecksEnabled)
     {
-        // TODO pass all instances of a single model together here so we can clear mesh cache after all are done
-        uint32_t meshId = 0;
+        // transforms of meshes relative to instance are identical for all instances of a model
+        vector<VisualSubmesh> submeshes;
 
         // It's unclear why negation is needed and if only z component or other components needs to be negated as well.
         // If z is not negated, shisha's in Gomez' throneroom (G1) are not placed correctly.
         XMMATRIX transformRoot = XMMatrixTranslationFromVector(toXM4Dir(hierarchy.root_translation) * -1 * G_ASSET_RESCALE);
         for (const auto& mesh : model.meshes) {
             // TODO softskin animation
-            StaticInstance newInstance = instance;
-            newInstance.transform = XMMatrixMultiply(transformRoot, instance.transform);
-            loadInstanceMesh(target, grid, mesh.mesh, newInstance, meshId++, indexed, debugChecksEnabled);
+            submeshes.push_back({ &mesh.mesh, transformRoot });
         }
 
         unordered_map<string, uint32_t> attachmentToNode;
@@ -1051,11 +1388,10 @@ namespace assets
                 node = &parent;
             }
             // rootNode translation is not applied to attachments (example: see kettledrum placement on oldcamp music stage)
-
-            StaticInstance newInstance = instance;
-            newInstance.transform = XMMatrixMultiply(transform, instance.transform);
-            loadInstanceMesh(target, grid, mesh, newInstance, meshId++, indexed, debugChecksEnabled);
+            submeshes.push_back({ &mesh, transform });
         }
+
+        loadInstanceSubmeshes(target, grid, submeshes, visualName, instances, indexed, debugChecksEnabled);
     }
 
     VertsPrecomp precomputeDecal(const Decal& decal)
@@ -1089,40 +1425,85 @@ namespace assets
         return result;
     }
 
+    struct DecalKey {
+        Vec2 quadSize;
+        Uv uvOffset;
+        bool twoSided;
+        Material material;
+        bool indexed;
+
+        bool operator==(const DecalKey& other) const
+        {
+            return quadSize.x == other.quadSize.x && quadSize.y == other.quadSize.y
+                && uvOffset.u == other.uvOffset.u && uvOffset.v == other.uvOffset.v
+                && twoSided == other.twoSided && material == other.material && indexed == other.indexed;
+        }
+
+        struct Hash
+        {
+            size_t operator()(const DecalKey& key) const
+            {
+                size_t res = 0;
+                ::util::hashCombine(res, key.quadSize.x);
+                ::util::hashCombine(res, key.quadSize.y);
+                ::util::hashCombine(res, key.uvOffset.u);
+                ::util::hashCombine(res, key.uvOffset.v);
+                ::util::hashCombine(res, key.twoSided);
+                ::util::hashCombine(res, key.material);
+                ::util::hashCombine(res, key.indexed);
+                return res;
+            }
+        };
+    };
+
+    // decals of same size, uv offset and material share the same (untransformed) quad
+    unordered_map<DecalKey, unordered_map<Material, VertsPacked>, DecalKey::Hash> cacheDecals;
+
+    VertsPacked indexDecal(VertsPrecomp& vertsUnpacked, float bboxMaxDim)
+    {
+        // a decal is just one or two quads, so vertex cache / overdraw optimization and simplification are pointless
+        VertsPacked result;
+        result.vertsPacked = std::move(vertsUnpacked);
+        result.indices = createIndicesAndRemap(result.vertsPacked);
+        if (bboxMaxDim > objectLodMinSize) {
+            result.indicesLod = result.indices;
+        }
+        return result;
+    }
+
     void loadInstanceDecal(
-        MatToChunksToVertsBasic& target,
+        MeshDataBasic& target,
         Grid& grid,
+        std::string_view visualName,
         const StaticInstance& instance,
         bool indexed,
         bool debugChecksEnabled
     )
     {
         assert(instance.decal.has_value());
-        auto decal = instance.decal.value();
+        const auto& decal = instance.decal.value();
 
-        const optional<Material> materialOpt = createMaterialDecal(instance.visual_name, decal, debugChecksEnabled);
+        const optional<Material> materialOpt = createMaterialDecal(visualName, decal, debugChecksEnabled);
         if (!materialOpt.has_value()) {
             return;
         }
         const Material& material = materialOpt.value();
-        
-        VertsPrecomp vertsPre = precomputeDecal(decal);
-        float bboxMaxDim = std::max(decal.quad_size.x, decal.quad_size.y) * 2 * G_ASSET_RESCALE;
 
-        unordered_map<Material, VertsPacked> vertsPacked;
-        if (indexed) {
-            vertsPacked.emplace(material, std::move(indexAndOptimize(vertsPre, true, bboxMaxDim)));
-        }
-        else {
-            vertsPacked.emplace(material, VertsPacked{ .vertsPacked = std::move(vertsPre) });
+        DecalKey key = { decal.quad_size, decal.uv_offset, decal.two_sided, material, indexed };
+        auto [it, wasInserted] = cacheDecals.try_emplace(key);
+        unordered_map<Material, VertsPacked>& vertsPacked = it->second;
+        if (wasInserted) {
+            VertsPrecomp vertsPre = precomputeDecal(decal);
+            float bboxMaxDim = std::max(decal.quad_size.x, decal.quad_size.y) * 2 * G_ASSET_RESCALE;
+            VertsPacked packed = indexed
+                ? indexDecal(vertsPre, bboxMaxDim)
+                : VertsPacked{ .vertsPacked = std::move(vertsPre) };
+            convertToSoa(packed);
+            vertsPacked.emplace(material, std::move(packed));
         }
 
-        XMVECTOR centerXm = bboxCenter(instance.bbox);
-        XMVECTOR halfWidthXm = centerXm - instance.bbox[0];
-
-        GridPos gridPos = toGridPos(grid, centerXm);
-        grid::updateBounds(grid, gridPos, BoundingBox(toFloat3(centerXm), toFloat3(halfWidthXm)));
-        instantiateAndInsert(target, gridPos, vertsPacked, instance, true);
+        GridPos gridPos = placeInstance(grid, instance);
+        instantiateAndInsert(target, gridPos, vertsPacked, instance, instance.transform, true);
     }
 
     void printAndResetLoadStats(bool debugChecksEnabled)
@@ -1150,5 +1531,13 @@ namespace assets
         loadStats.normalsInstances.clear();
         loadStats.materialGroups.clear();
         loadStats.materialAlphas.clear();
+
+        LOG(DEBUG) << "Loader arena peak: " << (loadArena.getBytesPeak() / 1024) << " KB";
+    }
+
+    void releaseLoadData()
+    {
+        cacheDecals.clear();
+        loadArena.release();
     }
 }
\ No newline at end of file
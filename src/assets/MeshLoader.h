@@ -13,35 +13,43 @@
 namespace assets
 {
     render::grid::Grid loadWorldMesh(
-        render::MatToChunksToVertsBasic& target,
+        render::MeshDataBasic& target,
         const zenkit::Mesh& worldMesh,
         bool indexed,
         bool debugChecksEnabled = false);
     
+    // Instances must all use the same visual. Mesh data of the visual is released after all instances have been created.
     void loadInstanceMesh(
-        render::MatToChunksToVertsBasic& target,
+        render::MeshDataBasic& target,
         render::grid::Grid& grid,
         const zenkit::MultiResolutionMesh& mesh,
-        const render::StaticInstance& instance,
+        std::string_view visualName,
+        std::span<const render::StaticInstance> instances,
         bool indexed,
         bool debugChecksEnabled);
 
+    // Instances must all use the same visual. Mesh data of the visual is released after all instances have been created.
     void loadInstanceModel(
-        render::MatToChunksToVertsBasic& target,
+        render::MeshDataBasic& target,
         render::grid::Grid& grid,
         const zenkit::ModelHierarchy& hierarchy,
         const zenkit::ModelMesh& model,
-        const render::StaticInstance& instance,
+        std::string_view visualName,
+        std::span<const render::StaticInstance> instances,
         bool indexed,
         bool debugChecksEnabled);
 
     void loadInstanceDecal(
-        render::MatToChunksToVertsBasic& target,
+        render::MeshDataBasic& target,
         render::grid::Grid& grid,
+        std::string_view visualName,
         const render::StaticInstance& instance,
         bool indexed,
         bool debugChecksEnabled
     );
 
     void printAndResetLoadStats(bool debugChecksEnabled);
+
+    // Releases caches and temporary memory that are only needed while a level is loaded, must be called after each level.
+    void releaseLoadData();
 }
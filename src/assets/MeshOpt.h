@@ -21,16 +21,20 @@ namespace assets::meshopt
         uint32_t vertCountRemapped;
     };
 
-    template<typename T>
-    void remapVertexBuffer(std::vector<T>& verts, const Remap& remap)
+    // vectors may use any allocator, so that loader temporaries can be allocated from an arena
+
+    template<typename VEC>
+    void remapVertexBuffer(VEC& verts, const Remap& remap)
     {
+        using T = typename VEC::value_type;
         assert(verts.size() >= remap.vertCountRemapped);
         meshopt_remapVertexBuffer(
             verts.data(), verts.data(), verts.size(), sizeof(T), remap.vertMap.data());
         verts.resize(remap.vertCountRemapped);
     }
 
-    void remapIndexBuffer(std::vector<render::VertexIndex>& indices, const Remap& remap)
+    template<typename INDICES>
+    void remapIndexBuffer(INDICES& indices, const Remap& remap)
     {
         assert(indices.size() >= remap.vertMap.size());
         meshopt_remapIndexBuffer(indices.data(), indices.data(), indices.size(), remap.vertMap.data());
@@ -39,10 +43,17 @@ namespace assets::meshopt
     /**
      * @param remap - size must be equal to number of indices / unindexed verts
      */
+    template<typename INDICES>
+    void createIndexBuffer(const Remap& remap, INDICES& indicesOut)
+    {
+        indicesOut.resize(remap.vertMap.size());
+        meshopt_remapIndexBuffer(indicesOut.data(), nullptr, remap.vertMap.size(), remap.vertMap.data());
+    }
+
     std::vector<render::VertexIndex> createIndexBuffer(const Remap& remap)
     {
-        std::vector<render::VertexIndex> indices(remap.vertMap.size());
-        meshopt_remapIndexBuffer(indices.data(), nullptr, remap.vertMap.size(), remap.vertMap.data());
+        std::vector<render::VertexIndex> indices;
+        createIndexBuffer(remap, indices);
         return indices;
     }
 
@@ -58,28 +69,32 @@ namespace assets::meshopt
         return remap;
     }
 
-    template <typename T>
-    meshopt_Stream createStream(const std::vector<T>& vec)
+    template <typename VEC>
+    meshopt_Stream createStream(const VEC& vec)
     {
+        using T = typename VEC::value_type;
         return meshopt_Stream{ vec.data(), sizeof(T), sizeof(T) };
     }
 
-    void optimizeVertexCache(std::vector<render::VertexIndex>& indices, uint32_t vertexCount)
+    template<typename INDICES>
+    void optimizeVertexCache(INDICES& indices, uint32_t vertexCount)
     {
         meshopt_optimizeVertexCache(
             indices.data(), indices.data(), indices.size(), vertexCount);
     }
 
-    template<typename T>
-    void optimizeOverdraw(std::vector<render::VertexIndex>& indices, const std::vector<T>& vertsWithPosAtStart)
+    template<typename INDICES, typename VEC>
+    void optimizeOverdraw(INDICES& indices, const VEC& vertsWithPosAtStart)
     {
+        using T = typename VEC::value_type;
         assert(sizeof(T) >= 12);
         const float* vertPosStart = (float*)vertsWithPosAtStart.data();
         meshopt_optimizeOverdraw(
             indices.data(), indices.data(), indices.size(), vertPosStart, vertsWithPosAtStart.size(), sizeof(T), 1.05f);
     }
 
-    Remap optimizeVertexFetchRemap(std::vector<render::VertexIndex>& indices, uint32_t vertexCount)
+    template<typename INDICES>
+    Remap optimizeVertexFetchRemap(INDICES& indices, uint32_t vertexCount)
     {
         Remap remap{
             .vertMap = std::vector<uint32_t>(vertexCount),
@@ -3,6 +3,8 @@
 
 #include "render/basic/MeshUtil.h"
 
+#include <mutex>
+
 namespace assets
 {
     using namespace render;
@@ -10,34 +12,24 @@ namespace assets
     using ::std::vector;
     using ::std::unordered_map;
 
-    uint32_t vobLightWorldIntersectChecks = 0;
+    std::atomic<uint32_t> vobLightWorldIntersectChecks = 0;
 
     float debugStaticLightRaysMaxDist = 50;
     vector<DebugLine> debugLightToVobRays;
+    std::mutex debugLightToVobRaysMutex;
 
-    bool rayIntersectsWorldFaces(XMVECTOR rayStart, XMVECTOR rayEnd, float maxDistance, const MatToChunksToVertsBasic& meshData, const VertLookupTree& vertLookup)
+    bool rayIntersectsWorldFaces(XMVECTOR rayStart, XMVECTOR rayEnd, float maxDistance, const MeshDataBasic& meshData, const VertLookupTree& vertLookup)
     {
-        XMVECTOR direction = DirectX::XMVector3Normalize(rayEnd - rayStart);
-        vector<VertKey> vertKeys = rayIntersected(vertLookup, rayStart, rayEnd);
-        for (auto& vertKey : vertKeys) {
-            auto face = vertKey.getPos(meshData);
-            XMVECTOR faceA = toXM4Pos(face[0]);
-            XMVECTOR faceB = toXM4Pos(face[1]);
-            XMVECTOR faceC = toXM4Pos(face[2]);
-            float distance;
-            bool intersects = TriangleTests::Intersects(rayStart, direction, faceA, faceB, faceC, distance);
-            if (intersects && distance <= maxDistance) {
-                return true;
-            }
-        }
-        return false;
+        // BVH returns closest exact triangle hit
+        auto hit = rayIntersected(vertLookup, rayStart, rayEnd);
+        return hit.has_value() && hit.value().hitDistance <= maxDistance;
     }
 
     std::optional<DirectionalLight> getLightAtPos(
             XMVECTOR posXm,
             const vector<Light>& lights,
             const LightLookupTree& lightLookup,
-            const MatToChunksToVertsBasic& worldMeshData,
+            const MeshDataBasic& worldMeshData,
             const VertLookupTree& worldFaceLookup,
             bool disableVisibilityRayChecks)
     {
@@ -79,6 +71,7 @@ namespace assets
                     }
                 }
                 if (dist < debugStaticLightRaysMaxDist) {
+                    std::scoped_lock lock(debugLightToVobRaysMutex);
                     debugLightToVobRays.push_back({ light.pos, pos, intersectedWorld ? Color(0.f, 0.f, 1.f, 0.5f) : Color(1.f, 0.f, 0.f, 0.5f) });
                 }
             }
@@ -3,6 +3,8 @@
 #include "render/basic/Common.h"
 #include "LookupTrees.h"
 
+#include <atomic>
+
 namespace assets
 {
     struct DirectionalLight {
@@ -14,13 +16,13 @@ namespace assets
             DirectX::XMVECTOR posXm,
             const std::vector<render::Light>& lights,
             const LightLookupTree& lightLookup,
-            const render::MatToChunksToVertsBasic& worldMeshData,
+            const render::MeshDataBasic& worldMeshData,
             const VertLookupTree& worldFaceLookup,
             bool disableVisibilityRayChecks);
 
-    // debug stuff
+    // debug stuff, getLightAtPos may be called from multiple threads
 
-    extern uint32_t vobLightWorldIntersectChecks;
+    extern std::atomic<uint32_t> vobLightWorldIntersectChecks;
 
     struct DebugLine {
         Vec3 posStart;
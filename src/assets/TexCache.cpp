@@ -0,0 +1,221 @@
+#include "stdafx.h"
+#include "TexCache.h"
+
+#include "Util.h"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <format>
+#include <mutex>
+
+namespace assets
+{
+	using namespace render;
+	using ::std::vector;
+	namespace fs = std::filesystem;
+
+	// Cached mip chains are stored in a minimal DDS-like container:
+	// [TexCacheHeader][SurfaceInfo x mipCount][mip 0 data][mip 1 data]...
+	// Any change to the container layout or to how textures are rebuilt must increase the version to invalidate old files.
+	// File names contain the full key and version, so an existing file is never replaced with different content. This
+	// matters on Windows, where a file cannot be replaced while another thread still has it memory-mapped.
+
+	constexpr bool texCacheEnabled = true;
+	const fs::path texCacheDir = "./cache/textures";
+
+	constexpr std::array<char, 4> texCacheMagic = { 'Z', 'R', 'T', 'C' };
+	constexpr uint32_t texCacheVersion = 6;
+
+	struct TexCacheHeader {
+		std::array<char, 4> magic;
+		uint32_t version;
+		uint64_t sourceHash;
+		uint32_t format;
+		uint16_t width;
+		uint16_t height;
+		uint16_t mipCount;
+		uint8_t srgb;
+		uint8_t hasAlpha;
+		uint16_t targetWidth;
+		uint16_t targetHeight;
+	};
+
+	std::once_flag cacheDirChecked;
+	bool cacheDirUsable = false;
+
+	// makes temp file names unique when multiple threads write the same texture at once
+	std::atomic<uint32_t> tempFileCounter = 0;
+
+	uint64_t hashTexSource(const std::byte* data, uint64_t size)
+	{
+		// FNV-1a on 8 byte words, only needs to detect changed source files, not resist attacks
+		constexpr uint64_t prime = 0x100000001b3;
+		uint64_t hash = 0xcbf29ce484222325;
+		uint64_t wordCount = size / sizeof(uint64_t);
+		for (uint64_t i = 0; i < wordCount; i++) {
+			uint64_t word;
+			std::memcpy(&word, data + i * sizeof(uint64_t), sizeof(uint64_t));
+			hash = (hash ^ word) * prime;
+		}
+		for (uint64_t i = wordCount * sizeof(uint64_t); i < size; i++) {
+			hash = (hash ^ (uint64_t) data[i]) * prime;
+		}
+		return (hash ^ size) * prime;
+	}
+
+	fs::path getCachePath(const TexCacheKey& key)
+	{
+		return texCacheDir / std::format("{:016x}_{}_{}_{}x{}.v{}.ztc",
+			key.sourceHash, key.format, (uint32_t) key.srgb, key.targetSize.width, key.targetSize.height, texCacheVersion);
+	}
+
+	bool ensureCacheDir()
+	{
+		// may be called from loader and preload threads at the same time
+		std::call_once(cacheDirChecked, []() {
+			std::error_code error;
+			fs::create_directories(texCacheDir, error);
+			cacheDirUsable = !error;
+			if (!cacheDirUsable) {
+				LOG(WARNING) << "Texture Cache: Failed to create cache dir, caching disabled: " << texCacheDir << " (" << error.message() << ")";
+			}
+		});
+		return cacheDirUsable;
+	}
+
+	bool isMatchingHeader(const TexCacheHeader& header, const TexCacheKey& key)
+	{
+		return header.magic == texCacheMagic
+			&& header.version == texCacheVersion
+			&& header.sourceHash == key.sourceHash
+			&& header.format == key.format
+			&& header.srgb == key.srgb
+			&& header.targetWidth == key.targetSize.width
+			&& header.targetHeight == key.targetSize.height;
+	}
+
+	std::optional<CachedTexture> loadCachedTextureFile(const fs::path& path, const TexCacheKey& key)
+	{
+		auto mmap = zenkit::Mmap(path);
+		const std::byte* data = mmap.data();
+		const uint64_t size = mmap.size();
+
+		TexCacheHeader header;
+		if (size < sizeof(header)) {
+			LOG(WARNING) << "Texture Cache: Ignoring truncated file: " << path;
+			return std::nullopt;
+		}
+		std::memcpy(&header, data, sizeof(header));
+		if (!isMatchingHeader(header, key)) {
+			LOG(WARNING) << "Texture Cache: Ignoring corrupted file: " << path;
+			return std::nullopt;
+		}
+
+		uint64_t offset = sizeof(header);
+		uint64_t surfacesSize = header.mipCount * sizeof(d3d::SurfaceInfo);
+		if (size < offset + surfacesSize) {
+			LOG(WARNING) << "Texture Cache: Ignoring truncated file: " << path;
+			return std::nullopt;
+		}
+		vector<d3d::SurfaceInfo> surfaces(header.mipCount);
+		std::memcpy(surfaces.data(), data + offset, surfacesSize);
+		offset += surfacesSize;
+
+		vector<d3d::InitialData> initialData;
+		initialData.reserve(header.mipCount);
+		for (auto& surface : surfaces) {
+			uint64_t mipSize = (uint64_t) surface.bytesPerRow * surface.rowCount;
+			if (size < offset + mipSize) {
+				LOG(WARNING) << "Texture Cache: Ignoring truncated file: " << path;
+				return std::nullopt;
+			}
+			initialData.push_back({ (uint8_t*) (data + offset), surface });
+			offset += mipSize;
+		}
+
+		return CachedTexture {
+			.size = { header.width, header.height },
+			.format = (DXGI_FORMAT) header.format,
+			.hasAlpha = header.hasAlpha != 0,
+			.initialData = std::move(initialData),
+			.mmap = std::move(mmap),
+		};
+	}
+
+	std::optional<CachedTexture> loadCachedTexture(const TexCacheKey& key)
+	{
+		if (!texCacheEnabled) {
+			return std::nullopt;
+		}
+		fs::path path = getCachePath(key);
+		std::error_code error;
+		if (!fs::is_regular_file(path, error)) {
+			return std::nullopt;
+		}
+		auto result = loadCachedTextureFile(path, key);
+		if (!result.has_value()) {
+			// invalid file is unmapped at this point, removing it allows the rebuilt texture to be stored again
+			// (fails if another thread has it mapped, in which case the next launch will retry)
+			fs::remove(path, error);
+		}
+		return result;
+	}
+
+	void storeCachedTexture(
+		const TexCacheKey& key, BufferSize size, DXGI_FORMAT format, bool hasAlpha, const vector<d3d::InitialData>& initialData)
+	{
+		if (!texCacheEnabled || !ensureCacheDir()) {
+			return;
+		}
+		TexCacheHeader header = {
+			.magic = texCacheMagic,
+			.version = texCacheVersion,
+			.sourceHash = key.sourceHash,
+			.format = (uint32_t) format,
+			.width = size.width,
+			.height = size.height,
+			.mipCount = (uint16_t) initialData.size(),
+			.srgb = key.srgb,
+			.hasAlpha = hasAlpha,
+			.targetWidth = key.targetSize.width,
+			.targetHeight = key.targetSize.height,
+		};
+
+		fs::path path = getCachePath(key);
+		std::error_code error;
+		if (fs::is_regular_file(path, error)) {
+			// already stored by another thread, file content only depends on key
+			return;
+		}
+
+		// write to temp file first so that an interrupted write never leaves a valid looking cache file
+		fs::path pathTemp = path;
+		pathTemp += std::format(".{}.tmp", tempFileCounter++);
+		{
+			std::ofstream out(pathTemp, std::ios::binary | std::ios::trunc);
+			out.write((const char*) &header, sizeof(header));
+			for (auto& mip : initialData) {
+				out.write((const char*) &mip.surface, sizeof(d3d::SurfaceInfo));
+			}
+			for (auto& mip : initialData) {
+				out.write((const char*) mip.dataPtr, (std::streamsize) mip.surface.bytesPerRow * mip.surface.rowCount);
+			}
+			if (!out) {
+				LOG(WARNING) << "Texture Cache: Failed to write file: " << pathTemp;
+				out.close();
+				fs::remove(pathTemp, error);
+				return;
+			}
+		}
+		fs::rename(pathTemp, path, error);
+		if (error) {
+			// if another thread stored the same texture in the meantime, its file may be mapped and cannot be replaced
+			std::error_code existsError;
+			if (!fs::is_regular_file(path, existsError)) {
+				LOG(WARNING) << "Texture Cache: Failed to write file: " << path << " (" << error.message() << ")";
+			}
+			fs::remove(pathTemp, error);
+		}
+	}
+}
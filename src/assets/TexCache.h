@@ -0,0 +1,34 @@
+#pragma once
+
+#include "render/d3d/TextureBuffer.h"
+#include "render/basic/Primitives.h"
+
+#undef ERROR
+#include "zenkit/Mmap.hh"
+
+namespace assets
+{
+	// Identifies a texture that was rebuilt (decompressed, resized and/or mipmaps generated) at load time.
+	// The final mip chain only depends on the source file bytes and the parameters used to rebuild it.
+	struct TexCacheKey {
+		uint64_t sourceHash;
+		uint32_t format;// DXGI_FORMAT
+		bool srgb;
+		render::BufferSize targetSize = { 0, 0 };// only non-zero if source was resized
+	};
+
+	struct CachedTexture {
+		render::BufferSize size;
+		DXGI_FORMAT format;
+		bool hasAlpha;
+		std::vector<render::d3d::InitialData> initialData;// points into mmap
+		zenkit::Mmap mmap;// must be kept alive until texture has been created
+	};
+
+	uint64_t hashTexSource(const std::byte* data, uint64_t size);
+
+	std::optional<CachedTexture> loadCachedTexture(const TexCacheKey& key);
+	void storeCachedTexture(
+		const TexCacheKey& key, render::BufferSize size, DXGI_FORMAT format, bool hasAlpha,
+		const std::vector<render::d3d::InitialData>& initialData);
+}
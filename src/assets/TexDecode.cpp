@@ -0,0 +1,828 @@
+#include "stdafx.h"
+#include "TexDecode.h"
+
+#include <thread>
+#include <cmath>
+#include <cfloat>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace assets
+{
+	using namespace render;
+	using ::std::array;
+	using ::std::vector;
+
+	// ###########################################################################
+	// R5G6B5
+	// ###########################################################################
+
+	constexpr float expand5 = 255.f / 31.f;
+	constexpr float expand6 = 255.f / 63.f;
+
+	uint32_t decodeR5G6B5Pixel(uint16_t value)
+	{
+		uint32_t r = (uint8_t)((float)((value >> 11) & 0x1F) * expand5);
+		uint32_t g = (uint8_t)((float)((value >> 5) & 0x3F) * expand6);
+		uint32_t b = (uint8_t)((float)(value & 0x1F) * expand5);
+		return r | (g << 8) | (b << 16) | 0xFF000000;
+	}
+
+	void decodeR5G6B5(std::span<const uint8_t> source, BufferSize size, std::span<uint8_t> rgbaOut)
+	{
+		uint64_t pixelCount = (uint64_t)size.width * size.height;
+		assert(source.size() >= pixelCount * 2 && rgbaOut.size() >= pixelCount * 4);
+
+		uint64_t i = 0;
+#ifdef __AVX2__
+		const __m256i mask5 = _mm256_set1_epi32(0x1F);
+		const __m256i mask6 = _mm256_set1_epi32(0x3F);
+		const __m256 expand5x8 = _mm256_set1_ps(expand5);
+		const __m256 expand6x8 = _mm256_set1_ps(expand6);
+		const __m256i alpha = _mm256_set1_epi32(0xFF000000);
+		for (; i + 8 <= pixelCount; i += 8) {
+			__m256i value = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(source.data() + i * 2)));
+			__m256i r = _mm256_and_si256(_mm256_srli_epi32(value, 11), mask5);
+			__m256i g = _mm256_and_si256(_mm256_srli_epi32(value, 5), mask6);
+			__m256i b = _mm256_and_si256(value, mask5);
+			r = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(r), expand5x8));
+			g = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(g), expand6x8));
+			b = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(b), expand5x8));
+			__m256i rgba = _mm256_or_si256(_mm256_or_si256(r, _mm256_slli_epi32(g, 8)), _mm256_or_si256(_mm256_slli_epi32(b, 16), alpha));
+			_mm256_storeu_si256((__m256i*)(rgbaOut.data() + i * 4), rgba);
+		}
+#endif
+		for (; i < pixelCount; i++) {
+			uint16_t value = source[i * 2] | (source[i * 2 + 1] << 8);
+			uint32_t rgba = decodeR5G6B5Pixel(value);
+			std::memcpy(rgbaOut.data() + i * 4, &rgba, 4);
+		}
+	}
+
+	// ###########################################################################
+	// DXT1 / DXT3
+	// ###########################################################################
+
+	// Blocks are 4x4 pixels, each block has its own 4-color palette which is indexed with 2 bits per pixel.
+	// Only the palette is built per block, index lookup and alpha expansion are done for 8 pixels (2 block rows) at once.
+
+	constexpr uint32_t blockDim = 4;
+
+	uint32_t expand565(uint16_t value)
+	{
+		// bit replication, same as squish
+		uint32_t r = (value >> 11) & 0x1F;
+		uint32_t g = (value >> 5) & 0x3F;
+		uint32_t b = value & 0x1F;
+		r = (r << 3) | (r >> 2);
+		g = (g << 2) | (g >> 4);
+		b = (b << 3) | (b >> 2);
+		return r | (g << 8) | (b << 16);
+	}
+
+	uint32_t mixChannels(uint32_t a, uint32_t b, uint32_t weightA, uint32_t weightB, uint32_t divisor)
+	{
+		uint32_t result = 0;
+		for (uint32_t shift = 0; shift < 24; shift += 8) {
+			uint32_t channelA = (a >> shift) & 0xFF;
+			uint32_t channelB = (b >> shift) & 0xFF;
+			result |= ((channelA * weightA + channelB * weightB) / divisor) << shift;
+		}
+		return result;
+	}
+
+	array<uint32_t, 4> decodeColorPalette(const uint8_t* block, bool allowThreeColor)
+	{
+		uint16_t value0 = block[0] | (block[1] << 8);
+		uint16_t value1 = block[2] | (block[3] << 8);
+		uint32_t color0 = expand565(value0);
+		uint32_t color1 = expand565(value1);
+		const uint32_t alpha = 0xFF000000;
+
+		if (allowThreeColor && value0 <= value1) {
+			return { color0 | alpha, color1 | alpha, mixChannels(color0, color1, 1, 1, 2) | alpha, 0 };
+		}
+		else {
+			return {
+				color0 | alpha, color1 | alpha, mixChannels(color0, color1, 2, 1, 3) | alpha, mixChannels(color0, color1, 1, 2, 3) | alpha
+			};
+		}
+	}
+
+	// decodes a single block into 16 pixels (row-major), alphaBlock is nullptr for DXT1
+	void decodeBlock(const uint8_t* colorBlock, const uint8_t* alphaBlock, array<uint32_t, 16>& pixels)
+	{
+		array<uint32_t, 4> palette = decodeColorPalette(colorBlock, alphaBlock == nullptr);
+		uint32_t indices;
+		std::memcpy(&indices, colorBlock + 4, 4);
+		array<uint32_t, 2> alphas = { 0, 0 };
+		if (alphaBlock != nullptr) {
+			std::memcpy(alphas.data(), alphaBlock, 8);
+		}
+#ifdef __AVX2__
+		const __m256i paletteX8 = _mm256_setr_epi32(palette[0], palette[1], palette[2], palette[3], palette[0], palette[1], palette[2], palette[3]);
+		const __m256i indexShifts = _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14);
+		const __m256i alphaShifts = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+		for (uint32_t half = 0; half < 2; half++) {
+			__m256i index = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(indices >> (half * 16)), indexShifts), _mm256_set1_epi32(3));
+			__m256i rgba = _mm256_permutevar8x32_epi32(paletteX8, index);
+			if (alphaBlock != nullptr) {
+				__m256i alpha = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(alphas[half]), alphaShifts), _mm256_set1_epi32(0xF));
+				alpha = _mm256_slli_epi32(_mm256_mullo_epi32(alpha, _mm256_set1_epi32(0x11)), 24);
+				rgba = _mm256_or_si256(_mm256_and_si256(rgba, _mm256_set1_epi32(0x00FFFFFF)), alpha);
+			}
+			_mm256_storeu_si256((__m256i*)(pixels.data() + half * 8), rgba);
+		}
+#else
+		for (uint32_t i = 0; i < 16; i++) {
+			uint32_t rgba = palette[(indices >> (i * 2)) & 3];
+			if (alphaBlock != nullptr) {
+				uint32_t alpha = (alphas[i / 8] >> ((i % 8) * 4)) & 0xF;
+				rgba = (rgba & 0x00FFFFFF) | ((alpha * 0x11) << 24);
+			}
+			pixels[i] = rgba;
+		}
+#endif
+	}
+
+	void decodeBlocks(std::span<const uint8_t> source, BufferSize size, std::span<uint8_t> rgbaOut, bool hasAlphaBlock)
+	{
+		uint32_t blocksX = (size.width + blockDim - 1) / blockDim;
+		uint32_t blocksY = (size.height + blockDim - 1) / blockDim;
+		uint32_t blockBytes = hasAlphaBlock ? 16 : 8;
+		assert(source.size() >= (uint64_t)blocksX * blocksY * blockBytes);
+		assert(rgbaOut.size() >= (uint64_t)size.width * size.height * 4);
+
+		uint32_t* target = (uint32_t*)rgbaOut.data();
+		array<uint32_t, 16> pixels;
+		for (uint32_t blockY = 0; blockY < blocksY; blockY++) {
+			for (uint32_t blockX = 0; blockX < blocksX; blockX++) {
+				const uint8_t* block = source.data() + ((uint64_t)blockY * blocksX + blockX) * blockBytes;
+				if (hasAlphaBlock) {
+					decodeBlock(block + 8, block, pixels);
+				}
+				else {
+					decodeBlock(block, nullptr, pixels);
+				}
+
+				// blocks on right and bottom border may be partially outside of image
+				uint32_t pixelX = blockX * blockDim;
+				uint32_t pixelY = blockY * blockDim;
+				uint32_t copyWidth = std::min(blockDim, size.width - pixelX);
+				uint32_t copyHeight = std::min(blockDim, size.height - pixelY);
+				for (uint32_t row = 0; row < copyHeight; row++) {
+					std::memcpy(target + (uint64_t)(pixelY + row) * size.width + pixelX, pixels.data() + row * blockDim, copyWidth * 4);
+				}
+			}
+		}
+	}
+
+	void decodeDxt1(std::span<const uint8_t> source, BufferSize size, std::span<uint8_t> rgbaOut)
+	{
+		decodeBlocks(source, size, rgbaOut, false);
+	}
+
+	void decodeDxt3(std::span<const uint8_t> source, BufferSize size, std::span<uint8_t> rgbaOut)
+	{
+		decodeBlocks(source, size, rgbaOut, true);
+	}
+
+	// ###########################################################################
+	// MIPMAPS
+	// ###########################################################################
+
+	// Levels are filtered from the previous level in float RGBA, separable (horizontal pass, then vertical pass).
+
+	// Kaiser filter parameters (same defaults as NVTT)
+	constexpr float kaiserWidth = 3.f;
+	constexpr float kaiserAlpha = 4.f;
+
+	// below this many destination pixels a level is filtered on calling thread only
+	constexpr uint64_t parallelPixelsMin = 128 * 128;
+
+	constexpr uint32_t linearToSrgbLutSize = 4096;
+
+	struct ColorLuts {
+		array<float, 256> srgbToLinear;
+		array<uint8_t, linearToSrgbLutSize> linearToSrgb;
+	};
+
+	const ColorLuts colorLuts = []() -> ColorLuts {
+		ColorLuts result;
+		for (uint32_t i = 0; i < 256; i++) {
+			float c = i / 255.f;
+			result.srgbToLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+		for (uint32_t i = 0; i < linearToSrgbLutSize; i++) {
+			float c = i / (float)(linearToSrgbLutSize - 1);
+			float srgb = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.f / 2.4f) - 0.055f;
+			result.linearToSrgb[i] = (uint8_t)std::lround(std::clamp(srgb, 0.f, 1.f) * 255.f);
+		}
+		return result;
+	}();
+
+	struct Rgba32f {
+		float r, g, b, a;
+	};
+
+	struct FilterTaps {
+		uint32_t tapCount;
+		vector<int32_t> first;// per destination pixel
+		vector<float> weights;// tapCount per destination pixel, normalized
+	};
+
+	float besselI0(float x)
+	{
+		float sum = 1.f;
+		float term = 1.f;
+		float halfSq = x * x * 0.25f;
+		for (uint32_t k = 1; k < 32 && term > sum * 1e-8f; k++) {
+			term *= halfSq / (float)(k * k);
+			sum += term;
+		}
+		return sum;
+	}
+
+	float filterWeight(MipFilter filter, float t)
+	{
+		if (filter == MipFilter::BOX) {
+			return (t >= -0.5f && t < 0.5f) ? 1.f : 0.f;
+		}
+		else {
+			float halfWidth = kaiserWidth * 0.5f;
+			if (std::abs(t) >= halfWidth) {
+				return 0.f;
+			}
+			const float pi = 3.141592653589793238463f;
+			float sinc = t == 0.f ? 1.f : std::sin(pi * t) / (pi * t);
+			float ratio = t / halfWidth;
+			float window = besselI0(kaiserAlpha * std::sqrt(1.f - ratio * ratio)) / besselI0(kaiserAlpha);
+			return sinc * window;
+		}
+	}
+
+	// t is the distance between source and destination pixel center in destination pixel units
+	FilterTaps createFilterTaps(MipFilter filter, uint32_t sourceDim, uint32_t targetDim)
+	{
+		float scale = (float)sourceDim / targetDim;
+		float support = (filter == MipFilter::BOX ? 0.5f : kaiserWidth * 0.5f) * scale;
+
+		FilterTaps result;
+		result.tapCount = (uint32_t)std::ceil(support * 2) + 1;
+		result.first.resize(targetDim);
+		result.weights.resize(targetDim * result.tapCount, 0.f);
+
+		for (uint32_t target = 0; target < targetDim; target++) {
+			float center = (target + 0.5f) * scale;
+			int32_t first = (int32_t)std::floor(center - support);
+			result.first[target] = first;
+
+			float* weights = &result.weights[target * result.tapCount];
+			float sum = 0.f;
+			for (uint32_t tap = 0; tap < result.tapCount; tap++) {
+				float t = ((first + (int32_t)tap) + 0.5f - center) / scale;
+				weights[tap] = filterWeight(filter, t);
+				sum += weights[tap];
+			}
+			for (uint32_t tap = 0; tap < result.tapCount; tap++) {
+				weights[tap] /= sum;
+			}
+		}
+		return result;
+	}
+
+	// runs func(rowBegin, rowEnd) over all rows, split across threads
+	template <typename F>
+	void forEachRowRange(uint32_t rowCount, uint64_t pixelCount, uint32_t threadCount, const F& func)
+	{
+		if (threadCount == 0) {
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+		}
+		threadCount = std::min(threadCount, rowCount);
+		if (threadCount <= 1 || pixelCount < parallelPixelsMin) {
+			func(0, rowCount);
+			return;
+		}
+		uint32_t rowsPerThread = (rowCount + threadCount - 1) / threadCount;
+		vector<std::jthread> threads;
+		threads.reserve(threadCount - 1);
+		for (uint32_t begin = rowsPerThread; begin < rowCount; begin += rowsPerThread) {
+			uint32_t end = std::min(rowCount, begin + rowsPerThread);
+			threads.emplace_back([&func, begin, end]() -> void { func(begin, end); });
+		}
+		func(0, std::min(rowCount, rowsPerThread));
+	}
+
+	inline void accumulate(Rgba32f& target, const Rgba32f& source, float weight)
+	{
+		target.r += source.r * weight;
+		target.g += source.g * weight;
+		target.b += source.b * weight;
+		target.a += source.a * weight;
+	}
+
+	// filters rows [rowBegin, rowEnd) of target along x (stride 1) or y (stride width)
+	void filterRows(
+		const vector<Rgba32f>& source, BufferSize sourceSize, vector<Rgba32f>& target, BufferSize targetSize,
+		const FilterTaps& taps, bool alongX, uint32_t rowBegin, uint32_t rowEnd)
+	{
+		int32_t sourceDimMax = (alongX ? sourceSize.width : sourceSize.height) - 1;
+		for (uint32_t y = rowBegin; y < rowEnd; y++) {
+			for (uint32_t x = 0; x < targetSize.width; x++) {
+				uint32_t filtered = alongX ? x : y;
+				int32_t first = taps.first[filtered];
+				const float* weights = &taps.weights[filtered * taps.tapCount];
+
+				Rgba32f sum = { 0.f, 0.f, 0.f, 0.f };
+				for (uint32_t tap = 0; tap < taps.tapCount; tap++) {
+					int32_t sourceIndex = std::clamp(first + (int32_t)tap, 0, sourceDimMax);
+					uint64_t sourcePixel = alongX
+						? (uint64_t)y * sourceSize.width + sourceIndex
+						: (uint64_t)sourceIndex * sourceSize.width + x;
+					accumulate(sum, source[sourcePixel], weights[tap]);
+				}
+				target[(uint64_t)y * targetSize.width + x] = sum;
+			}
+		}
+	}
+
+	void toRgba32f(std::span<const uint8_t> rgba, bool srgb, vector<Rgba32f>& target)
+	{
+		const float toUnorm = 1.f / 255.f;
+		for (uint64_t i = 0; i < target.size(); i++) {
+			const uint8_t* pixel = rgba.data() + i * 4;
+			if (srgb) {
+				target[i] = {
+					colorLuts.srgbToLinear[pixel[0]], colorLuts.srgbToLinear[pixel[1]], colorLuts.srgbToLinear[pixel[2]], pixel[3] * toUnorm
+				};
+			}
+			else {
+				target[i] = { pixel[0] * toUnorm, pixel[1] * toUnorm, pixel[2] * toUnorm, pixel[3] * toUnorm };
+			}
+		}
+	}
+
+	inline uint8_t toUnorm8(float value)
+	{
+		return (uint8_t)(std::clamp(value, 0.f, 1.f) * 255.f + 0.5f);
+	}
+
+	inline uint8_t toSrgb8(float value)
+	{
+		return colorLuts.linearToSrgb[(uint32_t)(std::clamp(value, 0.f, 1.f) * (linearToSrgbLutSize - 1) + 0.5f)];
+	}
+
+	void toRgba8(const vector<Rgba32f>& source, bool srgb, uint8_t* target, uint32_t pixelBegin, uint32_t pixelEnd)
+	{
+		for (uint64_t i = pixelBegin; i < pixelEnd; i++) {
+			const Rgba32f& pixel = source[i];
+			uint8_t* out = target + i * 4;
+			if (srgb) {
+				out[0] = toSrgb8(pixel.r);
+				out[1] = toSrgb8(pixel.g);
+				out[2] = toSrgb8(pixel.b);
+			}
+			else {
+				out[0] = toUnorm8(pixel.r);
+				out[1] = toUnorm8(pixel.g);
+				out[2] = toUnorm8(pixel.b);
+			}
+			out[3] = toUnorm8(pixel.a);
+		}
+	}
+
+	MipChain generateMipsRgba8(
+		std::span<const uint8_t> mipZero, BufferSize size, bool srgb, MipFilter filter, uint32_t threadCount)
+	{
+		MipChain result;
+		uint64_t bytesTotal = 0;
+		BufferSize levelSize = size;
+		while (true) {
+			result.sizes.push_back(levelSize);
+			result.offsets.push_back(bytesTotal);
+			bytesTotal += (uint64_t)levelSize.width * levelSize.height * 4;
+			if (levelSize.width == 1 && levelSize.height == 1) {
+				break;
+			}
+			levelSize = { (uint16_t)std::max(1, levelSize.width >> 1), (uint16_t)std::max(1, levelSize.height >> 1) };
+		}
+		uint64_t mipZeroBytes = (uint64_t)size.width * size.height * 4;
+		assert(mipZero.size() >= mipZeroBytes);
+		result.data.resize(bytesTotal);
+		std::memcpy(result.data.data(), mipZero.data(), mipZeroBytes);
+
+		vector<Rgba32f> source((uint64_t)size.width * size.height);
+		toRgba32f(mipZero, srgb, source);
+		vector<Rgba32f> filteredX;
+		vector<Rgba32f> target;
+
+		for (uint32_t level = 1; level < result.sizes.size(); level++) {
+			BufferSize sourceSize = result.sizes[level - 1];
+			BufferSize targetSize = result.sizes[level];
+			BufferSize filteredXSize = { targetSize.width, sourceSize.height };
+			uint64_t targetPixels = (uint64_t)targetSize.width * targetSize.height;
+
+			FilterTaps tapsX = createFilterTaps(filter, sourceSize.width, targetSize.width);
+			FilterTaps tapsY = createFilterTaps(filter, sourceSize.height, targetSize.height);
+			filteredX.resize((uint64_t)filteredXSize.width * filteredXSize.height);
+			target.resize(targetPixels);
+
+			forEachRowRange(filteredXSize.height, filteredX.size(), threadCount, [&](uint32_t rowBegin, uint32_t rowEnd) -> void {
+				filterRows(source, sourceSize, filteredX, filteredXSize, tapsX, true, rowBegin, rowEnd);
+			});
+			uint8_t* targetRgba = result.mip(level);
+			forEachRowRange(targetSize.height, targetPixels, threadCount, [&](uint32_t rowBegin, uint32_t rowEnd) -> void {
+				filterRows(filteredX, filteredXSize, target, targetSize, tapsY, false, rowBegin, rowEnd);
+				toRgba8(target, srgb, targetRgba, rowBegin * targetSize.width, rowEnd * targetSize.width);
+			});
+			std::swap(source, target);
+		}
+		return result;
+	}
+
+	// ###########################################################################
+	// BC1 / BC2 ENCODING
+	// ###########################################################################
+
+	// Color blocks are encoded in 4-color mode (color0 > color1), which is the only mode BC2 supports. BC1 blocks with
+	// transparent pixels are encoded in 3-color mode (color0 <= color1), where index 3 is transparent black.
+	// Endpoints are searched per block, index selection tests 8 pixels (2 block rows) against the palette at once.
+
+	constexpr uint32_t endpointPowerIterations = 8;
+	constexpr uint32_t endpointRefineIterations = 2;
+	constexpr uint8_t bc1AlphaThreshold = 128;// BC1 pixels with lower alpha are encoded as transparent
+
+	using Rgb32f = array<float, 3>;
+
+	struct BlockPixels {
+		// row-major, channels stored separately to load 8 pixels at once
+		array<float, 16> r, g, b;
+		array<uint8_t, 16> a;
+
+		Rgb32f rgb(uint32_t i) const
+		{
+			return { r[i], g[i], b[i] };
+		}
+	};
+
+	void loadBlock(const uint8_t* rgba, BufferSize size, uint32_t pixelX, uint32_t pixelY, BlockPixels& block)
+	{
+		// blocks on right and bottom border repeat last column/row, so pixels outside of image do not add colors
+		for (uint32_t i = 0; i < 16; i++) {
+			uint32_t x = std::min(pixelX + i % blockDim, size.width - 1u);
+			uint32_t y = std::min(pixelY + i / blockDim, size.height - 1u);
+			const uint8_t* pixel = rgba + ((uint64_t)y * size.width + x) * 4;
+			block.r[i] = pixel[0];
+			block.g[i] = pixel[1];
+			block.b[i] = pixel[2];
+			block.a[i] = pixel[3];
+		}
+	}
+
+	std::pair<Rgb32f, Rgb32f> findEndpointsBbox(const BlockPixels& block)
+	{
+		Rgb32f min = { 255.f, 255.f, 255.f };
+		Rgb32f max = { 0.f, 0.f, 0.f };
+		for (uint32_t i = 0; i < 16; i++) {
+			Rgb32f pixel = block.rgb(i);
+			for (uint32_t c = 0; c < 3; c++) {
+				min[c] = std::min(min[c], pixel[c]);
+				max[c] = std::max(max[c], pixel[c]);
+			}
+		}
+		// inset, because interpolated palette colors cover the inner part of the range better than the extremes
+		for (uint32_t c = 0; c < 3; c++) {
+			float inset = (max[c] - min[c]) / 16.f;
+			min[c] += inset;
+			max[c] -= inset;
+		}
+		return { max, min };
+	}
+
+	std::pair<Rgb32f, Rgb32f> findEndpointsPrincipal(const BlockPixels& block)
+	{
+		Rgb32f mean = { 0.f, 0.f, 0.f };
+		for (uint32_t i = 0; i < 16; i++) {
+			Rgb32f pixel = block.rgb(i);
+			for (uint32_t c = 0; c < 3; c++) {
+				mean[c] += pixel[c] / 16.f;
+			}
+		}
+		// covariance xx, xy, xz, yy, yz, zz
+		array<float, 6> cov = {};
+		for (uint32_t i = 0; i < 16; i++) {
+			Rgb32f pixel = block.rgb(i);
+			Rgb32f d = { pixel[0] - mean[0], pixel[1] - mean[1], pixel[2] - mean[2] };
+			cov[0] += d[0] * d[0];
+			cov[1] += d[0] * d[1];
+			cov[2] += d[0] * d[2];
+			cov[3] += d[1] * d[1];
+			cov[4] += d[1] * d[2];
+			cov[5] += d[2] * d[2];
+		}
+
+		// principal axis with power iteration
+		Rgb32f axis = { 1.f, 1.f, 1.f };
+		for (uint32_t iteration = 0; iteration < endpointPowerIterations; iteration++) {
+			Rgb32f next = {
+				cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+				cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+				cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2],
+			};
+			float maxComponent = std::max({ std::abs(next[0]), std::abs(next[1]), std::abs(next[2]) });
+			if (maxComponent < 1e-6f) {
+				return { mean, mean };// all pixels have the same color
+			}
+			for (uint32_t c = 0; c < 3; c++) {
+				axis[c] = next[c] / maxComponent;
+			}
+		}
+		float lengthSq = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+
+		float projMin = FLT_MAX;
+		float projMax = -FLT_MAX;
+		for (uint32_t i = 0; i < 16; i++) {
+			Rgb32f pixel = block.rgb(i);
+			float proj = ((pixel[0] - mean[0]) * axis[0] + (pixel[1] - mean[1]) * axis[1] + (pixel[2] - mean[2]) * axis[2]) / lengthSq;
+			projMin = std::min(projMin, proj);
+			projMax = std::max(projMax, proj);
+		}
+		Rgb32f start, end;
+		for (uint32_t c = 0; c < 3; c++) {
+			start[c] = mean[c] + axis[c] * projMax;
+			end[c] = mean[c] + axis[c] * projMin;
+		}
+		return { start, end };
+	}
+
+	uint16_t quantize565(const Rgb32f& color)
+	{
+		uint32_t r = (uint32_t)std::clamp(std::lround(color[0] * (31.f / 255.f)), 0l, 31l);
+		uint32_t g = (uint32_t)std::clamp(std::lround(color[1] * (63.f / 255.f)), 0l, 63l);
+		uint32_t b = (uint32_t)std::clamp(std::lround(color[2] * (31.f / 255.f)), 0l, 31l);
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	bool isTransparent(const BlockPixels& block, uint32_t i)
+	{
+		return block.a[i] < bc1AlphaThreshold;
+	}
+
+	// Selects nearest palette color for each pixel, returns summed squared error. In 3-color mode, transparent pixels
+	// always use index 3 and opaque pixels only use the first three palette colors.
+	float selectIndices(const BlockPixels& block, uint16_t value0, uint16_t value1, bool threeColor, uint32_t& indicesOut)
+	{
+		// use decoder palette, so selection is based on what will actually be displayed
+		const array<uint8_t, 4> endpointBytes = { (uint8_t)value0, (uint8_t)(value0 >> 8), (uint8_t)value1, (uint8_t)(value1 >> 8) };
+		array<uint32_t, 4> palette = decodeColorPalette(endpointBytes.data(), threeColor);
+		const uint32_t paletteSize = threeColor ? 3 : 4;
+		array<Rgb32f, 4> paletteRgb;
+		for (uint32_t k = 0; k < 4; k++) {
+			paletteRgb[k] = { (float)(palette[k] & 0xFF), (float)((palette[k] >> 8) & 0xFF), (float)((palette[k] >> 16) & 0xFF) };
+		}
+
+		indicesOut = 0;
+		float error = 0.f;
+#ifdef __AVX2__
+		for (uint32_t half = 0; half < 2; half++) {
+			__m256 r = _mm256_loadu_ps(block.r.data() + half * 8);
+			__m256 g = _mm256_loadu_ps(block.g.data() + half * 8);
+			__m256 b = _mm256_loadu_ps(block.b.data() + half * 8);
+			__m256 best = _mm256_set1_ps(FLT_MAX);
+			__m256i bestIndex = _mm256_setzero_si256();
+			for (uint32_t k = 0; k < paletteSize; k++) {
+				__m256 dr = _mm256_sub_ps(r, _mm256_set1_ps(paletteRgb[k][0]));
+				__m256 dg = _mm256_sub_ps(g, _mm256_set1_ps(paletteRgb[k][1]));
+				__m256 db = _mm256_sub_ps(b, _mm256_set1_ps(paletteRgb[k][2]));
+				__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dr, dr), _mm256_mul_ps(dg, dg)), _mm256_mul_ps(db, db));
+				__m256 closer = _mm256_cmp_ps(distance, best, _CMP_LT_OQ);
+				best = _mm256_min_ps(distance, best);
+				bestIndex = _mm256_blendv_epi8(bestIndex, _mm256_set1_epi32(k), _mm256_castps_si256(closer));
+			}
+			// each index is shifted to its bit position and all lanes are combined
+			const __m256i indexShifts = _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14);
+			array<uint32_t, 8> shifted;
+			array<float, 8> distances;
+			_mm256_storeu_si256((__m256i*)shifted.data(), _mm256_sllv_epi32(bestIndex, indexShifts));
+			_mm256_storeu_ps(distances.data(), best);
+			for (uint32_t lane = 0; lane < 8; lane++) {
+				if (threeColor && isTransparent(block, half * 8 + lane)) {
+					indicesOut |= 3u << ((half * 8 + lane) * 2);
+					continue;
+				}
+				indicesOut |= shifted[lane] << (half * 16);
+				error += distances[lane];
+			}
+		}
+#else
+		for (uint32_t i = 0; i < 16; i++) {
+			if (threeColor && isTransparent(block, i)) {
+				indicesOut |= 3u << (i * 2);
+				continue;
+			}
+			float best = FLT_MAX;
+			uint32_t bestIndex = 0;
+			for (uint32_t k = 0; k < paletteSize; k++) {
+				float dr = block.r[i] - paletteRgb[k][0];
+				float dg = block.g[i] - paletteRgb[k][1];
+				float db = block.b[i] - paletteRgb[k][2];
+				float distance = dr * dr + dg * dg + db * db;
+				if (distance < best) {
+					best = distance;
+					bestIndex = k;
+				}
+			}
+			indicesOut |= bestIndex << (i * 2);
+			error += best;
+		}
+#endif
+		return error;
+	}
+
+	// least squares fit of both endpoints to current indices, returns false if indices do not constrain endpoints
+	bool refineEndpoints(const BlockPixels& block, uint32_t indices, bool threeColor, Rgb32f& startOut, Rgb32f& endOut)
+	{
+		// weight of start endpoint for each palette index
+		const array<float, 4> indexWeights = threeColor
+			? array<float, 4>{ 1.f, 0.f, 1.f / 2.f, 0.f }
+			: array<float, 4>{ 1.f, 0.f, 2.f / 3.f, 1.f / 3.f };
+		float ww = 0.f, wv = 0.f, vv = 0.f;
+		Rgb32f wp = { 0.f, 0.f, 0.f };
+		Rgb32f vp = { 0.f, 0.f, 0.f };
+		for (uint32_t i = 0; i < 16; i++) {
+			if (threeColor && isTransparent(block, i)) {
+				continue;
+			}
+			float w = indexWeights[(indices >> (i * 2)) & 3];
+			float v = 1.f - w;
+			ww += w * w;
+			wv += w * v;
+			vv += v * v;
+			Rgb32f pixel = block.rgb(i);
+			for (uint32_t c = 0; c < 3; c++) {
+				wp[c] += w * pixel[c];
+				vp[c] += v * pixel[c];
+			}
+		}
+		float det = ww * vv - wv * wv;
+		if (std::abs(det) < 1e-6f) {
+			return false;
+		}
+		for (uint32_t c = 0; c < 3; c++) {
+			startOut[c] = (wp[c] * vv - vp[c] * wv) / det;
+			endOut[c] = (vp[c] * ww - wp[c] * wv) / det;
+		}
+		return true;
+	}
+
+	void writeColorBlock(uint8_t* target, uint16_t value0, uint16_t value1, uint32_t indices)
+	{
+		target[0] = (uint8_t)value0;
+		target[1] = (uint8_t)(value0 >> 8);
+		target[2] = (uint8_t)value1;
+		target[3] = (uint8_t)(value1 >> 8);
+		std::memcpy(target + 4, &indices, 4);
+	}
+
+	float encodeEndpoints(
+		const BlockPixels& block, const Rgb32f& start, const Rgb32f& end, bool threeColor, uint16_t& value0, uint16_t& value1, uint32_t& indices)
+	{
+		value0 = quantize565(start);
+		value1 = quantize565(end);
+		if (threeColor ? value0 > value1 : value0 < value1) {
+			std::swap(value0, value1);
+		}
+		return selectIndices(block, value0, value1, threeColor, indices);
+	}
+
+	void encodeColorBlock(const BlockPixels& sourceBlock, BlockQuality quality, bool allowTransparent, uint8_t* target)
+	{
+		// Transparent pixels do not contribute to the endpoints, so their colors are replaced by an opaque pixel's color,
+		// which keeps endpoint search unchanged. Their indices are overwritten in selectIndices.
+		const BlockPixels* blockPtr = &sourceBlock;
+		BlockPixels opaqueColors;
+		bool threeColor = false;
+		if (allowTransparent) {
+			std::optional<uint32_t> opaqueIndex;
+			for (uint32_t i = 0; i < 16; i++) {
+				if (isTransparent(sourceBlock, i)) {
+					threeColor = true;
+				}
+				else if (!opaqueIndex.has_value()) {
+					opaqueIndex = i;
+				}
+			}
+			if (threeColor) {
+				if (!opaqueIndex.has_value()) {
+					writeColorBlock(target, 0, 0, UINT32_MAX);// all pixels use index 3
+					return;
+				}
+				opaqueColors = sourceBlock;
+				for (uint32_t i = 0; i < 16; i++) {
+					if (isTransparent(sourceBlock, i)) {
+						opaqueColors.r[i] = sourceBlock.r[opaqueIndex.value()];
+						opaqueColors.g[i] = sourceBlock.g[opaqueIndex.value()];
+						opaqueColors.b[i] = sourceBlock.b[opaqueIndex.value()];
+					}
+				}
+				blockPtr = &opaqueColors;
+			}
+		}
+		const BlockPixels& block = *blockPtr;
+		auto [start, end] = quality == BlockQuality::FAST ? findEndpointsBbox(block) : findEndpointsPrincipal(block);
+
+		uint16_t value0, value1;
+		uint32_t indices;
+		float error = encodeEndpoints(block, start, end, threeColor, value0, value1, indices);
+
+		if (quality == BlockQuality::HIGH) {
+			for (uint32_t iteration = 0; iteration < endpointRefineIterations && value0 != value1; iteration++) {
+				if (!refineEndpoints(block, indices, threeColor, start, end)) {
+					break;
+				}
+				uint16_t refined0, refined1;
+				uint32_t refinedIndices;
+				float refinedError = encodeEndpoints(block, start, end, threeColor, refined0, refined1, refinedIndices);
+				if (refinedError >= error) {
+					break;
+				}
+				value0 = refined0;
+				value1 = refined1;
+				indices = refinedIndices;
+				error = refinedError;
+			}
+		}
+		writeColorBlock(target, value0, value1, indices);
+	}
+
+	void encodeAlphaBlock(const BlockPixels& block, uint8_t* target)
+	{
+		uint64_t alphas = 0;
+		for (uint32_t i = 0; i < 16; i++) {
+			uint64_t alpha = (block.a[i] * 15 + 127) / 255;
+			alphas |= alpha << (i * 4);
+		}
+		std::memcpy(target, &alphas, 8);
+	}
+
+	uint32_t getBlockBytes(BlockFormat format)
+	{
+		return format == BlockFormat::BC1 ? 8 : 16;
+	}
+
+	uint64_t getBlockCompressedBytes(BufferSize size, BlockFormat format)
+	{
+		uint64_t blocksX = std::max(1u, (size.width + blockDim - 1) / blockDim);
+		uint64_t blocksY = std::max(1u, (size.height + blockDim - 1) / blockDim);
+		return blocksX * blocksY * getBlockBytes(format);
+	}
+
+	void encodeBlocks(
+		std::span<const uint8_t> rgba, BufferSize size, BlockFormat format, BlockQuality quality,
+		std::span<uint8_t> blocksOut, uint32_t threadCount)
+	{
+		uint32_t blocksX = std::max(1u, (size.width + blockDim - 1) / blockDim);
+		uint32_t blocksY = std::max(1u, (size.height + blockDim - 1) / blockDim);
+		uint32_t blockBytes = getBlockBytes(format);
+		assert(rgba.size() >= (uint64_t)size.width * size.height * 4);
+		assert(blocksOut.size() >= getBlockCompressedBytes(size, format));
+
+		uint64_t pixelCount = (uint64_t)size.width * size.height;
+		forEachRowRange(blocksY, pixelCount, threadCount, [&](uint32_t rowBegin, uint32_t rowEnd) -> void {
+			BlockPixels block;
+			for (uint32_t blockY = rowBegin; blockY < rowEnd; blockY++) {
+				for (uint32_t blockX = 0; blockX < blocksX; blockX++) {
+					loadBlock(rgba.data(), size, blockX * blockDim, blockY * blockDim, block);
+					uint8_t* target = blocksOut.data() + ((uint64_t)blockY * blocksX + blockX) * blockBytes;
+					if (format == BlockFormat::BC2) {
+						encodeAlphaBlock(block, target);
+						target += 8;
+					}
+					encodeColorBlock(block, quality, format == BlockFormat::BC1, target);
+				}
+			}
+		});
+	}
+
+	MipChain encodeMipChain(const MipChain& rgba, BlockFormat format, BlockQuality quality, uint32_t threadCount)
+	{
+		MipChain result;
+		uint64_t bytesTotal = 0;
+		for (BufferSize levelSize : rgba.sizes) {
+			result.sizes.push_back(levelSize);
+			result.offsets.push_back(bytesTotal);
+			bytesTotal += getBlockCompressedBytes(levelSize, format);
+		}
+		result.data.resize(bytesTotal);
+
+		for (uint32_t level = 0; level < rgba.sizes.size(); level++) {
+			BufferSize levelSize = rgba.sizes[level];
+			std::span<const uint8_t> source = { rgba.mip(level), (uint64_t)levelSize.width * levelSize.height * 4 };
+			std::span<uint8_t> target = { result.mip(level), getBlockCompressedBytes(levelSize, format) };
+			encodeBlocks(source, levelSize, format, quality, target, threadCount);
+		}
+		return result;
+	}
+}
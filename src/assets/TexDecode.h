@@ -0,0 +1,65 @@
+#pragma once
+
+#include "render/basic/Primitives.h"
+
+#include <span>
+#include <vector>
+
+// Texture decoding, mipmap generation and block compression on plain 8-bit RGBA memory, independent of D3D, DirectXTex and ZenKit.
+namespace assets
+{
+	// Decoders write tightly packed RGBA (R in lowest byte), rgbaOut must hold width * height * 4 bytes.
+	// R5G6B5 has no alpha, DXT1 3-color blocks decode index 3 as transparent black, same as ZenKit (squish).
+	void decodeR5G6B5(std::span<const uint8_t> source, render::BufferSize size, std::span<uint8_t> rgbaOut);
+	void decodeDxt1(std::span<const uint8_t> source, render::BufferSize size, std::span<uint8_t> rgbaOut);
+	void decodeDxt3(std::span<const uint8_t> source, render::BufferSize size, std::span<uint8_t> rgbaOut);
+
+	enum class MipFilter {
+		BOX,   // 2x2 average, same as DirectXTex default for power-of-two sizes
+		KAISER // Kaiser-windowed sinc, sharper mips
+	};
+
+	// All mip levels in a single tightly packed buffer (RGBA or blocks), including mip 0.
+	struct MipChain {
+		std::vector<uint8_t> data;
+		std::vector<render::BufferSize> sizes;
+		std::vector<uint64_t> offsets;
+
+		uint8_t* mip(uint32_t level)
+		{
+			return data.data() + offsets[level];
+		}
+		const uint8_t* mip(uint32_t level) const
+		{
+			return data.data() + offsets[level];
+		}
+	};
+
+	// Generates full mip chain (same level count as DirectXTex GenerateMipMaps) from tightly packed RGBA mip 0.
+	// If srgb is true, color channels are filtered in linear space, alpha is always filtered as is.
+	// Larger levels are filtered on multiple threads, threadCount 0 uses all hardware threads.
+	MipChain generateMipsRgba8(
+		std::span<const uint8_t> mipZero, render::BufferSize size, bool srgb, MipFilter filter, uint32_t threadCount = 0);
+
+	// Same block formats as DXT1 and DXT3 TEX files, so encoded textures are compatible with those.
+	enum class BlockFormat {
+		BC1, // 1-bit alpha (alpha below 128 is transparent black), 8 bytes per block
+		BC2  // explicit 4-bit alpha, 16 bytes per block
+	};
+
+	enum class BlockQuality {
+		FAST,   // endpoints from color bounding box
+		NORMAL, // endpoints from principal color axis
+		HIGH    // principal axis, then endpoints refined with least squares
+	};
+
+	uint64_t getBlockCompressedBytes(render::BufferSize size, BlockFormat format);
+
+	// Encodes tightly packed RGBA, blocksOut must hold getBlockCompressedBytes bytes. Colors are encoded as given,
+	// so sRGB data stays sRGB. Block rows are encoded on multiple threads, threadCount 0 uses all hardware threads.
+	void encodeBlocks(
+		std::span<const uint8_t> rgba, render::BufferSize size, BlockFormat format, BlockQuality quality,
+		std::span<uint8_t> blocksOut, uint32_t threadCount = 0);
+
+	MipChain encodeMipChain(const MipChain& rgba, BlockFormat format, BlockQuality quality, uint32_t threadCount = 0);
+}
@@ -6,6 +6,8 @@
 #include "render/WinDx.h"
 
 #include "assets/AssetFinder.h"
+#include "assets/TexCache.h"
+#include "assets/TexDecode.h"
 
 #include "DirectXTex.h"
 #include "magic_enum.hpp"
@@ -18,6 +20,8 @@ namespace assets
 {
     using namespace render;
     using ::std::vector;
+	using ::std::optional;
+	using ::std::shared_ptr;
 
 	struct FormatInfo {
 		DXGI_FORMAT dxgi = DXGI_FORMAT_UNKNOWN;
@@ -31,59 +35,51 @@ namespace assets
 		::util::throwError("Texture Load Error: " + message);
 	}
 
-	BufferSize getSize(const DirectX::TexMetadata& metadata)
+	d3d::SurfaceInfo getSurfaceInfo(const zenkit::Texture& tex, uint32_t mipLevel, DXGI_FORMAT format)
 	{
-		return {
-			.width = (uint16_t)metadata.width,
-			.height = (uint16_t)metadata.height,
+		BufferSize size = {
+			.width = (uint16_t)tex.mipmap_width(mipLevel),
+			.height = (uint16_t)tex.mipmap_height(mipLevel),
 		};
+		return d3d::calcSurfaceInfo(size, format);
 	}
 
-	d3d::SurfaceInfo getSurfaceInfo(const DirectX::Image * mipPtr)
+	vector<uint8_t> decodeToRgba8(const zenkit::Texture& tex, uint32_t mipLevel)
 	{
 		BufferSize size = {
-			.width = (uint16_t)mipPtr->width,
-			.height = (uint16_t)mipPtr->height,
+			.width = (uint16_t)tex.mipmap_width(mipLevel),
+			.height = (uint16_t)tex.mipmap_height(mipLevel),
 		};
-		return d3d::calcSurfaceInfo(size, mipPtr->format);
-	}
-
-	vector<d3d::InitialData> getInitialData(const DirectX::ScratchImage& image)
-	{
-		vector<d3d::InitialData> initialData;
-		initialData.reserve(image.GetImageCount());
-		for (uint32_t i = 0; i < image.GetImageCount(); i++) {
-			auto * mip = image.GetImage(i, 0, 0);
-			initialData.push_back({ mip->pixels, getSurfaceInfo(mip) });
+		const auto& data = tex.data(mipLevel);
+		std::span<const uint8_t> source = { (const uint8_t*)data.data(), data.size() };
+		vector<uint8_t> result((uint64_t)size.width * size.height * 4);
+		switch (tex.format()) {
+		case zenkit::TextureFormat::R5G6B5: decodeR5G6B5(source, size, result); break;
+		case zenkit::TextureFormat::DXT1: decodeDxt1(source, size, result); break;
+		case zenkit::TextureFormat::DXT3: decodeDxt3(source, size, result); break;
+		default: result = tex.as_rgba8(mipLevel);
 		}
-		return initialData;
+		return result;
 	}
 
-	d3d::SurfaceInfo getSurfaceInfo(const zenkit::Texture& tex, uint32_t mipLevel, DXGI_FORMAT format)
+	MipChain decodeMipChain(const zenkit::Texture& tex)
 	{
-		BufferSize size = {
-			.width = (uint16_t)tex.mipmap_width(mipLevel),
-			.height = (uint16_t)tex.mipmap_height(mipLevel),
-		};
-		return d3d::calcSurfaceInfo(size, format);
+		MipChain result;
+		for (uint32_t i = 0; i < tex.mipmaps(); i++) {
+			vector<uint8_t> decoded = decodeToRgba8(tex, i);
+			result.sizes.push_back({ (uint16_t)tex.mipmap_width(i), (uint16_t)tex.mipmap_height(i) });
+			result.offsets.push_back(result.data.size());
+			result.data.insert(result.data.end(), decoded.begin(), decoded.end());
+		}
+		return result;
 	}
 
-	vector<d3d::InitialData> getInitialData(
-		const zenkit::Texture& tex, DXGI_FORMAT format, bool decompress, vector<vector<uint8_t>>& decompressedDataOut)
+	vector<d3d::InitialData> getInitialData(const zenkit::Texture& tex, DXGI_FORMAT format)
 	{
-		decompressedDataOut.reserve(tex.mipmaps());
 		vector<d3d::InitialData> initialData;
 		initialData.reserve(tex.mipmaps());
-		if (decompress) {
-			for (uint32_t i = 0; i < tex.mipmaps(); i++) {
-				decompressedDataOut.emplace_back(tex.as_rgba8(i));
-				initialData.push_back({ decompressedDataOut.back().data(), getSurfaceInfo(tex, i, format) });
-			}
-		}
-		else {
-			for (uint32_t i = 0; i < tex.mipmaps(); i++) {
-				initialData.push_back({ (uint8_t*)tex.data(i).data(), getSurfaceInfo(tex, i, format) });
-			}
+		for (uint32_t i = 0; i < tex.mipmaps(); i++) {
+			initialData.push_back({ (uint8_t*)tex.data(i).data(), getSurfaceInfo(tex, i, format) });
 		}
 		return initialData;
 	}
@@ -115,6 +111,20 @@ namespace assets
 		return mipCount >= minExpectedMipCount;
 	}
 
+	// same as the mip count that GenerateMipMaps creates when passing 0 levels
+	uint16_t getFullMipCount(BufferSize size)
+	{
+		uint16_t count = 1;
+		uint32_t width = size.width;
+		uint32_t height = size.height;
+		while (width > 1 || height > 1) {
+			width = std::max(1u, width >> 1);
+			height = std::max(1u, height >> 1);
+			count++;
+		}
+		return count;
+	}
+
 	DirectX::Image createDirectXTexImage(BufferSize size, DXGI_FORMAT format, d3d::SurfaceInfo surface, const uint8_t* dataPtr)
 	{
 		return {
@@ -127,51 +137,256 @@ namespace assets
 		};
 	}
 
+	// lightmaps are smooth, so sharper filtering would only add ringing
+	constexpr MipFilter mipFilterTextures = MipFilter::KAISER;
+	constexpr MipFilter mipFilterLightmaps = MipFilter::BOX;
+
+	// Rebuilt and decompressed textures are block compressed into the same formats as TEX files (DXT1, DXT3), so they need
+	// less memory and share texture arrays with TEX textures. Lightmaps are kept uncompressed.
+	// Rebuilt DXT1 textures keep the transparent pixels of their 3-color blocks, because BC1 is encoded with 1-bit alpha.
+	constexpr bool compressRebuiltTextures = true;
+	constexpr BlockQuality compressQuality = BlockQuality::NORMAL;
 
-	void createMipmaps(DirectX::ScratchImage& imageAndTarget, const std::string name)
+	uint32_t getLoadThreadCount()
 	{
-		DirectX::ScratchImage imageWithMips;
-		auto hr = GenerateMipMaps(
-			imageAndTarget.GetImages(), imageAndTarget.GetImageCount(), imageAndTarget.GetMetadata(),
-			DirectX::TEX_FILTER_DEFAULT, 0, imageWithMips);
-		throwOnError(hr, name);
-		imageAndTarget = std::move(imageWithMips);
+		// mip generation and compression use per-thread working memory, so run single-threaded if already over budget
+		return isLoadMemoryOverBudget() ? 1 : 0;
 	}
 
-	Texture* createTexture(D3d d3d, BufferSize size, FormatInfo format, bool srgb, const vector<d3d::InitialData>& initialData)
+	MipChain createMipmaps(const DirectX::Image& mipZero, bool srgb, MipFilter filter)
 	{
-		ID3D11Texture2D* buffer = nullptr;
-		d3d::createTexture2dBuf(d3d, &buffer, size, format.dxgi, initialData);
-		ID3D11ShaderResourceView* srv = nullptr;
-		d3d::createTexture2dSrv(d3d, &srv, buffer);
-		release(buffer);
+		assert(mipZero.rowPitch == mipZero.width * 4);
+		BufferSize size = { (uint16_t)mipZero.width, (uint16_t)mipZero.height };
+		return generateMipsRgba8({ mipZero.pixels, mipZero.slicePitch }, size, srgb, filter, getLoadThreadCount());
+	}
+
+	DXGI_FORMAT getUncompressedFormat(bool srgb)
+	{
+		return srgb ? DXGI_FORMAT::DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT::DXGI_FORMAT_R8G8B8A8_UNORM;
+	}
+
+	FormatInfo getRebuildFormat(BufferSize size, bool hasAlpha, bool srgb, bool compress)
+	{
+		// D3D11 requires block compressed textures to have a multiple of block size
+		bool canCompress = size.width % 4 == 0 && size.height % 4 == 0;
+		if (compressRebuiltTextures && compress && canCompress) {
+			return getDxgiFormatIfSupported(hasAlpha ? zenkit::TextureFormat::DXT3 : zenkit::TextureFormat::DXT1, srgb);
+		}
+		return {
+			.dxgi = getUncompressedFormat(srgb),
+			.hasAlpha = hasAlpha,
+		};
+	}
+
+	MipChain compressIfNeeded(MipChain&& mips, FormatInfo format)
+	{
+		if (!DirectX::IsCompressed(format.dxgi)) {
+			return std::move(mips);
+		}
+		BlockFormat blockFormat = format.hasAlpha ? BlockFormat::BC2 : BlockFormat::BC1;
+		return encodeMipChain(mips, blockFormat, compressQuality, getLoadThreadCount());
+	}
+
+	// ###########################################################################
+	// TEX DATA
+	// ###########################################################################
+
+	uint64_t TexData::bytes() const
+	{
+		uint64_t result = 0;
+		for (const auto& mip : mips) {
+			result += (uint64_t) mip.surface.bytesPerRow * mip.surface.rowCount;
+		}
+		return result;
+	}
 
-		TexInfo info = {
+	TexInfo createTexInfo(BufferSize size, FormatInfo format, uint16_t mipLevels, bool srgb)
+	{
+		return {
 			.width = size.width,
 			.height = size.height,
-			.mipLevels = (uint16_t)initialData.size(),
+			.mipLevels = mipLevels,
 			.hasAlpha = format.hasAlpha,
 			.format = (uint32_t)format.dxgi,
 			.srgb = srgb,
 		};
+	}
 
-		return new Texture(info, srv);
+	TexData createTexData(BufferSize size, FormatInfo format, bool srgb, vector<d3d::InitialData>&& mips, const shared_ptr<void>& owner)
+	{
+		TexInfo info = createTexInfo(size, format, (uint16_t)mips.size(), srgb);
+		return { info, std::move(mips), owner };
 	}
 
-	Texture* createTextureFromImageFormat(D3d d3d, const FileData& imageFile, bool srgb)
+	TexData createTexData(CachedTexture&& cached, bool srgb)
+	{
+		auto owner = std::make_shared<CachedTexture>(std::move(cached));// mmap address does not change on move
+		FormatInfo format = {
+			.dxgi = owner->format,
+			.hasAlpha = owner->hasAlpha,
+		};
+		auto mips = owner->initialData;
+		return createTexData(owner->size, format, srgb, std::move(mips), owner);
+	}
+
+	TexData createTexData(MipChain&& mips, FormatInfo format, bool srgb)
+	{
+		auto owner = std::make_shared<MipChain>(std::move(mips));
+		vector<d3d::InitialData> initialData;
+		initialData.reserve(owner->sizes.size());
+		for (uint32_t i = 0; i < owner->sizes.size(); i++) {
+			initialData.push_back({ owner->mip(i), d3d::calcSurfaceInfo(owner->sizes[i], format.dxgi) });
+		}
+		return createTexData(owner->sizes[0], format, srgb, std::move(initialData), owner);
+	}
+
+	void storeCachedTexture(const TexCacheKey& cacheKey, const TexData& texData)
+	{
+		const auto& info = texData.info;
+		storeCachedTexture(cacheKey, info.getSize(), (DXGI_FORMAT)info.format, info.hasAlpha, texData.mips);
+	}
+
+	// ###########################################################################
+	// IMAGE FORMATS (TGA, PNG)
+	// ###########################################################################
+
+	// Image files are always converted to 8-bit RGBA with full mip chain, so only size and alpha need to be read from header.
+	// TGA alpha channels are often fully opaque though, so like DirectXTex, TGA alpha is decided by content if the header
+	// has an alpha channel, which needs the image to be decoded.
+
+	uint32_t readBigEndian32(const uint8_t* bytes)
+	{
+		return (bytes[0] << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+	}
+
+	optional<std::pair<BufferSize, bool>> readTgaHeader(const FileData& file)
+	{
+		const uint8_t* bytes = (const uint8_t*)file.data;
+		if (file.size < 18) {
+			return std::nullopt;
+		}
+		BufferSize size = {
+			.width = (uint16_t)(bytes[12] | (bytes[13] << 8)),
+			.height = (uint16_t)(bytes[14] | (bytes[15] << 8)),
+		};
+		uint8_t bitsPerPixel = bytes[16];
+		uint8_t alphaBits = bytes[17] & 0x0F;
+		return std::pair { size, bitsPerPixel == 32 || alphaBits > 0 };
+	}
+
+	optional<std::pair<BufferSize, bool>> readPngHeader(const FileData& file)
+	{
+		static constexpr std::array<uint8_t, 8> signature = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		const uint8_t* bytes = (const uint8_t*)file.data;
+		if (file.size < 33 || std::memcmp(bytes, signature.data(), signature.size()) != 0) {
+			return std::nullopt;
+		}
+		BufferSize size = {
+			.width = (uint16_t)readBigEndian32(bytes + 16),
+			.height = (uint16_t)readBigEndian32(bytes + 20),
+		};
+		uint8_t colorType = bytes[25];
+		bool hasAlpha = colorType == 4 || colorType == 6;
+
+		// palette or RGB images may have transparency chunk, which must come before first data chunk
+		uint64_t offset = 8;
+		while (!hasAlpha && offset + 8 <= file.size) {
+			uint32_t chunkLength = readBigEndian32(bytes + offset);
+			const char* chunkType = (const char*)(bytes + offset + 4);
+			if (std::memcmp(chunkType, "IDAT", 4) == 0) {
+				break;
+			}
+			if (std::memcmp(chunkType, "tRNS", 4) == 0) {
+				hasAlpha = true;
+			}
+			offset += 12 + (uint64_t)chunkLength;
+		}
+		return std::pair { size, hasAlpha };
+	}
+
+	void loadTga(const FileData& file, bool srgb, DirectX::TexMetadata& metadata, DirectX::ScratchImage& image, const std::string& name)
+	{
+		DirectX::TGA_FLAGS flags = DirectX::TGA_FLAGS_ALLOW_ALL_ZERO_ALPHA;
+		if (srgb) {
+			flags |= DirectX::TGA_FLAGS_DEFAULT_SRGB;
+		}
+		HRESULT hr = DirectX::LoadFromTGAMemory(file.data, file.size, flags, &metadata, image);
+		throwOnError(hr, name);
+	}
+
+	optional<TexInfo> probeImageFormat(const FileData& imageFile, bool srgb)
 	{
 		std::string name = ::util::asciiToLower(imageFile.name);
+		optional<std::pair<BufferSize, bool>> header = std::nullopt;
+		if (::util::endsWith(name, ".tga")) {
+			header = readTgaHeader(imageFile);
+			if (header.has_value() && header->second) {
+				DirectX::TexMetadata metadata;
+				DirectX::ScratchImage image;
+				loadTga(imageFile, srgb, metadata, image, name);
+				header->second = metadata.GetAlphaMode() != DirectX::TEX_ALPHA_MODE::TEX_ALPHA_MODE_OPAQUE;
+			}
+		}
+		else if (::util::endsWith(name, ".png")) {
+			header = readPngHeader(imageFile);
+		}
+		if (!header.has_value()) {
+			return std::nullopt;
+		}
+		auto [size, hasAlpha] = header.value();
+		FormatInfo format = getRebuildFormat(size, hasAlpha, srgb, true);
+		return createTexInfo(size, format, getFullMipCount(size), srgb);
+	}
+
+	void convertToFormat(DirectX::ScratchImage& imageAndTarget, DXGI_FORMAT format, const std::string& name)
+	{
+		DXGI_FORMAT current = imageAndTarget.GetMetadata().format;
+		if (current == format) {
+			return;
+		}
+		if (DirectX::MakeSRGB(current) == DirectX::MakeSRGB(format)) {
+			// only color space flag differs, which is decided by caller, not file
+			imageAndTarget.OverrideFormat(format);
+			return;
+		}
+		DirectX::ScratchImage converted;
+		auto hr = DirectX::Convert(
+			imageAndTarget.GetImages(), imageAndTarget.GetImageCount(), imageAndTarget.GetMetadata(),
+			format, DirectX::TEX_FILTER_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, converted);
+		throwOnError(hr, name);
+		imageAndTarget = std::move(converted);
+	}
+
+	TexData loadImageFormat(const FileData& imageFile, bool srgb)
+	{
+		std::string name = ::util::asciiToLower(imageFile.name);
+
+		auto probed = probeImageFormat(imageFile, srgb);
+		if (!probed.has_value()) {
+			throwError("Texture file format not supported or invalid header! " + name);
+		}
+		FormatInfo format = {
+			.dxgi = (DXGI_FORMAT)probed.value().format,
+			.hasAlpha = probed.value().hasAlpha,
+		};
+
+		// output format is decided by probing, so it only changes with compression settings
+		TexCacheKey cacheKey = {
+			.sourceHash = hashTexSource(imageFile.data, imageFile.size),
+			.format = (uint32_t)format.dxgi,
+			.srgb = srgb,
+		};
+		auto cached = loadCachedTexture(cacheKey);
+		if (cached.has_value()) {
+			return createTexData(std::move(cached.value()), srgb);
+		}
+
 		HRESULT hr;
 		DirectX::ScratchImage image;
 		DirectX::TexMetadata metadata;
 
 		if (::util::endsWith(name, ".tga")) {
-			DirectX::TGA_FLAGS flags = DirectX::TGA_FLAGS_ALLOW_ALL_ZERO_ALPHA;
-			if (srgb) {
-				flags |= DirectX::TGA_FLAGS_DEFAULT_SRGB;
-			}
-			hr = DirectX::LoadFromTGAMemory(imageFile.data, imageFile.size, flags, &metadata, image);
-			throwOnError(hr, name);
+			loadTga(imageFile, srgb, metadata, image, name);
 		}
 		else if (::util::endsWith(name, ".png")) {
 			DirectX::WIC_FLAGS flags = DirectX::WIC_FLAGS_NONE;
@@ -181,157 +396,286 @@ namespace assets
 			hr = DirectX::LoadFromWICMemory(imageFile.data, imageFile.size, flags, &metadata, image);
 			throwOnError(hr, name);
 		}
-		else {
-			throwError("Texture file format not supported!");
-		}
 
 		if (metadata.arraySize > 1) {
 			throwError("Texture files with mipmaps or layers are not supported!");
 		}
-		createMipmaps(image, name);
+		convertToFormat(image, getUncompressedFormat(srgb), name);
+		MipChain mips = createMipmaps(*image.GetImage(0, 0, 0), srgb, mipFilterTextures);
+		mips = compressIfNeeded(std::move(mips), format);
 
-		FormatInfo format = {
-			.dxgi = metadata.format,
-			.hasAlpha = metadata.GetAlphaMode() != DirectX::TEX_ALPHA_MODE::TEX_ALPHA_MODE_OPAQUE,
-		};
-		vector<d3d::InitialData> initialData = getInitialData(image);
-		return createTexture(d3d, getSize(metadata), format, srgb, initialData);
+		TexData result = createTexData(std::move(mips), format, srgb);
+		storeCachedTexture(cacheKey, result);
+		return result;
 	}
 
-	Texture* createDefaultTexture(D3d d3d)
+	TexData loadDefaultTexture()
 	{
 		// TODO maybe interal assets should be cached as well in AssetCache
 		FileData data = assets::getData(assets::getInternal(AssetsIntern::DEFAULT_TEXTURE));
-		return createTextureFromImageFormat(d3d, data, true);
+		return loadImageFormat(data, true);
+	}
+
+	TexInfo probeDefaultTexture()
+	{
+		FileData data = assets::getData(assets::getInternal(AssetsIntern::DEFAULT_TEXTURE));
+		return probeImageFormat(data, true).value();
 	}
 
-	Texture* createTextureFromGothicTex(D3d d3d, const zenkit::Texture& tex, const std::string name, bool srgb, std::optional<BufferSize> targetSizeOpt)
+	// ###########################################################################
+	// GOTHIC TEX
+	// ###########################################################################
+
+	struct GothicTexHeader {
+		zenkit::TextureFormat format;
+		BufferSize size;
+		uint32_t mipCount;
+	};
+
+	optional<GothicTexHeader> readGothicTexHeader(const FileData& file)
 	{
+		// see zenkit::Texture::load: signature, version, format, width, height, mipmap count, ...
+		const uint8_t* bytes = (const uint8_t*)file.data;
+		if (file.size < 24 || std::memcmp(bytes, "ZTEX", 4) != 0) {
+			return std::nullopt;
+		}
+		uint32_t values[5];
+		std::memcpy(values, bytes + 4, sizeof(values));
+		return GothicTexHeader {
+			.format = (zenkit::TextureFormat) values[1],
+			.size = { (uint16_t)values[2], (uint16_t)values[3] },
+			.mipCount = values[4],
+		};
+	}
+
+	struct GothicTexPlan {
+		bool supported = false;
 		bool decompress = false;
-		FormatInfo format = getDxgiFormatIfSupported(tex.format(), srgb);
+		bool rebuild = false;
+		bool resize = false;
+		FormatInfo format;
+		BufferSize size;
+		uint16_t mipCount = 0;
+	};
 
-		if (format.dxgi == DXGI_FORMAT_UNKNOWN) {
-			if (tex.format() == zenkit::TextureFormat::R5G6B5) {
+	// decides how a TEX file is converted based only on its header, so probing and loading always agree
+	GothicTexPlan planGothicTex(const GothicTexHeader& header, bool srgb, optional<BufferSize> targetSizeOpt, bool compress)
+	{
+		GothicTexPlan plan;
+		plan.format = getDxgiFormatIfSupported(header.format, srgb);
+
+		if (plan.format.dxgi == DXGI_FORMAT_UNKNOWN) {
+			if (header.format == zenkit::TextureFormat::R5G6B5) {
 				// basically only one G1 sky texture and lightmaps are R5G6B5 but what can you do
-				decompress = true;
-				format = {
-					.dxgi = srgb ? DXGI_FORMAT::DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT::DXGI_FORMAT_R8G8B8A8_UNORM,
-					.hasAlpha = false
-				};
+				plan.decompress = true;
+				plan.format = getRebuildFormat(header.size, false, srgb, compress);
 			}
 			else {
-				LOG(WARNING) << "Texture Load: Failed to load TEX because of unsupported format!";
-				return assets::createDefaultTexture(d3d);
+				return plan;
+			}
+		}
+		plan.supported = true;
+		plan.size = header.size;
+		plan.mipCount = header.mipCount;
+		plan.resize = targetSizeOpt.has_value() && header.size != targetSizeOpt.value();
+		plan.rebuild = plan.resize || !hasEnoughMipmaps(header.size, header.mipCount);
+
+		// when resizing we always re-generate all mips since that is easier and probably cleaner.
+		if (plan.rebuild) {
+			if (plan.resize) {
+				plan.size = targetSizeOpt.value();
 			}
+			plan.format = getRebuildFormat(plan.size, plan.format.hasAlpha, srgb, compress);
+			plan.mipCount = getFullMipCount(plan.size);
+		}
+		return plan;
+	}
+
+	TexCacheKey createRebuildCacheKey(uint64_t sourceHash, FormatInfo format, bool srgb, optional<BufferSize> targetSizeOpt)
+	{
+		return {
+			.sourceHash = sourceHash,
+			.format = (uint32_t) format.dxgi,
+			.srgb = srgb,
+			.targetSize = targetSizeOpt.value_or(BufferSize{ 0, 0 }),
+		};
+	}
+
+	optional<TexInfo> probeGothicTex(const FileData& file, bool srgb)
+	{
+		auto header = readGothicTexHeader(file);
+		if (!header.has_value()) {
+			return std::nullopt;
+		}
+		GothicTexPlan plan = planGothicTex(header.value(), srgb, std::nullopt, true);
+		if (!plan.supported) {
+			return std::nullopt;
 		}
+		return createTexInfo(plan.size, plan.format, plan.mipCount, srgb);
+	}
 
-		BufferSize size = { tex.width(), tex.height() };
+	TexData loadGothicTex(const FileData& file, bool srgb, optional<BufferSize> targetSizeOpt, bool compress)
+	{
+		auto name = ::util::asciiToLower(file.name);
+		assert(::util::endsWith(name, ".tex"));
 
-		bool resize = targetSizeOpt.has_value() && size != targetSizeOpt.value();
-		bool rebuild = resize || !hasEnoughMipmaps(size, tex.mipmaps());
+		auto header = readGothicTexHeader(file);
+		if (!header.has_value()) {
+			LOG(WARNING) << "Texture Load: Failed to load TEX because of invalid header! " << name;
+			return loadDefaultTexture();
+		}
+		GothicTexPlan plan = planGothicTex(header.value(), srgb, targetSizeOpt, compress);
+		if (!plan.supported) {
+			LOG(WARNING) << "Texture Load: Failed to load TEX because of unsupported format!";
+			return loadDefaultTexture();
+		}
 
-		// when resizing we always re-generate all mips since that is easier and probably cleaner.
-		if (rebuild) {
-			if (resize) {
+		// only rebuilt textures are cached, so a cache hit means we can skip parsing completely
+		TexCacheKey cacheKey;
+		if (plan.rebuild) {
+			cacheKey = createRebuildCacheKey(hashTexSource(file.data, file.size), plan.format, srgb, targetSizeOpt);
+			auto cached = loadCachedTexture(cacheKey);
+			if (cached.has_value()) {
+				return createTexData(std::move(cached.value()), srgb);
+			}
+		}
+
+		zenkit::Texture tex = {};
+		auto read = zenkit::Read::from(file.data, file.size);
+		tex.load(read.get());
+
+		if (plan.rebuild) {
+			static const std::string lightmapPrefix = "lightmap";
+			bool isLightmap = util::startsWith(name, lightmapPrefix);
+			if (plan.resize) {
 				LOG(DEBUG) << "Texture Load: Rebuilding texture for resize: " << name;
 			} else {
-				static const std::string lightmapPrefix = "lightmap";// lightmaps never have mipmaps, so logging it is noise
-				if (!util::startsWith(name, lightmapPrefix)) {
+				// lightmaps never have mipmaps, so logging it is noise
+				if (!isLightmap) {
 					LOG(DEBUG) << "Texture Load: Rebuilding texture due to missing mipmaps: " << name;
 				}
 			}
-			
-			format.dxgi = srgb ? DXGI_FORMAT::DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT::DXGI_FORMAT_R8G8B8A8_UNORM;
-			d3d::SurfaceInfo surface = d3d::calcSurfaceInfo(size, format.dxgi);
-			auto uncompressedMipZero = tex.as_rgba8(0);
-			DirectX::Image mipZero = createDirectXTexImage(size, format.dxgi, surface, uncompressedMipZero.data());
-
-			DirectX::ScratchImage image;
-			if (resize) {
-				auto targetSize = targetSizeOpt.value();
-				auto hr = Resize(mipZero, targetSize.width, targetSize.height, DirectX::TEX_FILTER_DEFAULT, image);
+
+			BufferSize size = header.value().size;
+			DXGI_FORMAT uncompressedFormat = getUncompressedFormat(srgb);
+			d3d::SurfaceInfo surface = d3d::calcSurfaceInfo(size, uncompressedFormat);
+			auto uncompressedMipZero = decodeToRgba8(tex, 0);
+			DirectX::Image mipZero = createDirectXTexImage(size, uncompressedFormat, surface, uncompressedMipZero.data());
+
+			MipFilter filter = isLightmap ? mipFilterLightmaps : mipFilterTextures;
+			MipChain mips;
+			if (plan.resize) {
+				DirectX::ScratchImage resized;
+				auto hr = Resize(mipZero, plan.size.width, plan.size.height, DirectX::TEX_FILTER_DEFAULT, resized);
 				throwOnError(hr, name);
-				size = targetSize;
+				mips = createMipmaps(*resized.GetImage(0, 0, 0), srgb, filter);
 			}
 			else {
-				image.InitializeFromImage(mipZero);
+				mips = createMipmaps(mipZero, srgb, filter);
 			}
-			
-			createMipmaps(image, name);
+			mips = compressIfNeeded(std::move(mips), plan.format);
 
-			vector<d3d::InitialData> initialData = getInitialData(image);
-			return createTexture(d3d, size, format, srgb, initialData);
+			TexData result = createTexData(std::move(mips), plan.format, srgb);
+			storeCachedTexture(cacheKey, result);
+			return result;
+		}
+		else if (plan.decompress) {
+			MipChain mips = compressIfNeeded(decodeMipChain(tex), plan.format);
+			return createTexData(std::move(mips), plan.format, srgb);
 		}
 		else {
-			// decompressedData must be kept alive until texture is created
-			vector<vector<uint8_t>> decompressedMips;
-			vector<d3d::InitialData> initialData = getInitialData(tex, format.dxgi, decompress, decompressedMips);
-			return createTexture(d3d, size, format, srgb, initialData);
+			auto texOwned = std::make_shared<zenkit::Texture>(std::move(tex));
+			vector<d3d::InitialData> initialData = getInitialData(*texOwned, plan.format.dxgi);
+			return createTexData(plan.size, plan.format, srgb, std::move(initialData), texOwned);
 		}
 	}
 
-	Texture* createTextureFromGothicTex(D3d d3d, const FileData& file, bool srgb)
-	{
-		auto name = ::util::asciiToLower(file.name);
-		assert(::util::endsWith(name, ".tex"));
-
-		zenkit::Texture tex = {};
-		auto read = zenkit::Read::from(file.data, file.size);
-		tex.load(read.get());
+	// ###########################################################################
+	// PUBLIC
+	// ###########################################################################
 
-		return createTextureFromGothicTex(d3d, tex, name, srgb, std::nullopt);
-	}
-
-	Texture* createTextureOrDefault(D3d d3d, const std::string& assetName, bool srgb)
+	TexInfo probeTextureOrDefault(const std::string& assetName, bool srgb)
 	{
-		// TODO consider passing TexId instead of assetName
-
 		auto opt = assets::getIfAnyExists(assetName, FORMATS_TEXTURE);
 		if (opt.has_value()) {
 			auto& [handle, ext] = opt.value();
 			auto data = assets::getData(handle);
+			optional<TexInfo> info;
 			if (ext.str() == FormatsCompiled::TEX.str()) {
-				return assets::createTextureFromGothicTex(d3d, data, srgb);
+				info = probeGothicTex(data, srgb);
 			}
 			else {
-				return assets::createTextureFromImageFormat(d3d, data, srgb);
+				info = probeImageFormat(data, srgb);
+			}
+			if (info.has_value()) {
+				return info.value();
 			}
 		}
-		else {
-			return createDefaultTexture(d3d);
-		}
+		return probeDefaultTexture();
 	}
 
-	BufferSize getMaxSize(const vector<zenkit::Texture>& textures)
+	TexData loadTextureDataOrDefault(const std::string& assetName, bool srgb)
 	{
-		BufferSize currentMax = { 0, 0 };
-		for (auto& tex : textures) {
-			currentMax.width = std::max(currentMax.width, (uint16_t)tex.width());
-			currentMax.height = std::max(currentMax.height, (uint16_t)tex.height());
+		auto opt = assets::getIfAnyExists(assetName, FORMATS_TEXTURE);
+		if (opt.has_value()) {
+			auto& [handle, ext] = opt.value();
+			auto data = assets::getData(handle);
+			if (ext.str() == FormatsCompiled::TEX.str()) {
+				return loadGothicTex(data, srgb, std::nullopt, true);
+			}
+			else if (probeImageFormat(data, srgb).has_value()) {
+				return loadImageFormat(data, srgb);
+			}
 		}
-		return currentMax;
+		return loadDefaultTexture();
+	}
+
+	Texture* createTexture(D3d d3d, const TexData& texData)
+	{
+		ID3D11Texture2D* buffer = nullptr;
+		d3d::createTexture2dBuf(d3d, &buffer, texData.info.getSize(), (DXGI_FORMAT)texData.info.format, texData.mips);
+		ID3D11ShaderResourceView* srv = nullptr;
+		d3d::createTexture2dSrv(d3d, &srv, buffer);
+		release(buffer);
+
+		return new Texture(texData.info, srv);
+	}
+
+	Texture* createTextureFromImageFormat(D3d d3d, const FileData& imageFile, bool srgb)
+	{
+		return createTexture(d3d, loadImageFormat(imageFile, srgb));
+	}
+
+	Texture* createTextureFromGothicTex(D3d d3d, const FileData& file, bool srgb)
+	{
+		return createTexture(d3d, loadGothicTex(file, srgb, std::nullopt, true));
+	}
+
+	Texture* createTextureOrDefault(D3d d3d, const std::string& assetName, bool srgb)
+	{
+		// TODO consider passing TexId instead of assetName
+		return createTexture(d3d, loadTextureDataOrDefault(assetName, srgb));
 	}
 
 	vector<Texture*> createTexturesFromLightmaps(D3d d3d, const vector<FileData>& lightmapFiles)
 	{
-		vector<zenkit::Texture> textures;
-		textures.reserve(lightmapFiles.size());
+		BufferSize targetSize = { 0, 0 };
 		for (auto& file : lightmapFiles) {
-			textures.emplace_back();
-			auto read = zenkit::Read::from(file.data, file.size);
-			textures.back().load(read.get());
+			auto header = readGothicTexHeader(file);
+			if (header.has_value()) {
+				targetSize.width = std::max(targetSize.width, header.value().size.width);
+				targetSize.height = std::max(targetSize.height, header.value().size.height);
+			}
 		}
 
-		const BufferSize& targetSize = getMaxSize(textures);
-
 		LOG(DEBUG) << "Texture Load: Rebuilding all lightmaps due to missing mipmaps!";
 		LOG(DEBUG) << "Texture Load: Resizing smaller lightmaps to target size " << targetSize << "!";
 
 		vector<Texture*> result;
-		result.reserve(textures.size());
-		for (uint32_t i = 0; i < textures.size(); i++) {
-			auto& name = lightmapFiles.at(i).name;
-			result.push_back(createTextureFromGothicTex(d3d, textures.at(i), name, true, targetSize));
+		result.reserve(lightmapFiles.size());
+		for (auto& file : lightmapFiles) {
+			// lightmaps are not compressed, since they have low resolution and are magnified a lot
+			result.push_back(createTexture(d3d, loadGothicTex(file, true, targetSize, false)));
 		}
 		return result;
 	}
@@ -4,6 +4,7 @@
 #include "render/Dx.h"
 #include "render/Loader.h"
 #include "render/Texture.h"
+#include "render/d3d/TextureBuffer.h"
 
 //#undef ERROR
 //#include "zenkit/Stream.hh"
@@ -11,6 +12,21 @@
 
 namespace assets
 {
+	// CPU-side texture with all mips, ready for upload. Mip data pointers stay valid as long as owner is alive.
+	struct TexData {
+		render::TexInfo info;
+		std::vector<render::d3d::InitialData> mips;
+		std::shared_ptr<void> owner;
+
+		uint64_t bytes() const;
+	};
+
+	// Only reads file headers, returns the TexInfo that loadTextureDataOrDefault will return for the same texture.
+	render::TexInfo probeTextureOrDefault(const std::string& assetName, bool srgb);
+	TexData loadTextureDataOrDefault(const std::string& assetName, bool srgb);
+
+	render::Texture* createTexture(render::D3d d3d, const TexData& texData);
+
 	render::Texture* createTextureFromImageFormat(
 		render::D3d d3d, const render::FileData& imageFile, bool srgb);
 
@@ -23,7 +39,6 @@ namespace assets
 	std::vector<render::Texture*> createTexturesFromLightmaps(
 		render::D3d d3d, const std::vector<render::FileData>& lightmapFiles);
 
-	// TODO consider re-compressing rebuilt, decompressed or uncompressed textures
-	// -> mixing TEX and image file textures will reduce batching efficiency due to incompatible formats
+	// Rebuilt, decompressed and image file textures are block compressed into the same formats as TEX files,
+	// except for lightmaps and textures whose size is not a multiple of 4.
 }
-
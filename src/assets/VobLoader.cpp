@@ -18,9 +18,9 @@ namespace assets
     using std::vector;
     using ::util::FileExt;
 
-    Color interpolateColorFromFaceXZ(const Vec3& pos, const MatToChunksToVertsBasic& meshData, const VertKey& vertKey)
+    Color interpolateColorFromFaceXZ(const Vec3& pos, const WorldFace& face)
     {
-        auto facePos = vertKey.getPos(meshData);
+        const auto& facePos = face.pos;
         float v0Distance = std::sqrt(std::pow(facePos[0].x - pos.x, 2.f) + std::pow(facePos[0].z - pos.z, 2.f));
         float v1Distance = std::sqrt(std::pow(facePos[1].x - pos.x, 2.f) + std::pow(facePos[1].z - pos.z, 2.f));
         float v2Distance = std::sqrt(std::pow(facePos[2].x - pos.x, 2.f) + std::pow(facePos[2].z - pos.z, 2.f));
@@ -29,7 +29,7 @@ namespace assets
         float v1Contrib = 1 - (v1Distance / totalDistance);
         float v2Contrib = 1 - (v2Distance / totalDistance);
 
-        auto faceOther = vertKey.getOther(meshData);
+        const auto& faceOther = face.other;
         Color colorAverage = mul(
             add(add(
                 mul(faceOther[0].colLight(), v0Contrib),
@@ -48,15 +48,14 @@ namespace assets
         result.direction = -1 * XMVectorSet(1, -0.5, -1.0, 0);
 
         const XMVECTOR center = render::bboxCenter(bbox);
-        const std::optional<VertKey> vertKey = getGroundFaceAtPos(center, worldMesh.data, worldMesh.spatialTree);
+        const std::optional<WorldFace> groundFace = getGroundFaceAtPos(center, worldMesh.data, worldMesh.spatialTree);
 
         bool hasLightmap = false;
         if (!isOutdoorLevel) {
             hasLightmap = true;
         }
-        else if (vertKey.has_value()) {
-            const auto& other = vertKey.value().getOther(worldMesh.data);
-            if (other[0].type() == VertexLightType::WORLD_LIGHTMAP) {
+        else if (groundFace.has_value()) {
+            if (groundFace->other[0].type() == VertexLightType::WORLD_LIGHTMAP) {
                 hasLightmap = true;
             }
         }
@@ -85,8 +84,8 @@ namespace assets
             result.color.a = 0;// indicates that this VOB receives no sky light
         }
         else {
-            if (vertKey.has_value()) {
-                result.color = interpolateColorFromFaceXZ(toVec3(center), worldMesh.data, vertKey.value());
+            if (groundFace.has_value()) {
+                result.color = interpolateColorFromFaceXZ(toVec3(center), groundFace.value());
 
                 // outdoor vobs get additional fixed ambient
                 if (isOutdoorLevel) {
@@ -14,8 +14,13 @@
 #include "zenkit/World.hh"
 #include "zenkit/vobs/Light.hh"
 
+#include "bvh/v2/thread_pool.h"
+#include "bvh/v2/executor.h"
+
 #include <glm/gtc/type_ptr.hpp>
 
+#include <numeric>
+
 namespace assets
 {
     using namespace render;
@@ -27,46 +32,11 @@ namespace assets
     using ::util::endsWithEither;
     using ::render::grid::Grid;
 
-    void forEachVob(const vector<shared_ptr<zenkit::VirtualObject>>& vobs, std::function<void(zenkit::VirtualObject const *const)> processVob)
-    {
-        for (auto vobPtr : vobs) {
-            processVob(vobPtr.get());
-            forEachVob(vobPtr->children, processVob);
-        }
-    }
-
-    vector<Light> loadLights(const vector<shared_ptr<zenkit::VirtualObject>>& rootVobs)
-    {
-        vector<Light> lights;
-        forEachVob(rootVobs, [&](zenkit::VirtualObject const* const vobPtr) -> void {
-            const zenkit::VirtualObject& vob = *vobPtr;
-            bool isLight = vob.type == zenkit::VirtualObjectType::zCVobLight;
-            if (isLight) {
-                const zenkit::VLight& vobLight = *dynamic_cast<zenkit::VLight const * const>(vobPtr);
-                bool isStatic = vobLight.is_static;
-                if (isStatic) {
-                    XMVECTOR pos = toXM4Pos(vob.position);
-                    Light light = {
-                        .pos = toVec3(pos * G_ASSET_RESCALE),
-                        .isStatic = true,
-                        .color = fromSRGB(from4xUint8(glm::value_ptr(vobLight.color))),
-                        .range = vobLight.range * G_ASSET_RESCALE
-                    };
-                    lights.push_back(light);
-                }
-            }
-        });
-
-        LOG(INFO) << "VOBs: Loaded " << lights.size() << " static lights";
-        return lights;
-    }
-
-    bool loadVob(zenkit::VirtualObject const* const vobPtr)
+    bool loadVob(const zenkit::VirtualObject& vob)
     {
         // TODO we should probably use visual type here, not extensions
         using namespace FormatsSource;
 
-        const zenkit::VirtualObject& vob = *vobPtr;
         const auto& visualName = vob.visual->name;
         if (vob.show_visual && !visualName.empty()) {
             if (endsWithEither(visualName, { __3DS, ASC, MDS, TGA })) {
@@ -82,73 +52,185 @@ namespace assets
         return false;
     }
 
-    vector<StaticInstance> loadVobs(
-        vector<std::shared_ptr<zenkit::VirtualObject>>& rootVobs,
-        const MatToChunksToVertsBasic& worldMeshData,
-        const vector<Light>& lightsStatic,
-        const bool isOutdoorLevel,
-        LoadDebugFlags debug)
+    // VOB tree flattened into arrays, containing only VOBs relevant for loading, in tree order.
+    // Visual names are interned and IDs are assigned in name order, so sorting by ID is equivalent to sorting by name.
+    struct VobTable {
+        vector<string> visualNames;// indexed by VisualId
+
+        vector<Light> lightsStatic;
+
+        // per visual VOB
+        vector<VisualId> visualIds;
+        vector<VisualType> visualTypes;
+        vector<XMMATRIX> transforms;
+        vector<std::array<XMVECTOR, 2>> bboxes;
+        vector<std::optional<Decal>> decals;
+
+        uint32_t visualVobCount() const
+        {
+            return visualIds.size();
+        }
+    };
+
+    XMMATRIX createVobTransform(const zenkit::VirtualObject& vob)
     {
-        vector<StaticInstance> statics;
+        glm::mat4x4 rotation(vob.rotation);
+        // TODO we have no idea if this is row or column first, so may need to transpose.
+        XMMATRIX rotate = XMMATRIX(glm::value_ptr(rotation));
 
-        const FaceLookupContext worldMeshContext = { createVertLookup(worldMeshData), worldMeshData };
-        const LightLookupContext lightsStaticContext = { createLightLookup(lightsStatic), lightsStatic };
+        XMVECTOR pos = toXM4Pos(toVec3(vob.position, G_ASSET_RESCALE));
+        XMMATRIX translate = XMMatrixTranslationFromVector(pos);
+        return XMMatrixMultiply(rotate, translate);
+    }
 
-        forEachVob(rootVobs, [&](zenkit::VirtualObject const* const vobPtr) -> void {
-            if (!loadVob(vobPtr)) {
-                return;
+    VobTable flattenVobs(const vector<shared_ptr<zenkit::VirtualObject>>& rootVobs)
+    {
+        VobTable table;
+        std::unordered_map<std::string_view, VisualId> visualNameToId;
+
+        // depth-first pre-order without recursion or shared_ptr copies
+        vector<const zenkit::VirtualObject*> stack;
+        for (auto it = rootVobs.rbegin(); it != rootVobs.rend(); it++) {
+            stack.push_back(it->get());
+        }
+        while (!stack.empty()) {
+            const zenkit::VirtualObject& vob = *stack.back();
+            stack.pop_back();
+            for (auto it = vob.children.rbegin(); it != vob.children.rend(); it++) {
+                stack.push_back(it->get());
             }
-            const zenkit::VirtualObject& vob = *vobPtr;
-            StaticInstance instance;
-            instance.type = (VisualType) vob.visual->type;
-            instance.visual_name = vob.visual->name;
-            {
-                glm::mat4x4 rotation(vob.rotation);
-                // TODO we have no idea if this is row or column first, so may need to transpose.
-                XMMATRIX rotate = XMMATRIX(glm::value_ptr(rotation));
-                
-                XMVECTOR pos = toXM4Pos(toVec3(vob.position, G_ASSET_RESCALE));
-                XMMATRIX translate = XMMatrixTranslationFromVector(pos);
-                instance.transform = XMMatrixMultiply(rotate, translate);
+
+            if (vob.type == zenkit::VirtualObjectType::zCVobLight) {
+                const auto& vobLight = static_cast<const zenkit::VLight&>(vob);
+                if (vobLight.is_static) {
+                    XMVECTOR pos = toXM4Pos(vob.position);
+                    table.lightsStatic.push_back({
+                        .pos = toVec3(pos * G_ASSET_RESCALE),
+                        .isStatic = true,
+                        .color = fromSRGB(from4xUint8(glm::value_ptr(vobLight.color))),
+                        .range = vobLight.range * G_ASSET_RESCALE
+                    });
+                }
             }
-            instance.bbox = {
-                    toXM4Pos(toVec3(vob.bbox.min, G_ASSET_RESCALE)),
-                    toXM4Pos(toVec3(vob.bbox.max, G_ASSET_RESCALE))
-            };
+
+            if (!loadVob(vob)) {
+                continue;
+            }
+            // names are owned by the world, which outlives this function
+            auto [it, wasInserted] = visualNameToId.try_emplace(vob.visual->name, (VisualId) visualNameToId.size());
+            table.visualIds.push_back(it->second);
+            table.visualTypes.push_back((VisualType) vob.visual->type);
+            table.transforms.push_back(createVobTransform(vob));
+            table.bboxes.push_back({
+                toXM4Pos(toVec3(vob.bbox.min, G_ASSET_RESCALE)),
+                toXM4Pos(toVec3(vob.bbox.max, G_ASSET_RESCALE))
+            });
             if (vob.visual->type == zenkit::VisualType::DECAL) {
-                //assert(::util::endsWith(instance.meshName, ".TGA"));
-                const zenkit::VisualDecal* decalVisual = dynamic_cast<zenkit::VisualDecal*>(vobPtr->visual.get());
-                instance.decal = Decal{
-                    .quad_size = toVec2(decalVisual->dimension),
-                    .uv_offset = toUv(decalVisual->offset),
-                    .two_sided = decalVisual->two_sided,
-                    .alpha = decalVisual->alpha_func,
-                };
+                const auto& decalVisual = static_cast<const zenkit::VisualDecal&>(*vob.visual);
+                table.decals.push_back(Decal {
+                    .quad_size = toVec2(decalVisual.dimension),
+                    .uv_offset = toUv(decalVisual.offset),
+                    .two_sided = decalVisual.two_sided,
+                    .alpha = decalVisual.alpha_func,
+                });
             }
-            {
-                VobLighting lighting = calculateStaticVobLighting(instance.bbox, worldMeshContext, lightsStaticContext, isOutdoorLevel, debug);
-                if (debug.vobsTint) {
-                    lighting.color.r = (lighting.color.r / 3.f) * 2.f;
-                }
-                if (instance.decal.has_value()) {
-                    // TODO figure out decal lighting, especially ADD, instead of hacking it in shader
+            else {
+                table.decals.push_back(std::nullopt);
+            }
+        }
+
+        // assign final IDs in name order
+        vector<std::string_view> sortedNames(visualNameToId.size());
+        for (auto& [name, id] : visualNameToId) {
+            sortedNames[id] = name;
+        }
+        vector<VisualId> remap(sortedNames.size());
+        vector<VisualId> order(sortedNames.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](VisualId lhs, VisualId rhs) -> bool {
+            return sortedNames[lhs] < sortedNames[rhs];
+        });
+        table.visualNames.reserve(order.size());
+        for (VisualId newId = 0; newId < order.size(); newId++) {
+            remap[order[newId]] = newId;
+            table.visualNames.emplace_back(sortedNames[order[newId]]);
+        }
+        for (VisualId& visualId : table.visualIds) {
+            visualId = remap[visualId];
+        }
+
+        LOG(INFO) << "VOBs: Loaded " << table.lightsStatic.size() << " static lights";
+        return table;
+    }
+
+    // returns instances sorted by visual
+    vector<StaticInstance> loadVobs(
+        const VobTable& vobs,
+        const MeshDataBasic& worldMeshData,
+        const bool isOutdoorLevel,
+        LoadDebugFlags debug)
+    {
+        const FaceLookupContext worldMeshContext = { createVertLookup(worldMeshData, debug.faceLookupQuality, debug.faceLookupCached), worldMeshData };
+        const LightLookupContext lightsStaticContext = { createLightLookup(vobs.lightsStatic), vobs.lightsStatic };
+
+        // stable counting sort by visual
+        vector<uint32_t> visualOffsets(vobs.visualNames.size() + 1, 0);
+        for (VisualId visualId : vobs.visualIds) {
+            visualOffsets[visualId + 1]++;
+        }
+        for (uint32_t i = 1; i < visualOffsets.size(); i++) {
+            visualOffsets[i] += visualOffsets[i - 1];
+        }
+        vector<uint32_t> targetIndices(vobs.visualVobCount());
+        for (uint32_t i = 0; i < vobs.visualVobCount(); i++) {
+            targetIndices[i] = visualOffsets[vobs.visualIds[i]]++;
+        }
+        vector<StaticInstance> statics(vobs.visualVobCount());
+
+        // every instance is written to its own slot and lookup trees are only read, so instances are filled in parallel
+        bool overBudget = isLoadMemoryOverBudget();
+        bvh::v2::ThreadPool threadPool(overBudget ? 1 : 0);
+        bvh::v2::ParallelExecutor executor(threadPool, 64);
+        executor.for_each(0, vobs.visualVobCount(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                StaticInstance& instance = statics[targetIndices[i]];
+                instance.type = vobs.visualTypes[i];
+                instance.visualId = vobs.visualIds[i];
+                instance.transform = vobs.transforms[i];
+                instance.bbox = vobs.bboxes[i];
+                instance.decal = vobs.decals[i];
+                {
+                    VobLighting lighting = calculateStaticVobLighting(instance.bbox, worldMeshContext, lightsStaticContext, isOutdoorLevel, debug);
+                    if (debug.vobsTint) {
+                        lighting.color.r = (lighting.color.r / 3.f) * 2.f;
+                    }
+                    if (instance.decal.has_value()) {
+                        // TODO figure out decal lighting, especially ADD, instead of hacking it in shader
+                    }
+                    instance.lighting = lighting;
                 }
-                instance.lighting = lighting;
             }
-            statics.push_back(instance);
         });
 
+        // lookup trees are released on return, so this is likely the peak of VOB loading
+        sampleLoadMemory();
+
         LOG(INFO) << "VOBs: Loaded " << statics.size() << " instances";
         return statics;
     }
 
-    bool loadInstanceVisual(MatToChunksToVertsBasic& target, Grid& grid, const StaticInstance& instance, bool indexed, bool debugChecksEnabled)
+    // all instances must use the given visual
+    bool loadInstanceVisuals(
+        MeshDataBasic& target, Grid& grid, std::string_view name, std::span<const StaticInstance> instances, bool indexed, bool debugChecksEnabled)
     {
         using namespace FormatsSource;
         using namespace FormatsCompiled;
-        const auto& name = instance.visual_name;
+        assert(!instances.empty());
+
+        // MDH and MDM must both stay cached until all instances have been created
+        AssetCachePinScope pinScope;
 
-        switch (instance.type) {
+        switch (instances[0].type) {
         case VisualType::MULTI_RESOLUTION_MESH: {
             assert(__3DS.isExtOf(name));
             auto compiledName = ::util::replaceExtension(name, MRM.str());
@@ -157,7 +239,7 @@ namespace assets
                 LOG(INFO) << "Failed to find MRM data for visual: " << name;
                 return false;
             }
-            loadInstanceMesh(target, grid, *meshOpt.value(), instance, indexed, debugChecksEnabled);
+            loadInstanceMesh(target, grid, *meshOpt.value(), name, instances, indexed, debugChecksEnabled);
             return true;
         }
         case VisualType::MODEL: {
@@ -176,7 +258,7 @@ namespace assets
                     // try MDH+MDM
                 }
                 else {
-                    loadInstanceModel(target, grid, meshOpt.value()->hierarchy, meshOpt.value()->mesh, instance, indexed, debugChecksEnabled);
+                    loadInstanceModel(target, grid, meshOpt.value()->hierarchy, meshOpt.value()->mesh, name, instances, indexed, debugChecksEnabled);
                     return true;
                 }
             } {
@@ -189,13 +271,15 @@ namespace assets
                     LOG(INFO) << "Failed to find MDH + MDM data for visual: " << name;
                     return false;
                 }
-                loadInstanceModel(target, grid, *mdhOpt.value(), *mdmOpt.value(), instance, indexed, debugChecksEnabled);
+                loadInstanceModel(target, grid, *mdhOpt.value(), *mdmOpt.value(), name, instances, indexed, debugChecksEnabled);
                 return true;
             }
         }
         case VisualType::DECAL: {
             assert(TGA.isExtOf(name));
-            loadInstanceDecal(target, grid, instance, indexed, debugChecksEnabled);
+            for (const StaticInstance& instance : instances) {
+                loadInstanceDecal(target, grid, name, instance, indexed, debugChecksEnabled);
+            }
             return true;
         }
         default: {
@@ -215,59 +299,89 @@ namespace assets
         auto sampler = render::stats::TimeSampler();
         sampler.start();
 
-        auto fileData = assets::getData(levelFile);
-        zenkit::World world{};
+        // zenkit world and level file data are only needed until world mesh and VOBs have been converted, so they are
+        // released before lookup trees are built and VOB visuals are loaded to reduce peak memory usage
+        VobTable vobTable;
         {
-            auto read = zenkit::Read::from(fileData.data, fileData.size);
-            try {
-                zenkit::GameVersion version = world.load(read.get());
-                out.isG2 = version == zenkit::GameVersion::GOTHIC_2;
-            }
-            catch (const std::exception& ex) {
-                util::throwError(ex.what());
+            auto fileData = assets::getData(levelFile);
+            zenkit::World world{};
+            {
+                auto read = zenkit::Read::from(fileData.data, fileData.size);
+                try {
+                    zenkit::GameVersion version = world.load(read.get());
+                    out.isG2 = version == zenkit::GameVersion::GOTHIC_2;
+                }
+                catch (const std::exception& ex) {
+                    util::throwError(ex.what());
+                }
             }
-        }
 
-        out.isOutdoorLevel = world.world_bsp_tree.mode == zenkit::BspTreeType::OUTDOOR;
-        sampler.logMillisAndRestart("Loader: World data parsed");
+            out.isOutdoorLevel = world.world_bsp_tree.mode == zenkit::BspTreeType::OUTDOOR;
+            sampleLoadMemory();
+            sampler.logMillisAndRestart("Loader: World data parsed");
 
-        out.chunkGrid = loadWorldMesh(out.worldMesh, world.world_mesh, !debug.disableVertexIndices, debug.validateMeshData);
-
-        for (uint32_t i = 0; i < world.world_mesh.lightmap_textures.size(); i++) {
-            auto& lightmap = world.world_mesh.lightmap_textures.at(i);
-            auto name = std::format("lightmap_{:03}.tex", i);
-            out.worldMeshLightmaps.emplace_back(name, (std::byte*)lightmap->data(), lightmap->size(), lightmap);
-        }
-        sampler.logMillisAndRestart("Loader: World mesh loaded");
+            out.chunkGrid = loadWorldMesh(out.worldMesh, world.world_mesh, !debug.disableVertexIndices, debug.validateMeshData);
 
+            for (uint32_t i = 0; i < world.world_mesh.lightmap_textures.size(); i++) {
+                auto& lightmap = world.world_mesh.lightmap_textures.at(i);
+                auto name = std::format("lightmap_{:03}.tex", i);
+                // shares ownership of lightmap data, so it outlives zenkit world
+                out.worldMeshLightmaps.emplace_back(name, (std::byte*)lightmap->data(), lightmap->size(), lightmap);
+            }
+            sampleLoadMemory();
+            sampler.logMillisAndRestart("Loader: World mesh loaded");
 
-        if (debug.loadVobs) {
-            LOG(INFO);
-            LOG(INFO) << "        #####################################";
-            LOG(INFO) << "        Loading World Objects";
-            LOG(INFO) << "        #####################################";
+            if (debug.loadVobs) {
+                LOG(INFO);
+                LOG(INFO) << "        #####################################";
+                LOG(INFO) << "        Loading World Objects";
+                LOG(INFO) << "        #####################################";
 
-            vector<Light> lightsStatic = loadLights(world.world_vobs);
+                vobTable = flattenVobs(world.world_vobs);
+            }
+        }
 
-            vector<StaticInstance> vobs;
-            vobs = loadVobs(world.world_vobs, out.worldMesh, lightsStatic, out.isOutdoorLevel, debug);
+        if (debug.loadVobs) {
+            vector<StaticInstance> vobs = loadVobs(vobTable, out.worldMesh, out.isOutdoorLevel, debug);
             sampler.logMillisAndRestart("Loader: World VOB data loaded");
 
-            std::sort(vobs.begin(), vobs.end(), [](const StaticInstance& left, const StaticInstance& right) -> bool {
-                return left.visual_name < right.visual_name;
-            });
-
             uint32_t instanceId = 0;
-            for (auto& instance : vobs) {
-                // we skip decals from having per-instance data for now until we actually need it
-                instance.id = instance.decal.has_value() ? instanceIdNone : instanceId;
-                bool success = loadInstanceVisual(out.staticMeshes, out.chunkGrid, instance, !debug.disableVertexIndices, debug.validateMeshData);
-                if (success && instance.decal.has_value()) {
-                    out.staticInstances.push_back({ toVec3(XMVector3Normalize(instance.lighting.direction)) });
-                    instanceId++;
+            for (uint32_t groupStart = 0, groupEnd = 0; groupStart < vobs.size(); groupStart = groupEnd) {
+                // instances are sorted by visual, so all instances of a visual can be created together
+                groupEnd = groupStart + 1;
+                while (groupEnd < vobs.size() && vobs[groupEnd].visualId == vobs[groupStart].visualId) {
+                    groupEnd++;
+                }
+                std::span<StaticInstance> group(vobs.data() + groupStart, groupEnd - groupStart);
+
+                uint32_t instanceIdNext = instanceId;
+                for (auto& instance : group) {
+                    // we skip decals from having per-instance data for now until we actually need it
+                    bool hasInstanceData = !instance.decal.has_value();
+                    if (hasInstanceData && instanceIdNext >= instanceIdCountMax) {
+                        util::throwError(std::format("VOBs: At most {} lit instances are supported!", instanceIdCountMax));
+                    }
+                    instance.id = hasInstanceData ? instanceIdNext++ : instanceIdNone;
+                }
+                std::string_view visualName = vobTable.visualNames[group[0].visualId];
+                bool success = loadInstanceVisuals(
+                    out.staticMeshes, out.chunkGrid, visualName, group, !debug.disableVertexIndices, debug.validateMeshData);
+                if (success) {
+                    for (const auto& instance : group) {
+                        if (instance.id != instanceIdNone) {
+                            const Color& color = instance.lighting.color;
+                            out.staticInstances.push_back({
+                                .dirLight = toVec3(XMVector3Normalize(instance.lighting.direction)),
+                                .colLight = { color.r, color.g, color.b },
+                            });
+                        }
+                    }
+                    instanceId = instanceIdNext;
                 }
             }
+            out.staticMeshes.finalize();
             LOG(INFO) << "VOBs: Loaded " << instanceId << " instance visuals";
+            sampleLoadMemory();
 
             sampler.logMillisAndRestart("Loader: VOB visuals loaded");
         }
@@ -278,5 +392,6 @@ namespace assets
         LOG(INFO) << "        #####################################";
 
         printAndResetLoadStats(debug.validateMeshData);
+        printAndResetAssetCacheStats();
     }
 }
@@ -1,9 +1,64 @@
 #include "stdafx.h"
 #include "Loader.h"
 
+#include <atomic>
+#include <windows.h>
+#include <Psapi.h>
+
 // Needed because Mmap must be complete type for default destructor to compile
 //#include "zenkit/Mmap.hh" 
 
+namespace assets
+{
+	// preloading may sample from a background thread while the main thread renders
+	std::atomic<uint64_t> loadMemoryBudget = loadMemoryBudgetDefault;
+	std::atomic<uint64_t> loadMemoryPeak = 0;
+
+	void setLoadMemoryBudget(uint64_t budgetBytes)
+	{
+		loadMemoryBudget = budgetBytes;
+	}
+
+	uint64_t getLoadMemoryBudget()
+	{
+		return loadMemoryBudget;
+	}
+
+	uint64_t sampleLoadMemory()
+	{
+		PROCESS_MEMORY_COUNTERS_EX2 memCounters = {};
+		GetProcessMemoryInfo(GetCurrentProcess(), (PPROCESS_MEMORY_COUNTERS)&memCounters, sizeof(memCounters));
+		uint64_t current = memCounters.PrivateWorkingSetSize;
+
+		uint64_t peak = loadMemoryPeak;
+		while (current > peak && !loadMemoryPeak.compare_exchange_weak(peak, current)) {}
+		return current;
+	}
+
+	uint64_t sampleLoadMemoryExcess()
+	{
+		uint64_t current = sampleLoadMemory();
+		uint64_t budget = loadMemoryBudget;
+		return current > budget ? current - budget : 0;
+	}
+
+	bool isLoadMemoryOverBudget()
+	{
+		return sampleLoadMemoryExcess() > 0;
+	}
+
+	void resetLoadMemoryPeak()
+	{
+		loadMemoryPeak = 0;
+		sampleLoadMemory();
+	}
+
+	uint64_t getLoadMemoryPeak()
+	{
+		return loadMemoryPeak;
+	}
+}
+
 namespace render
 {
 	FileData::FileData(FileData&&) noexcept = default;
@@ -8,10 +8,18 @@
 
 namespace assets
 {
+	enum class LookupTreeQuality {
+		LOW, MEDIUM, HIGH
+	};
+
 	struct LoadDebugFlags {
 		bool loadVobs = true;
 		bool validateMeshData = true;
 
+		// world face BVH is cached on disk, so we can afford a high quality build on cold loads
+		LookupTreeQuality faceLookupQuality = LookupTreeQuality::HIGH;
+		bool faceLookupCached = true;
+
 		bool disableVobToLightVisibilityRayChecks = false;
 		bool disableVertexIndices = false;
 
@@ -22,15 +30,34 @@ namespace assets
 		bool staticLightTintUnreached = false;
 	};
 
+	// Level loading tries to keep the private working set of the process below this budget. While over budget, the BVH
+	// build, VOB lighting and texture mip generation/compression run single-threaded, decoded texture data is evicted after
+	// every texture array upload and background preloading is skipped. Mesh conversion is single-threaded anyway, its
+	// staging memory is bounded by the asset cache budget and the fixed vertex count per batch, not by this budget.
+	// 32-bit processes are limited by address space, so the default budget is much lower for them.
+	const uint64_t loadMemoryBudgetDefault = sizeof(void*) == 4 ? (1280ull * 1024 * 1024) : (6144ull * 1024 * 1024);
+
+	void setLoadMemoryBudget(uint64_t budgetBytes);
+	uint64_t getLoadMemoryBudget();
+
+	// Samples current private working set and updates the peak since last reset. Should be called at load stage boundaries.
+	uint64_t sampleLoadMemory();
+	// returns by how many bytes the sampled private working set exceeds the budget (0 if within budget)
+	uint64_t sampleLoadMemoryExcess();
+	bool isLoadMemoryOverBudget();
+
+	void resetLoadMemoryPeak();
+	uint64_t getLoadMemoryPeak();
+
 	namespace FormatsSource
 	{
-		const ::util::FileExt __3DS = ::util::FileExt::create(".3DS");
-		const ::util::FileExt ASC = ::util::FileExt::create(".ASC");
-		const ::util::FileExt MDS = ::util::FileExt::create(".MDS");
-		const ::util::FileExt PFX = ::util::FileExt::create(".PFX");
-		const ::util::FileExt MMS = ::util::FileExt::create(".MMS");
-		const ::util::FileExt TGA = ::util::FileExt::create(".TGA");
-		const ::util::FileExt PNG = ::util::FileExt::create(".PNG");
+		inline const ::util::FileExt __3DS = ::util::FileExt::create(".3DS");
+		inline const ::util::FileExt ASC = ::util::FileExt::create(".ASC");
+		inline const ::util::FileExt MDS = ::util::FileExt::create(".MDS");
+		inline const ::util::FileExt PFX = ::util::FileExt::create(".PFX");
+		inline const ::util::FileExt MMS = ::util::FileExt::create(".MMS");
+		inline const ::util::FileExt TGA = ::util::FileExt::create(".TGA");
+		inline const ::util::FileExt PNG = ::util::FileExt::create(".PNG");
 
 		const std::initializer_list ALL = { __3DS, ASC, MDS, PFX, MMS, TGA, PNG };
 	}
@@ -42,13 +69,13 @@ namespace assets
 	// MDL = model hierarchy including all used single meshes
 	namespace FormatsCompiled
 	{
-		const ::util::FileExt ZEN = ::util::FileExt::create(".ZEN");
-		const ::util::FileExt TEX = ::util::FileExt::create(".TEX");
-		const ::util::FileExt MRM = ::util::FileExt::create(".MRM");
-		const ::util::FileExt MDM = ::util::FileExt::create(".MDM");
-		const ::util::FileExt MDH = ::util::FileExt::create(".MDH");
-		const ::util::FileExt MDL = ::util::FileExt::create(".MDL");
-		const ::util::FileExt MAN = ::util::FileExt::create(".MAN");
+		inline const ::util::FileExt ZEN = ::util::FileExt::create(".ZEN");
+		inline const ::util::FileExt TEX = ::util::FileExt::create(".TEX");
+		inline const ::util::FileExt MRM = ::util::FileExt::create(".MRM");
+		inline const ::util::FileExt MDM = ::util::FileExt::create(".MDM");
+		inline const ::util::FileExt MDH = ::util::FileExt::create(".MDH");
+		inline const ::util::FileExt MDL = ::util::FileExt::create(".MDL");
+		inline const ::util::FileExt MAN = ::util::FileExt::create(".MAN");
 
 		const std::initializer_list ALL = { ZEN, TEX, MRM, MDM, MDH, MDL, MAN };
 	}
@@ -89,15 +116,19 @@ namespace render
 		// Seems very likely that a texture is always used with the same alphafunc, so just pass it to shader when setting texture?
 	};
 
+	// per-instance data addressed by instance ID, uploaded as structured buffer (must match HLSL struct)
 	struct StaticInstanceFeatures {
 		Vec3 dirLight;
+		Vec3 colLight;
 	};
 
+	using VisualId = uint32_t;
+
 	// TODO this should not be here?
 	struct StaticInstance {
 		uint32_t id;
 		VisualType type;
-		std::string visual_name;
+		VisualId visualId;// name is only resolved (from VOB table) when loading the visual, once for all its instances
 		DirectX::XMMATRIX transform;
 		std::array<DirectX::XMVECTOR, 2> bbox;// pos_min, pos_max, TODO rename to bboxGlobal to make clear it is already transformed to world space
 		VobLighting lighting;
@@ -154,8 +185,8 @@ namespace render
 		bool isG2 = false;
 		bool isOutdoorLevel = false;
 		grid::Grid chunkGrid;
-		MatToChunksToVertsBasic worldMesh;
-		MatToChunksToVertsBasic staticMeshes;
+		MeshDataBasic worldMesh;
+		MeshDataBasic staticMeshes;
 		std::vector<StaticInstanceFeatures> staticInstances;
 		std::vector<FileData> worldMeshLightmaps;
 	};
@@ -186,7 +186,11 @@ namespace render
 			}
 		}
 		if (defaultSky) {
-			sky::loadSky(d3d);
+			static bool skyLoaded = false;// sky is independent from level
+			if (!skyLoaded) {
+				sky::loadSky(d3d);
+				skyLoaded = true;
+			}
 		}
 		else {
 			world::getWorldSettings().drawSky = false;
@@ -195,6 +199,11 @@ namespace render
 		return loaded;
 	}
 
+	void preloadLevel(const std::string& level)
+	{
+		world::preloadWorld(dx11, level);
+	}
+
 	void onWindowResize(const BufferSize& changedSize)
 	{
 		auto& d3d = dx11;
@@ -23,17 +23,25 @@ namespace render
 
 		VertexBuffer vbPos = { sizeof(VertexPos) };
 		VertexBuffer vbNormalUv = { sizeof(VertexNorUv) };
-		VertexBuffer vbTexIndices = { sizeof(TexIndex) };// indices into texture array (base color textures)
 		VertexBuffer vbOther = { sizeof(VertexBasic) };
 
+		// indices into texture array (base color textures), one TexIndexRange per run of verts with the same texture
+		ID3D11ShaderResourceView* texIndicesSb = nullptr;
+		ID3D11ShaderResourceView* texIndexBucketsSb = nullptr;// see texIndexBucketVertCount
+
+		// only used with VertexFormat::COMPACT, quantization bounds per vertClusters entry
+		ID3D11ShaderResourceView* clusterBoundsSb = nullptr;
+
 		void release()
 		{
 			render::release(texColorArray);
 			render::release(vbIndices.buffer);
 			render::release(vbPos.buffer);
 			render::release(vbNormalUv.buffer);
-			render::release(vbTexIndices.buffer);
 			render::release(vbOther.buffer);
+			render::release(texIndicesSb);
+			render::release(texIndexBucketsSb);
+			render::release(clusterBoundsSb);
 		}
 	};
 
@@ -43,11 +51,12 @@ namespace render
 		d3d::Shader shader;
 		GetVertexBuffers getVertexBuffers = nullptr;
 
-		static ShaderContext init(D3d d3d, const std::string& shaderName, const std::initializer_list<VertexAttributes>& attributes, GetVertexBuffers getVertexBuffers)
+		static ShaderContext init(D3d d3d, const std::string& shaderName, const std::initializer_list<VertexAttributes>& attributes, GetVertexBuffers getVertexBuffers,
+			VertexFormat vertexFormat = VertexFormat::DEFAULT)
 		{
 			ShaderContext result;
 			result.getVertexBuffers = getVertexBuffers;
-			d3d::createShader(d3d, result.shader, shaderName, d3d::buildInputLayoutDesc(attributes));
+			d3d::createShader(d3d, result.shader, shaderName, d3d::buildInputLayoutDesc(attributes), false, vertexFormat);
 			return result;
 		}
 
@@ -64,6 +73,7 @@ namespace render
 
 	void initD3D(WindowHandle hWnd, const BufferSize& changedSize);
 	bool loadLevel(const std::optional<std::string>& level, bool defaultSky = true);
+	void preloadLevel(const std::string& level);
 	void onWindowResize(const BufferSize& changedSize);
 	void onWindowDpiChange(float dpiScale);
 	// Clean up DirectX and COM
@@ -1,22 +1,252 @@
 #include "stdafx.h"
 #include "render/basic/Common.h"
 
+#include <numeric>
+
 namespace render {
 
-	void forEachFace(const MatToChunksToVertsBasic& data, const std::function<void(const VertKey& vertKey)>& func)
-	{
-		for (const auto& [material, chunkData] : data) {
-			for (const auto& [gridPos, vertData] : chunkData) {
-				uint32_t vertCount = vertData.useIndices ? vertData.vecIndex.size() : vertData.vecPos.size();
-				for (uint32_t i = 0; i < vertCount; i += 3) {
-					const VertKey vertKey {
-						.mat = material,
-						.gridPos = gridPos,
-						.vertIndex = i,
-					};
-					func(vertKey);
+	template <VERTEX_FEATURE F>
+	MatId MeshData<F>::getOrCreateMatId(const Material& material)
+	{
+		auto [it, wasInserted] = materialIds.try_emplace(material, (MatId) materials.size());
+		if (wasInserted) {
+			materials.push_back(material);
+		}
+		return it->second;
+	}
+
+	template <VERTEX_FEATURE F>
+	CellId MeshData<F>::getOrCreateCellId(GridPos gridPos)
+	{
+		auto [it, wasInserted] = cellIds.try_emplace(gridPos, (CellId) cells.size());
+		if (wasInserted) {
+			cells.push_back(gridPos);
+		}
+		return it->second;
+	}
+
+	template <VERTEX_FEATURE F>
+	void MeshData<F>::closeLastRange()
+	{
+		if (!ranges.empty()) {
+			VertRange& last = ranges.back();
+			last.vertCount = vecPos.size() - last.vertStart;
+			last.indexCount = vecIndex.size() - last.indexStart;
+			last.indexLodCount = vecIndexLod.size() - last.indexLodStart;
+		}
+	}
+
+	template <VERTEX_FEATURE F>
+	uint32_t MeshData<F>::beginAppend(const Material& material, GridPos gridPos, bool useIndices)
+	{
+		MatId matId = getOrCreateMatId(material);
+		CellId cellId = getOrCreateCellId(gridPos);
+		if (!finalized && !ranges.empty()) {
+			const VertRange& last = ranges.back();
+			if (last.matId == matId && last.cellId == cellId) {
+				assert(last.useIndices == useIndices);
+				return vecPos.size() - last.vertStart;
+			}
+		}
+		closeLastRange();
+		finalized = false;
+		ranges.push_back({
+			.matId = matId,
+			.cellId = cellId,
+			.useIndices = useIndices,
+			.vertStart = (uint32_t) vecPos.size(),
+			.indexStart = (uint32_t) vecIndex.size(),
+			.indexLodStart = (uint32_t) vecIndexLod.size(),
+		});
+		return 0;
+	}
+
+	template <typename T>
+	std::vector<uint32_t> createSortedIdRemap(const std::vector<T>& values)
+	{
+		std::vector<uint32_t> sorted(values.size());
+		std::iota(sorted.begin(), sorted.end(), 0);
+		std::sort(sorted.begin(), sorted.end(), [&](uint32_t lhs, uint32_t rhs) -> bool {
+			return values[lhs] < values[rhs];
+		});
+		std::vector<uint32_t> remap(values.size());
+		for (uint32_t newId = 0; newId < sorted.size(); newId++) {
+			remap[sorted[newId]] = newId;
+		}
+		return remap;
+	}
+
+	template <typename T>
+	void applyIdRemap(std::vector<T>& values, const std::vector<uint32_t>& remap)
+	{
+		std::vector<T> result(values.size());
+		for (uint32_t oldId = 0; oldId < values.size(); oldId++) {
+			result[remap[oldId]] = values[oldId];
+		}
+		values = std::move(result);
+	}
+
+	// Moves a block of consecutive values from oldStart to newStart.
+	struct BlockMove {
+		uint32_t oldStart;
+		uint32_t newStart;
+		uint32_t count;
+	};
+
+	// Applies block moves by following permutation cycles, so no second copy of values is needed. Moves must cover all values
+	// without overlap, each value is only swapped once into its final position.
+	template <typename T>
+	void moveBlocksInPlace(std::vector<T>& values, std::vector<BlockMove>& moves)
+	{
+		std::sort(moves.begin(), moves.end(), [](const BlockMove& lhs, const BlockMove& rhs) -> bool {
+			return lhs.oldStart < rhs.oldStart;
+		});
+		auto getTarget = [&](uint32_t index) -> uint32_t {
+			auto it = std::upper_bound(moves.begin(), moves.end(), index, [](uint32_t value, const BlockMove& move) -> bool {
+				return value < move.oldStart;
+			});
+			const BlockMove& move = *(it - 1);
+			assert(index - move.oldStart < move.count);
+			return move.newStart + (index - move.oldStart);
+		};
+
+		std::vector<bool> placed(values.size(), false);
+		for (uint32_t i = 0; i < values.size(); i++) {
+			if (placed[i]) {
+				continue;
+			}
+			T carried = std::move(values[i]);
+			uint32_t current = i;
+			do {
+				current = getTarget(current);
+				std::swap(carried, values[current]);
+				placed[current] = true;
+			} while (current != i);
+		}
+	}
+
+	template <VERTEX_FEATURE F>
+	void MeshData<F>::finalize()
+	{
+		if (finalized) {
+			return;
+		}
+		closeLastRange();
+
+		// sort materials and cells so that IDs (and therefore iteration order) do not depend on load order
+		auto matRemap = createSortedIdRemap(materials);
+		auto cellRemap = createSortedIdRemap(cells);
+		applyIdRemap(materials, matRemap);
+		applyIdRemap(cells, cellRemap);
+		for (auto& [material, matId] : materialIds) {
+			matId = matRemap[matId];
+		}
+		for (auto& [gridPos, cellId] : cellIds) {
+			cellId = cellRemap[cellId];
+		}
+		for (auto& range : ranges) {
+			range.matId = matRemap[range.matId];
+			range.cellId = cellRemap[range.cellId];
+		}
+		std::vector<RangeId> sortedRanges(ranges.size());
+		std::iota(sortedRanges.begin(), sortedRanges.end(), 0);
+		std::stable_sort(sortedRanges.begin(), sortedRanges.end(), [&](RangeId lhs, RangeId rhs) -> bool {
+			const VertRange& lhsRange = ranges[lhs];
+			const VertRange& rhsRange = ranges[rhs];
+			return lhsRange.matId != rhsRange.matId ? lhsRange.matId < rhsRange.matId : lhsRange.cellId < rhsRange.cellId;
+		});
+
+		// Ranges were appended consecutively, so they cover all arenas. Arenas are reordered in place into range order, which
+		// avoids a second copy of all vertex data. Ranges with identical material and cell are merged, so indices of
+		// continued ranges are shifted by the verts of the ranges before them.
+		std::vector<BlockMove> vertMoves;
+		std::vector<BlockMove> indexMoves;
+		std::vector<BlockMove> indexLodMoves;
+		vertMoves.reserve(ranges.size());
+		indexMoves.reserve(ranges.size());
+		indexLodMoves.reserve(ranges.size());
+
+		std::vector<VertRange> merged;
+		uint32_t vertCount = 0;
+		uint32_t indexCount = 0;
+		uint32_t indexLodCount = 0;
+		for (RangeId rangeId : sortedRanges) {
+			const VertRange& range = ranges[rangeId];
+			bool isContinued = !merged.empty()
+				&& merged.back().matId == range.matId && merged.back().cellId == range.cellId;
+			if (!isContinued) {
+				merged.push_back({
+					.matId = range.matId,
+					.cellId = range.cellId,
+					.useIndices = range.useIndices,
+					.vertStart = vertCount,
+					.indexStart = indexCount,
+					.indexLodStart = indexLodCount,
+				});
+			}
+			VertRange& target = merged.back();
+			assert(target.useIndices == range.useIndices);
+
+			uint32_t vertOffset = target.vertCount;
+			if (vertOffset > 0) {
+				for (uint32_t i = range.indexStart; i < range.indexStart + range.indexCount; i++) {
+					vecIndex[i] += vertOffset;
+				}
+				for (uint32_t i = range.indexLodStart; i < range.indexLodStart + range.indexLodCount; i++) {
+					vecIndexLod[i] += vertOffset;
 				}
 			}
+			if (range.vertCount > 0) {
+				vertMoves.push_back({ range.vertStart, vertCount, range.vertCount });
+			}
+			if (range.indexCount > 0) {
+				indexMoves.push_back({ range.indexStart, indexCount, range.indexCount });
+			}
+			if (range.indexLodCount > 0) {
+				indexLodMoves.push_back({ range.indexLodStart, indexLodCount, range.indexLodCount });
+			}
+			vertCount += range.vertCount;
+			indexCount += range.indexCount;
+			indexLodCount += range.indexLodCount;
+
+			target.vertCount += range.vertCount;
+			target.indexCount += range.indexCount;
+			target.indexLodCount += range.indexLodCount;
+		}
+		assert(vertCount == vecPos.size() && indexCount == vecIndex.size() && indexLodCount == vecIndexLod.size());
+
+		moveBlocksInPlace(vecIndex, indexMoves);
+		moveBlocksInPlace(vecIndexLod, indexLodMoves);
+		moveBlocksInPlace(vecPos, vertMoves);
+		moveBlocksInPlace(vecNormalUv, vertMoves);
+		moveBlocksInPlace(vecOther, vertMoves);
+		ranges = std::move(merged);
+
+		materialRanges.assign(materials.size(), { 0, 0 });
+		for (RangeId rangeId = 0; rangeId < ranges.size(); rangeId++) {
+			auto& [begin, end] = materialRanges[ranges[rangeId].matId];
+			if (begin == end) {
+				begin = rangeId;
+			}
+			end = rangeId + 1;
+		}
+		finalized = true;
+	}
+
+	template struct MeshData<VertexBasic>;
+
+	void forEachFace(const MeshDataBasic& data, const std::function<void(const VertKey& vertKey)>& func)
+	{
+		assert(data.isFinalized());
+		for (RangeId rangeId = 0; rangeId < data.ranges.size(); rangeId++) {
+			uint32_t vertCount = data.ranges[rangeId].faceVertCount();
+			for (uint32_t i = 0; i < vertCount; i += 3) {
+				const VertKey vertKey {
+					.rangeId = rangeId,
+					.vertIndex = i,
+				};
+				func(vertKey);
+			}
 		}
 	}
-}
\ No newline at end of file
+}
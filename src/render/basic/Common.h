@@ -3,6 +3,7 @@
 #include <string>
 #include <ostream>
 #include <vector>
+#include <span>
 
 #include "Util.h"
 #include "render/basic/Primitives.h"
@@ -92,6 +93,7 @@ namespace render
 	struct ChunkVertCluster {
 		GridPos gridPos;
 		uint32_t vertStartIndex;
+		uint32_t baseVertex = 0;// added to indices, draws of consecutive clusters can only be merged if this is equal
 	};
 
 
@@ -118,7 +120,7 @@ namespace render
 	typedef Verts<VertexBasic> VertsBasic;
 	//typedef Verts<VertexBlend> VertsBlend;
 
-	using TexId = uint16_t;
+	using TexId = uint32_t;
 
 	// TODO rename to Encoding / Compression or something, since color is always SRGB, even if linear
 	enum class ColorSpace {
@@ -146,25 +148,148 @@ namespace render
 	};
 	} namespace std { template <> struct hash<render::Material> : render::Material::Hash {}; } namespace render {
 
-	template <VERTEX_FEATURE F>
-	using ChunkToVerts = std::unordered_map<GridPos, Verts<F>>;
-	
-	template <VERTEX_FEATURE F>
-	using MatToChunksToVerts = std::unordered_map<Material, ChunkToVerts<F>>;
-	using MatToChunksToVertsBasic = MatToChunksToVerts<VertexBasic>;
-	//using MatToChunksToVertsBlend = MatToChunksToVerts<VertexBlend>;
-
 	template <VERTEX_FEATURE F>
 	using MatToVerts = std::unordered_map<Material, Verts<F>>;
 	using MatToVertsBasic = MatToVerts<VertexBasic>;
 
+	using MatId = uint32_t;
+	using CellId = uint32_t;
+	using RangeId = uint32_t;
+
+	// Location of all verts and indices with the same material and grid cell inside MeshData arenas.
+	// Indices are relative to vertStart.
+	struct VertRange {
+		MatId matId;
+		CellId cellId;
+		bool useIndices = false;
+		uint32_t vertStart = 0;
+		uint32_t vertCount = 0;
+		uint32_t indexStart = 0;
+		uint32_t indexCount = 0;
+		uint32_t indexLodStart = 0;
+		uint32_t indexLodCount = 0;
+
+		uint32_t faceVertCount() const
+		{
+			return useIndices ? indexCount : vertCount;
+		}
+	};
+
+	// Mesh data of a whole level stored in a few big arenas (one per vertex stream) instead of one allocation per
+	// material and cell. Materials, cells and ranges are addressed by dense IDs.
+	// Loaders append ranges in any order, the same material and cell may be appended to many times (for example once per
+	// VOB instance). finalize() then sorts ranges by material and cell and makes each range contiguous, which is
+	// required before any data is read.
+	template <VERTEX_FEATURE F>
+	struct MeshData {
+		std::vector<Material> materials;// indexed by MatId, sorted
+		std::vector<GridPos> cells;// indexed by CellId, sorted
+		std::vector<VertRange> ranges;// indexed by RangeId, sorted by material, then cell
+		std::vector<std::pair<RangeId, RangeId>> materialRanges;// indexed by MatId, begin and end into ranges
+
+		std::vector<VertexIndex> vecIndex;
+		std::vector<VertexIndex> vecIndexLod;
+		std::vector<VertexPos> vecPos;
+		std::vector<VertexNorUv> vecNormalUv;
+		std::vector<F> vecOther;
+
+		// Continues range for given material and cell if it is the last appended range or starts a new one at the end of
+		// the arenas. Caller must then push verts and indices to arenas directly, with indices shifted by returned offset.
+		uint32_t beginAppend(const Material& material, GridPos gridPos, bool useIndices);
+		void finalize();
+
+		bool empty() const
+		{
+			return ranges.empty();
+		}
+		bool isFinalized() const
+		{
+			return finalized;
+		}
+
+		const Material& getMaterial(const VertRange& range) const
+		{
+			return materials[range.matId];
+		}
+		GridPos getGridPos(const VertRange& range) const
+		{
+			return cells[range.cellId];
+		}
+		std::span<const VertRange> getRanges(MatId matId) const
+		{
+			auto [begin, end] = materialRanges[matId];
+			return { ranges.data() + begin, ranges.data() + end };
+		}
+
+		std::span<const VertexIndex> getIndices(const VertRange& range) const
+		{
+			return { vecIndex.data() + range.indexStart, range.indexCount };
+		}
+		std::span<const VertexIndex> getIndicesLod(const VertRange& range) const
+		{
+			return { vecIndexLod.data() + range.indexLodStart, range.indexLodCount };
+		}
+		std::span<const VertexPos> getPos(const VertRange& range) const
+		{
+			return { vecPos.data() + range.vertStart, range.vertCount };
+		}
+		std::span<const VertexNorUv> getNormalUv(const VertRange& range) const
+		{
+			return { vecNormalUv.data() + range.vertStart, range.vertCount };
+		}
+		std::span<const F> getOther(const VertRange& range) const
+		{
+			return { vecOther.data() + range.vertStart, range.vertCount };
+		}
+
+		template <typename VERT_TYPE>
+		const std::array<VERT_TYPE, 3> getFace(RangeId rangeId, uint32_t index) const
+		{
+			assert(finalized);
+			const VertRange& range = ranges[rangeId];
+			const VERT_TYPE* verts;
+			if constexpr (std::is_same_v<VERT_TYPE, VertexPos>) {
+				verts = vecPos.data() + range.vertStart;
+			}
+			if constexpr (std::is_same_v<VERT_TYPE, F>) {
+				verts = vecOther.data() + range.vertStart;
+			}
+			if (range.useIndices) {
+				const VertexIndex* indices = vecIndex.data() + range.indexStart;
+				return {
+					verts[indices[index]],
+					verts[indices[index + 1]],
+					verts[indices[index + 2]]
+				};
+			} else {
+				return {
+					verts[index],
+					verts[index + 1],
+					verts[index + 2]
+				};
+			};
+		}
+
+	private:
+		MatId getOrCreateMatId(const Material& material);
+		CellId getOrCreateCellId(GridPos gridPos);
+		void closeLastRange();
+
+		std::unordered_map<Material, MatId> materialIds;
+		std::unordered_map<GridPos, CellId> cellIds;
+		bool finalized = true;
+	};
+
+	using MeshDataBasic = MeshData<VertexBasic>;
 
 	template <VERTEX_FEATURE F>
 	struct VertsBatch {
 		std::vector<ChunkVertCluster> vertClusters;
 		std::vector<ChunkVertCluster> vertClustersLod;// TODO make sure we do not have empty cluster cells in here
+		std::vector<uint32_t> vertClusterVertStarts;// first vertex (not index) of each vertClusters entry, verts of a cluster are contiguous
 
 		std::vector<VertexIndex> vecIndex;// all LOD indices are inserted after normal indices
+		std::vector<VertexIndexShort> vecIndexShort;// used instead of vecIndex if all indices fit relative to cluster baseVertex
 		uint32_t lodStart = 0;// count of non-LOD indices
 
 		//std::vector<VertexIndex> vecIndexLod;
@@ -172,63 +297,31 @@ namespace render
 		std::vector<VertexNorUv> vecNormalUv;
 		std::vector<F> vecOther;
 		// TODO either remove vec prefix everywhere and use plural or not consistently
-		std::vector<TexIndex> texIndices;
+		std::vector<TexIndexRange> texIndexRanges;// sorted by vertStart, adjacent ranges with equal index are merged
 		std::vector<TexId> texIndexedIds;
 	};
 
 
-	template <typename VERT_TYPE, VERTEX_FEATURE F>
-	const std::vector<VERT_TYPE>& GetVertVec(const Verts<F>& verts)
-	{
-		if constexpr (std::is_same_v<VERT_TYPE, VertexPos>) {
-			return verts.vecPos;
-		}
-		if constexpr (std::is_same_v<VERT_TYPE, F>) {
-			return verts.vecOther;
-		}
-	}
-
-	template <typename VERT_TYPE, VERTEX_FEATURE F>
-	const std::array<VERT_TYPE, 3> GetFace(const Verts<F>& verts, uint32_t index)
-	{
-		const std::vector<VERT_TYPE>& vec = GetVertVec<VERT_TYPE, F>(verts);
-		if (verts.useIndices) {
-			return {
-				vec[verts.vecIndex[index]],
-				vec[verts.vecIndex[index + 1]],
-				vec[verts.vecIndex[index + 2]]
-			};
-		} else {
-			return {
-				vec[index],
-				vec[index + 1],
-				vec[index + 2]
-			};
-		};
-	}
-
 	struct VertKey {
-		const Material mat;
-		const GridPos gridPos;
-		const uint32_t vertIndex; // we assume the vert vector is not modified during lifetime of index
+		const RangeId rangeId;
+		const uint32_t vertIndex; // we assume the mesh data is not modified during lifetime of index
 
-		// TODO maybe the whole struct should be templated instead of every single method
 		template <VERTEX_FEATURE F>
-		const VertsBasic& get(const MatToChunksToVerts<F>& meshData) const
+		const VertRange& get(const MeshData<F>& meshData) const
 		{
-			return meshData.find(this->mat)->second.find(this->gridPos)->second;
+			return meshData.ranges[rangeId];
 		}
 		template <VERTEX_FEATURE F>
-		const std::array<VertexPos, 3> getPos(const MatToChunksToVerts<F>& meshData) const
+		const std::array<VertexPos, 3> getPos(const MeshData<F>& meshData) const
 		{
-			return GetFace<VertexPos, F>(get(meshData), vertIndex);
+			return meshData.template getFace<VertexPos>(rangeId, vertIndex);
 		}
 		template <VERTEX_FEATURE F>
-		const std::array<VertexBasic, 3> getOther(const MatToChunksToVerts<F>& meshData) const
+		const std::array<VertexBasic, 3> getOther(const MeshData<F>& meshData) const
 		{
-			return GetFace<F, F>(get(meshData), vertIndex);
+			return meshData.template getFace<F>(rangeId, vertIndex);
 		}
 	};
 
-	void forEachFace(const MatToChunksToVertsBasic& data, const std::function<void(const VertKey& vertKey)>& func);
+	void forEachFace(const MeshDataBasic& data, const std::function<void(const VertKey& vertKey)>& func);
 }
\ No newline at end of file
@@ -53,4 +53,11 @@ namespace render
 	using VertexAttributes = std::vector<VertexAttribute>;
 
 	constexpr bool PACK_VERTEX_ATTRIBUTES = true;
+
+	// Format of world and static object vertex buffers on GPU, selected when a level is loaded (see VertexPacker.cpp).
+	// CPU-side mesh data is always kept in default format, compact buffers are converted from it during upload.
+	enum class VertexFormat : uint8_t {
+		DEFAULT,// 12 bytes position, 8 bytes normal/uv, 8 bytes light (with PACK_VERTEX_ATTRIBUTES)
+		COMPACT,// 8 bytes cluster-relative position, 8 bytes normal/uv, 4 bytes light
+	};
 }
\ No newline at end of file
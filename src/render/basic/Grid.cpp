@@ -11,35 +11,37 @@ namespace render::grid
 	// Altertively, something like https://github.com/Forceflow/libmorton could be used, but seems overkill for small grids with few cells
 	namespace morton
 	{
-		uint16_t part1By1(uint8_t x8)
+		uint32_t part1By1(uint16_t x16)
 		{
-			// "Insert" a 0 bit before each of the 8 bits of x
-			uint16_t x = x8;             // x = ---- ---- 7654 3210
-			x = (x ^ (x << 4)) & 0x0f0f; // x = ---- 7654 ---- 3210
-			x = (x ^ (x << 2)) & 0x3333; // x = --76 --54 --32 --10
-			x = (x ^ (x << 1)) & 0x5555; // x = -7-6 -5-4 -3-2 -1-0
+			// "Insert" a 0 bit before each of the 16 bits of x
+			uint32_t x = x16;                // x = ---- ---- ---- ---- fedc ba98 7654 3210
+			x = (x ^ (x << 8)) & 0x00ff00ff; // x = ---- ---- fedc ba98 ---- ---- 7654 3210
+			x = (x ^ (x << 4)) & 0x0f0f0f0f; // x = ---- fedc ---- ba98 ---- 7654 ---- 3210
+			x = (x ^ (x << 2)) & 0x33333333; // x = --fe --dc --ba --98 --76 --54 --32 --10
+			x = (x ^ (x << 1)) & 0x55555555; // x = -f-e -d-c -b-a -9-8 -7-6 -5-4 -3-2 -1-0
 			return x;
 		}
-		uint8_t compact1By1(uint16_t x)
+		uint16_t compact1By1(uint32_t x)
 		{
 			// Inverse of part1By1 - "delete" all odd-indexed bits
-			x &= 0x5555;                 // x = -7-6 -5-4 -3-2 -1-0
-			x = (x ^ (x >> 1)) & 0x3333; // x = --76 --54 --32 --10
-			x = (x ^ (x >> 2)) & 0x0f0f; // x = ---- 7654 ---- 3210
-			x = (x ^ (x >> 4)) & 0x00ff; // x = ---- ---- 7654 3210
-			return (uint8_t)x;
+			x &= 0x55555555;                 // x = -f-e -d-c -b-a -9-8 -7-6 -5-4 -3-2 -1-0
+			x = (x ^ (x >> 1)) & 0x33333333; // x = --fe --dc --ba --98 --76 --54 --32 --10
+			x = (x ^ (x >> 2)) & 0x0f0f0f0f; // x = ---- fedc ---- ba98 ---- 7654 ---- 3210
+			x = (x ^ (x >> 4)) & 0x00ff00ff; // x = ---- ---- fedc ba98 ---- ---- 7654 3210
+			x = (x ^ (x >> 8)) & 0x0000ffff; // x = ---- ---- ---- ---- fedc ba98 7654 3210
+			return (uint16_t)x;
 		}
 
-		uint16_t encode2d(uint8_t x, uint8_t y)
+		uint32_t encode2d(uint16_t x, uint16_t y)
 		{
 			return (part1By1(y) << 1) + part1By1(x);
 		}
 
-		uint8_t decode2dX(uint16_t code)
+		uint16_t decode2dX(uint32_t code)
 		{
 			return compact1By1(code);
 		}
-		uint8_t decode2dY(uint16_t code)
+		uint16_t decode2dY(uint32_t code)
 		{
 			return compact1By1(code >> 1);
 		}
@@ -48,6 +50,7 @@ namespace render::grid
 	constexpr float WORLD_FACE_DENSITY_G2 = 0.164;// G1: 0.046, G2: 0.164
 	constexpr float CELLS_PER_AREA = 1.f / (60 * 60);// each cell should contain about 60*60 meters (at G2 fidelity)
 	constexpr float FIDELITY_WEIGHT = 0.6;// how much estimated graphical fidelity will alter cell count
+	constexpr uint32_t CELLS_PER_DIM_MAX = 8 * 16;// limits CPU cost of culling, cells are grouped into 8 * 8 layer cells
 
 	Grid init(Vec2 boundsMin, Vec2 boundsMax, float scale, uint32_t faceCount)
 	{
@@ -77,8 +80,8 @@ namespace render::grid
 
 		uint32_t cellsPerDimPowerOf2 = std::pow(2, (uint32_t) std::ceil(std::log2(cellsPerDimTarget)));
 
-		grid.cellCountXY = std::min(cellsPerDimPowerOf2, 8u * 4u);// we never go over 8 * 4 cells to save CPU
-		grid.cellCount = grid.cellCountXY * grid.cellCountXY;
+		grid.cellCountXY = std::min(cellsPerDimPowerOf2, CELLS_PER_DIM_MAX);
+		grid.cellCount = (uint32_t) grid.cellCountXY * grid.cellCountXY;
 
 		if (grid.cellCountXY > 8) {
 			grid.groupSizeXY = grid.cellCountXY / 8;// TODO do we actually prefer 8 * 2 over 4 * 4?
@@ -89,7 +92,7 @@ namespace render::grid
 		return grid;
 	}
 
-	uint8_t rescaleToIndex(float min, float max, float coord, uint8_t indexCount)
+	uint16_t rescaleToIndex(float min, float max, float coord, uint16_t indexCount)
 	{
 		if (coord <= min) {
 			return 0;
@@ -99,7 +102,7 @@ namespace render::grid
 		}
 		else {
 			float distanceNorm = (coord - min) / (max - min);
-			return (uint8_t) (distanceNorm * indexCount);
+			return std::min((uint16_t) (distanceNorm * indexCount), (uint16_t) (indexCount - 1));
 		}
 	}
 
@@ -111,7 +114,7 @@ namespace render::grid
 		};
 	}
 
-	uint16_t getIndex(GridPos pos)
+	uint32_t getIndex(GridPos pos)
 	{
 		return morton::encode2d(pos.x, pos.y);
 	}
@@ -140,7 +143,7 @@ namespace render::grid
 			
 			span<const CellInfo> all = { grid.cells.base };
 
-			for (uint16_t layer = 0, base = 0; layer < grid.cells.layer.size(); layer++, base += grid.groupSize) {
+			for (uint32_t layer = 0, base = 0; layer < grid.cells.layer.size(); layer++, base += grid.groupSize) {
 				auto group = all.subspan(base, grid.groupSize);
 				grid.cells.layer.at(layer) = mergeCells(group);
 			}
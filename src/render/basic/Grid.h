@@ -9,8 +9,8 @@ namespace render
 {
 	// TODO rename to CellPos? TODO move to render::grid again and replace usage with using grid::GridPos ?
 	struct GridPos {
-		uint8_t x;
-		uint8_t y;
+		uint16_t x;
+		uint16_t y;
 
 		auto operator<=>(const GridPos&) const = default;
 
@@ -62,10 +62,10 @@ namespace render
 		struct Grid {
 			Vec2 boundsMin, boundsMax;
 			float distance;
-			uint16_t cellCount;
-			uint8_t cellCountXY;
-			uint8_t groupSize = 0;
-			uint8_t groupSizeXY = 0;
+			uint32_t cellCount;
+			uint16_t cellCountXY;
+			uint16_t groupSize = 0;
+			uint16_t groupSizeXY = 0;
 
 			grid::LayeredCells<grid::CellInfo, grid::CellInfo> cells;
 		};
@@ -81,7 +81,7 @@ namespace render
 
 		Grid init(Vec2 boundsMin, Vec2 boundsMax, float scale, uint32_t faceCount);
 		GridPos getGridPosForPoint(const Grid& grid, Vec2 point);
-		uint16_t getIndex(GridPos pos);
+		uint32_t getIndex(GridPos pos);
 		void updateBounds(Grid& grid, GridPos pos, const DirectX::BoundingBox& bbox);
 		void propagateBoundsToLayer(Grid& grid);
 	}
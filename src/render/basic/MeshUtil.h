@@ -70,9 +70,10 @@ namespace render
         return os << "[X:" << float4.x << " Y:" << float4.y << " Z:" << float4.z << " W:" << float4.w << "]";
     }
 
-    template <typename T>
-    DirectX::BoundingBox createBboxFromPoints(const std::vector<T>& positions)
+    template <typename VEC>
+    DirectX::BoundingBox createBboxFromPoints(const VEC& positions)
     {
+        using T = typename VEC::value_type;
         DirectX::BoundingBox result;
         DirectX::BoundingBox::CreateFromPoints(result, positions.size(), (const DirectX::XMFLOAT3*)positions.data(), sizeof(T));
         return result;
@@ -99,25 +100,13 @@ namespace render
         RANGE_OF<VertexPos> C1,
         RANGE_OF<VertexNorUv> C2,
         RANGE_OF<VertexBasic> C3>
-    void insert(MatToChunksToVertsBasic& target, const Material& material, const C1& pos, const C2& normalUv, const C3& other)
+    void insert(MeshDataBasic& target, const Material& material, const C1& pos, const C2& normalUv, const C3& other)
     {
-        std::unordered_map<GridPos, VertsBasic>& meshData = ::util::getOrCreateDefault(target, material);
-        
-        for (uint32_t i = 0; i < pos.size(); i += 3) {
-            const GridPos gridPos = { 0, 0 };// TODO this is kinda bad
-            VertsBasic& chunkData = ::util::getOrCreateDefault(meshData, gridPos);
-
-            // TODO copied from MeshFromVdfLoader for now, clean up
-            chunkData.vecPos.push_back(pos[i]);
-            chunkData.vecPos.push_back(pos[i + 1]);
-            chunkData.vecPos.push_back(pos[i + 2]);
-            chunkData.vecNormalUv.push_back(normalUv[i]);
-            chunkData.vecNormalUv.push_back(normalUv[i + 1]);
-            chunkData.vecNormalUv.push_back(normalUv[i + 2]);
-            chunkData.vecOther.push_back(other[i]);
-            chunkData.vecOther.push_back(other[i + 1]);
-            chunkData.vecOther.push_back(other[i + 2]);
-        }
+        const GridPos gridPos = { 0, 0 };// TODO this is kinda bad
+        target.beginAppend(material, gridPos, false);
+        target.vecPos.insert(target.vecPos.end(), pos.begin(), pos.end());
+        target.vecNormalUv.insert(target.vecNormalUv.end(), normalUv.begin(), normalUv.end());
+        target.vecOther.insert(target.vecOther.end(), other.begin(), other.end());
     }
 
     void warnIfNotNormalized(const DirectX::XMVECTOR& source);
@@ -119,6 +119,7 @@ inline std::ostream& operator <<(std::ostream& os, const PosUv& that)
 namespace render
 {
 	using VertexIndex = uint32_t;
+	using VertexIndexShort = uint16_t;
 
 	struct BufferSize {
 		uint16_t width;
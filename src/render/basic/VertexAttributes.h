@@ -9,11 +9,18 @@ namespace render
 	VertexAttributes inputLayout();
 
 	using TexIndex = uint32_t;
-	template <> inline VertexAttributes inputLayout<TexIndex>() {
-		return {
-			{  Type::UINT, Semantic::INDEX }
-		};
-	}
+
+	// Texture index of all verts from vertStart up to vertStart of the next range, looked up by vertex shader (must match HLSL struct)
+	struct TexIndexRange {
+		uint32_t vertStart;
+		TexIndex texIndex;
+	};
+
+	// TexIndexRanges are looked up through one bucket per texIndexBucketVertCount verts (must match HLSL). A bucket stores
+	// the texture index of all its verts (flagged with texIndexBucketUniform) or the first TexIndexRange overlapping it.
+	constexpr uint32_t texIndexBucketVertCountBits = 6;
+	constexpr uint32_t texIndexBucketVertCount = 1 << texIndexBucketVertCountBits;
+	constexpr uint32_t texIndexBucketUniform = 1u << 31;
 
 	using VertexPos = Vec3;
 	template <> inline VertexAttributes inputLayout<VertexPos>() {
@@ -50,6 +57,14 @@ namespace render
 		VertexNorUvTemplate() {};
 		VertexNorUvTemplate(Vec3 normal, Uv uvDiffuse)
 			: m_normal(packNormal(normal)), m_uvDiffuse(packUv(uvDiffuse)) {};
+		// from results of batch packing (see packNormals, packUvs)
+		static VertexNorUvTemplate fromPacked(uint32_t normal, uint32_t uvDiffuse)
+		{
+			VertexNorUvTemplate result;
+			result.m_normal = normal;
+			result.m_uvDiffuse = uvDiffuse;
+			return result;
+		}
 		Vec3 normal() const { return unpackNormal(m_normal); }
 		Uv uvDiffuse() const { return unpackUv(m_uvDiffuse); }
 	};
@@ -67,8 +82,6 @@ namespace render
 	}
 
 
-	constexpr uint32_t instanceIdNone = UINT16_MAX;
-
 	template <bool IS_PACKED>
 	struct VertexLightTemplate {};
 
@@ -122,8 +135,15 @@ namespace render
 		{
 			assert((type == VertexLightType::WORLD_LIGHTMAP) == (uviLightmap.i >= 0.f));
 			assert((type == VertexLightType::OBJECT_COLOR) == (instanceId < instanceIdNone));
-			packed = packLight(type, colLight, uviLightmap, (uint16_t) instanceId);
+			packed = packLight(type, colLight, uviLightmap, instanceId);
 		};
+		// from results of batch packing (see packLights)
+		static VertexLightTemplate fromPacked(std::pair<uint32_t, uint32_t> packed)
+		{
+			VertexLightTemplate result;
+			result.packed = packed;
+			return result;
+		}
 		VertexLightType type() const { return unpackLightType(packed); }
 		uint32_t instanceId() const { return unpackInstanceId(packed); }
 		Color colLight() const { return unpackLightColor(packed); }
@@ -142,4 +162,63 @@ namespace render
 	{
 		return os << "[TYPE:" << (uint32_t)that.type() << " ID:" << that.instanceId() << " LIGHT_SUN:" << that.colLight() << " UVI_LM:" << that.uviLightmap() << "]";
 	}
+
+
+	// Compact vertex format (see VertexFormat::COMPACT), only used for GPU vertex buffers
+
+	struct VertexPosCompact {
+	private:
+		std::pair<uint32_t, uint32_t> packed;
+	public:
+		VertexPosCompact() {};
+		VertexPosCompact(Vec3 pos, const ClusterBounds& bounds, uint32_t clusterIndex)
+			: packed(packPosCompact(pos, bounds, clusterIndex)) {};
+		Vec3 pos(const ClusterBounds& bounds) const { return unpackPosCompact(packed, bounds); }
+		uint32_t clusterIndex() const { return unpackClusterIndex(packed); }
+	};
+	template <> inline VertexAttributes inputLayout<VertexPosCompact>() {
+		return {
+			{ Type::UINT_2, Semantic::POSITION }
+		};
+	}
+
+	struct VertexNorUvCompact {
+	private:
+		uint32_t m_normal;
+		uint32_t m_uvDiffuse;
+	public:
+		VertexNorUvCompact() {};
+		VertexNorUvCompact(Vec3 normal, Uv uvDiffuse)
+			: m_normal(packNormalOct(normal)), m_uvDiffuse(packUv(uvDiffuse)) {};
+		Vec3 normal() const { return unpackNormalOct(m_normal); }
+		Uv uvDiffuse() const { return unpackUv(m_uvDiffuse); }
+	};
+	template <> inline VertexAttributes inputLayout<VertexNorUvCompact>() {
+		return {
+			{ Type::UINT, Semantic::NORMAL },
+			{ Type::UINT, Semantic::TEXCOORD },
+		};
+	}
+
+	struct VertexLightCompact {
+	private:
+		uint32_t packed;
+	public:
+		VertexLightCompact() {};
+		VertexLightCompact(VertexLightType type, Color colLight, Uvi uviLightmap, uint32_t instanceId = instanceIdNone)
+		{
+			assert((type == VertexLightType::WORLD_LIGHTMAP) == (uviLightmap.i >= 0.f));
+			assert((type == VertexLightType::OBJECT_COLOR) == (instanceId < instanceIdNone));
+			packed = packLightCompact(type, colLight, uviLightmap, instanceId);
+		};
+		VertexLightType type() const { return unpackLightTypeCompact(packed); }
+		uint32_t instanceId() const { return unpackInstanceIdCompact(packed); }
+		Color colLight() const { return unpackLightColorCompact(packed); }
+		Uvi uviLightmap() const { return unpackLightmapCompact(packed); }
+	};
+	template <> inline VertexAttributes inputLayout<VertexLightCompact>() {
+		return {
+			{ Type::UINT, Semantic::OTHER },
+		};
+	}
 }
\ No newline at end of file
@@ -1,6 +1,10 @@
 #include "stdafx.h"
 #include "VertexPacker.h"
 
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 namespace render
 {
 	// Packed Normals:
@@ -16,11 +20,95 @@ namespace render
 	constexpr static uint32_t uvComponentMask = (1 << uvComponentBits) - 1;
 	constexpr static uint32_t scale = (1 << (uvComponentBits - 1));
 
-	// Packed light info:
-	constexpr static uint32_t instanceIdBits = 14;
-	constexpr static uint32_t instanceIdMask = (1 << instanceIdBits) - 1;
-	constexpr static uint32_t lightComponentBits = 16;
-	constexpr static uint32_t lightComponentMask = (1 << lightComponentBits) - 1;
+	// Bit range of a packed 32-bit value. Layouts are checked for overlaps at compile time, values are asserted to fit
+	// when packing. Callers must check limits (see VertexPacker.h) at load time, values are never silently masked.
+	template <uint32_t OFFSET, uint32_t BITS>
+	struct BitField {
+		static_assert(BITS > 0 && OFFSET + BITS <= 32);
+		constexpr static uint32_t offset = OFFSET;
+		constexpr static uint32_t end = OFFSET + BITS;
+		constexpr static uint32_t mask = (uint32_t) ((1ull << BITS) - 1);
+
+		static uint32_t pack(uint32_t value)
+		{
+			assert(value <= mask);
+			return value << OFFSET;
+		}
+		static uint32_t unpack(uint32_t packed)
+		{
+			return (packed >> OFFSET) & mask;
+		}
+	};
+
+	// Packed light info (type stored in highest 2 bits of first value):
+	// - WORLD_LIGHTMAP: lightmap index, lightmap UVs packed like diffuse UVs as second value
+	// - WORLD_COLOR, OBJECT_DECAL: 16/16/16 bit color
+	// - OBJECT_COLOR: instance ID, color is stored per instance (see StaticInstanceFeatures)
+	using LightType = BitField<30, 2>;
+	using LightInstanceId = BitField<0, 30>;
+	using LightmapIndex = BitField<0, 16>;
+	using LightColorHigh = BitField<16, 16>;
+	using LightColorLow = BitField<0, 16>;
+	constexpr static uint32_t lightColorBits = 16;
+
+	static_assert(LightInstanceId::end <= LightType::offset);
+	static_assert(LightmapIndex::end <= LightType::offset);
+	static_assert(LightColorLow::end <= LightType::offset);
+	static_assert(LightColorLow::end <= LightColorHigh::offset);
+	static_assert(instanceIdCountMax - 1 == LightInstanceId::mask);
+	static_assert(instanceIdNone > LightInstanceId::mask);
+	static_assert(lightmapCountMax - 1 == LightmapIndex::mask);
+
+	// Compact Positions:
+	// Unsigned fixed-point values relative to the bounds of the vertex cluster (grid cell) that the vertex belongs to.
+	// Cluster index is stored next to z, bounds are looked up from a per-batch structured buffer.
+	using PosLow = BitField<0, 16>;
+	using PosHigh = BitField<16, 16>;
+	using PosClusterIndex = BitField<16, 16>;
+	constexpr static uint32_t posComponentMask = PosLow::mask;
+
+	static_assert(PosLow::end <= PosHigh::offset);
+	static_assert(PosLow::end <= PosClusterIndex::offset);
+	static_assert(clusterCountMaxCompact - 1 == PosClusterIndex::mask);
+
+	// Compact Normals:
+	// Octahedral mapping with y as hemisphere axis, x and z stored as signed fixed-point values
+	constexpr static uint32_t octComponentBits = 16;
+	constexpr static uint32_t octComponentMask = (1 << octComponentBits) - 1;
+	constexpr static float octComponentMax = (1 << (octComponentBits - 1)) - 1;
+
+	// Compact light info (type stored in highest 2 bits):
+	// - WORLD_LIGHTMAP: lightmap index, lightmap UVs as unsigned fixed-point values (UVs outside of [0, 1] are clamped)
+	// - WORLD_COLOR, OBJECT_DECAL: 10/10/10 bit color
+	// - OBJECT_COLOR: instance ID, color is stored per instance (see StaticInstanceFeatures)
+	using LightmapIndexCompact = BitField<22, 8>;
+	using LightmapUCompact = BitField<11, 11>;
+	using LightmapVCompact = BitField<0, 11>;
+	using LightColorRCompact = BitField<20, 10>;
+	using LightColorGCompact = BitField<10, 10>;
+	using LightColorBCompact = BitField<0, 10>;
+	constexpr static uint32_t lightmapUvBitsCompact = 11;
+	constexpr static uint32_t lightColorBitsCompact = 10;
+
+	static_assert(LightmapIndexCompact::end <= LightType::offset);
+	static_assert(LightmapUCompact::end <= LightmapIndexCompact::offset);
+	static_assert(LightmapVCompact::end <= LightmapUCompact::offset);
+	static_assert(LightColorRCompact::end <= LightType::offset);
+	static_assert(LightColorGCompact::end <= LightColorRCompact::offset);
+	static_assert(LightColorBCompact::end <= LightColorGCompact::offset);
+	static_assert(lightmapCountMaxCompact - 1 == LightmapIndexCompact::mask);
+
+	uint32_t quantizeUnorm(float value, uint32_t bits)
+	{
+		uint32_t maxVal = (1 << bits) - 1;
+		return std::min((uint32_t)(std::clamp(value, 0.f, 1.f) * maxVal + 0.5f), maxVal);
+	}
+
+	float dequantizeUnorm(uint32_t quant, uint32_t bits)
+	{
+		uint32_t maxVal = (1 << bits) - 1;
+		return (float)(quant & maxVal) / maxVal;
+	}
 
 	uint32_t packNormal(Vec3 raw)
 	{
@@ -62,6 +150,11 @@ namespace render
 		};
 	}
 
+	void warnUvTooLarge()
+	{
+		LOG(WARNING) << "Failed to compress UV, value too large! Max magnitude allowed: " << (1 << uvExponentMask);
+	}
+
 	uint32_t packUv(Uv raw)
 	{
 		uint32_t uCeil = (uint32_t)std::ceil(std::abs(raw.u));
@@ -69,7 +162,7 @@ namespace render
 		uint32_t ceil = std::max(uCeil, vCeil);
 		uint32_t exponent = std::max(std::bit_width(ceil), 0);
 		if (exponent > uvExponentMask) {
-			LOG(WARNING) << "Failed to compress UV, value too large! Max magnitude allowed: " << (1 << uvExponentMask);
+			warnUvTooLarge();
 		}
 		uint32_t factor = 1 << exponent;
 		Uv uvNorm = mul(raw, 1.f * scale / factor);
@@ -95,50 +188,59 @@ namespace render
 		return mul(uvNorm, factor / scale);
 	}
 
-	std::pair<uint32_t, uint32_t> packLight(VertexLightType type, Color colLight, Uvi uviLightmap, uint16_t instanceId)
+	std::pair<uint32_t, uint32_t> packLight(VertexLightType type, Color colLight, Uvi uviLightmap, uint32_t instanceId)
 	{
 		// TODO for now we ignore colLight alpha value
 
-		// TODO check max i in uvi
-
+		uint32_t typeBits = LightType::pack((uint32_t)type);
 		if (type == VertexLightType::WORLD_LIGHTMAP) {
 			return {
-				((uint32_t)type) << 30
-				| (instanceId & instanceIdMask) << 16
-				| ((uint32_t)(uviLightmap.i + 0.5f) & lightComponentMask),
+				typeBits | LightmapIndex::pack((uint32_t)(uviLightmap.i + 0.5f)),
 				packUv({ uviLightmap.u, uviLightmap.v })
 			};
 		}
+		else if (type == VertexLightType::OBJECT_COLOR) {
+			return {
+				typeBits | LightInstanceId::pack(instanceId),
+				0
+			};
+		}
 		else {
 			return {
-				((uint32_t)type) << 30
-				| (instanceId & instanceIdMask) << 16
-				| ((uint32_t)(colLight.r * lightComponentMask + 0.5f) & lightComponentMask),
-				((uint32_t)(colLight.g * lightComponentMask + 0.5f) & lightComponentMask) << 16
-				| ((uint32_t)(colLight.b * lightComponentMask + 0.5f) & lightComponentMask)
+				typeBits | LightColorLow::pack(quantizeUnorm(colLight.r, lightColorBits)),
+				LightColorHigh::pack(quantizeUnorm(colLight.g, lightColorBits))
+				| LightColorLow::pack(quantizeUnorm(colLight.b, lightColorBits))
 			};
 		}
 	}
 
 	VertexLightType unpackLightType(std::pair<uint32_t, uint32_t> packed)
 	{
-		return (VertexLightType)(packed.first >> 30);
+		return (VertexLightType)LightType::unpack(packed.first);
 	}
 
-	uint16_t unpackInstanceId(std::pair<uint32_t, uint32_t> packed)
+	uint32_t unpackInstanceId(std::pair<uint32_t, uint32_t> packed)
 	{
-		return (packed.first >> 16) & instanceIdMask;
+		if (unpackLightType(packed) == VertexLightType::OBJECT_COLOR) {
+			return LightInstanceId::unpack(packed.first);
+		}
+		return instanceIdNone;
 	}
 
 	Color unpackLightColor(std::pair<uint32_t, uint32_t> packed)
 	{
-		constexpr float invMaxVal = 1.f / lightComponentMask;
-		return Color(
-			(float)(packed.first & lightComponentMask) * invMaxVal,
-			(float)((packed.second >> 16) & lightComponentMask) * invMaxVal,
-			(float)(packed.second & lightComponentMask) * invMaxVal,
-			1.f
-		);
+		switch (unpackLightType(packed)) {
+		case VertexLightType::WORLD_LIGHTMAP:
+		case VertexLightType::OBJECT_COLOR:
+			return Color(0.f, 0.f, 0.f, 1.f);
+		default:
+			return Color(
+				dequantizeUnorm(LightColorLow::unpack(packed.first), lightColorBits),
+				dequantizeUnorm(LightColorHigh::unpack(packed.second), lightColorBits),
+				dequantizeUnorm(LightColorLow::unpack(packed.second), lightColorBits),
+				1.f
+			);
+		}
 	}
 
 	Uvi unpackLightmap(std::pair<uint32_t, uint32_t> packed)
@@ -147,7 +249,331 @@ namespace render
 		return {
 			.u = unpackedUv.u,
 			.v = unpackedUv.v,
-			.i = (float)(packed.first & lightComponentMask),
+			.i = (float)LightmapIndex::unpack(packed.first),
+		};
+	}
+
+	// Batch Packing:
+	// Kernels mirror the scalar functions above operation by operation (no FMA contraction, same rounding), so that
+	// results are bit-exact. Branches on light type are replaced by computing all variants and blending.
+
+#ifdef __AVX2__
+	constexpr static size_t batchWidth = 8;
+
+	inline __m256 abs8(__m256 value)
+	{
+		return _mm256_and_ps(value, _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF)));
+	}
+
+	// 1 for negative values (but not for -0.f), 0 otherwise
+	inline __m256i signBit8(__m256 value)
+	{
+		return _mm256_srli_epi32(_mm256_castps_si256(_mm256_cmp_ps(value, _mm256_setzero_ps(), _CMP_LT_OQ)), 31);
+	}
+
+	// same as std::lround (round half away from zero), difference to truncated value is always exact
+	inline __m256i lround8(__m256 value)
+	{
+		__m256 truncated = _mm256_round_ps(value, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+		__m256 isHalfOrMore = _mm256_cmp_ps(abs8(_mm256_sub_ps(value, truncated)), _mm256_set1_ps(0.5f), _CMP_GE_OQ);
+		__m256 awayFromZero = _mm256_or_ps(_mm256_set1_ps(1.f), _mm256_and_ps(value, _mm256_set1_ps(-0.f)));
+		return _mm256_cvttps_epi32(_mm256_add_ps(truncated, _mm256_and_ps(isHalfOrMore, awayFromZero)));
+	}
+
+	inline __m256i quantizeUnorm8(__m256 value, uint32_t bits)
+	{
+		uint32_t maxVal = (1 << bits) - 1;
+		__m256 clamped = _mm256_min_ps(_mm256_max_ps(value, _mm256_setzero_ps()), _mm256_set1_ps(1.f));
+		__m256 quant = _mm256_add_ps(_mm256_mul_ps(clamped, _mm256_set1_ps((float)maxVal)), _mm256_set1_ps(0.5f));
+		return _mm256_min_epu32(_mm256_cvttps_epi32(quant), _mm256_set1_epi32(maxVal));
+	}
+
+	inline __m256i packNormal8(__m256 x, __m256 y, __m256 z)
+	{
+		const __m256 maxVal = _mm256_set1_ps((float)normalComponentMask);
+		const __m256 half = _mm256_set1_ps(0.5f);
+		const __m256i mask = _mm256_set1_epi32(normalComponentMask);
+
+		__m256i xQuant = _mm256_min_epu32(_mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(abs8(x), maxVal), half)), mask);
+		__m256i zQuant = _mm256_min_epu32(_mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(abs8(z), maxVal), half)), mask);
+
+		__m256i result = xQuant;
+		result = _mm256_or_si256(result, _mm256_slli_epi32(signBit8(x), normalComponentBits));
+		result = _mm256_or_si256(result, _mm256_slli_epi32(zQuant, normalComponentBits + 1));
+		result = _mm256_or_si256(result, _mm256_slli_epi32(signBit8(z), normalComponentBits * 2 + 1));
+		result = _mm256_or_si256(result, _mm256_slli_epi32(signBit8(y), normalComponentBits * 2 + 2));
+		return result;
+	}
+
+	// exponentTooLarge is set to all ones for lanes that could not be compressed (see warnUvTooLarge)
+	inline __m256i packUv8(__m256 u, __m256 v, __m256i& exponentTooLarge)
+	{
+		// bit width of ceiled integer value is the float exponent of that value plus one (or zero for zero)
+		__m256 ceilMax = _mm256_max_ps(_mm256_ceil_ps(abs8(u)), _mm256_ceil_ps(abs8(v)));
+		__m256i exponent = _mm256_sub_epi32(_mm256_srli_epi32(_mm256_castps_si256(ceilMax), 23), _mm256_set1_epi32(126));
+		exponent = _mm256_max_epi32(exponent, _mm256_setzero_si256());
+		exponentTooLarge = _mm256_cmpgt_epi32(exponent, _mm256_set1_epi32(uvExponentMask));
+
+		// scale / factor is a power of two, so it can be constructed directly from exponent bits
+		constexpr int32_t scaleExponent = std::bit_width(scale) - 1;
+		__m256i factorExponent = _mm256_sub_epi32(_mm256_set1_epi32(127 + scaleExponent), exponent);
+		__m256 factor = _mm256_castsi256_ps(_mm256_slli_epi32(factorExponent, 23));
+
+		const __m256i mask = _mm256_set1_epi32(uvComponentMask);
+		__m256i uQuant = _mm256_and_si256(lround8(_mm256_mul_ps(u, factor)), mask);
+		__m256i vQuant = _mm256_and_si256(lround8(_mm256_mul_ps(v, factor)), mask);
+
+		__m256i result = vQuant;
+		result = _mm256_or_si256(result, _mm256_slli_epi32(uQuant, uvComponentBits));
+		result = _mm256_or_si256(result, _mm256_slli_epi32(exponent, uvComponentBits * 2));
+		return result;
+	}
+
+	inline void storeBatch(uint32_t* target, __m256i values)
+	{
+		_mm256_storeu_si256((__m256i*) target, values);
+	}
+#endif
+
+	void packNormals(std::span<const float> x, std::span<const float> y, std::span<const float> z, std::span<uint32_t> packed)
+	{
+		size_t count = packed.size();
+		assert(x.size() == count && y.size() == count && z.size() == count);
+		size_t i = 0;
+#ifdef __AVX2__
+		for (; i + batchWidth <= count; i += batchWidth) {
+			__m256i result = packNormal8(_mm256_loadu_ps(&x[i]), _mm256_loadu_ps(&y[i]), _mm256_loadu_ps(&z[i]));
+			storeBatch(&packed[i], result);
+		}
+#endif
+		for (; i < count; i++) {
+			packed[i] = packNormal({ x[i], y[i], z[i] });
+		}
+	}
+
+	void packUvs(std::span<const float> u, std::span<const float> v, std::span<uint32_t> packed)
+	{
+		size_t count = packed.size();
+		assert(u.size() == count && v.size() == count);
+		size_t i = 0;
+#ifdef __AVX2__
+		for (; i + batchWidth <= count; i += batchWidth) {
+			__m256i exponentTooLarge;
+			__m256i result = packUv8(_mm256_loadu_ps(&u[i]), _mm256_loadu_ps(&v[i]), exponentTooLarge);
+			storeBatch(&packed[i], result);
+			if (!_mm256_testz_si256(exponentTooLarge, exponentTooLarge)) {
+				warnUvTooLarge();
+			}
+		}
+#endif
+		for (; i < count; i++) {
+			packed[i] = packUv({ u[i], v[i] });
+		}
+	}
+
+	std::pair<uint32_t, uint32_t> packLight(const LightStreams& lights, size_t i)
+	{
+		return packLight(
+			lights.type[i],
+			Color(lights.colR[i], lights.colG[i], lights.colB[i], 1.f),
+			{ .u = lights.lightmapU[i], .v = lights.lightmapV[i], .i = lights.lightmapI[i] },
+			lights.instanceId[i]);
+	}
+
+	void packLights(const LightStreams& lights, std::span<uint32_t> packedFirst, std::span<uint32_t> packedSecond)
+	{
+		static_assert(sizeof(VertexLightType) == sizeof(int32_t));
+
+		size_t count = packedFirst.size();
+		assert(packedSecond.size() == count && lights.type.size() == count && lights.instanceId.size() == count);
+		assert(lights.colR.size() == count && lights.colG.size() == count && lights.colB.size() == count);
+		assert(lights.lightmapU.size() == count && lights.lightmapV.size() == count && lights.lightmapI.size() == count);
+
+
+		size_t i = 0;
+#ifdef __AVX2__
+		const __m256i typeLightmap = _mm256_set1_epi32((int32_t)VertexLightType::WORLD_LIGHTMAP);
+		const __m256i typeObject = _mm256_set1_epi32((int32_t)VertexLightType::OBJECT_COLOR);
+
+		for (; i + batchWidth <= count; i += batchWidth) {
+			__m256i type = _mm256_loadu_si256((const __m256i*) &lights.type[i]);
+			__m256i isLightmap = _mm256_cmpeq_epi32(type, typeLightmap);
+			__m256i isObject = _mm256_cmpeq_epi32(type, typeObject);
+			__m256i typeBits = _mm256_slli_epi32(type, LightType::offset);
+
+			// WORLD_COLOR, OBJECT_DECAL
+			__m256i first = _mm256_slli_epi32(quantizeUnorm8(_mm256_loadu_ps(&lights.colR[i]), lightColorBits), LightColorLow::offset);
+			__m256i second = _mm256_or_si256(
+				_mm256_slli_epi32(quantizeUnorm8(_mm256_loadu_ps(&lights.colG[i]), lightColorBits), LightColorHigh::offset),
+				_mm256_slli_epi32(quantizeUnorm8(_mm256_loadu_ps(&lights.colB[i]), lightColorBits), LightColorLow::offset));
+
+			// WORLD_LIGHTMAP
+			__m256i exponentTooLarge;
+			__m256i lightmapIndex = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_loadu_ps(&lights.lightmapI[i]), _mm256_set1_ps(0.5f)));
+			__m256i lightmapUv = packUv8(_mm256_loadu_ps(&lights.lightmapU[i]), _mm256_loadu_ps(&lights.lightmapV[i]), exponentTooLarge);
+			first = _mm256_blendv_epi8(first, _mm256_slli_epi32(lightmapIndex, LightmapIndex::offset), isLightmap);
+			second = _mm256_blendv_epi8(second, lightmapUv, isLightmap);
+			exponentTooLarge = _mm256_and_si256(exponentTooLarge, isLightmap);
+
+			// OBJECT_COLOR
+			__m256i instanceId = _mm256_loadu_si256((const __m256i*) &lights.instanceId[i]);
+			first = _mm256_blendv_epi8(first, _mm256_slli_epi32(instanceId, LightInstanceId::offset), isObject);
+			second = _mm256_andnot_si256(isObject, second);
+
+			storeBatch(&packedFirst[i], _mm256_or_si256(typeBits, first));
+			storeBatch(&packedSecond[i], second);
+			if (!_mm256_testz_si256(exponentTooLarge, exponentTooLarge)) {
+				warnUvTooLarge();
+			}
+		}
+#endif
+		for (; i < count; i++) {
+			std::tie(packedFirst[i], packedSecond[i]) = packLight(lights, i);
+		}
+	}
+
+	ClusterBounds createClusterBounds(Vec3 posMin, Vec3 posMax)
+	{
+		constexpr float invMaxVal = 1.f / posComponentMask;
+		return {
+			.posMin = posMin,
+			.posScale = {
+				(posMax.x - posMin.x) * invMaxVal,
+				(posMax.y - posMin.y) * invMaxVal,
+				(posMax.z - posMin.z) * invMaxVal,
+			},
+		};
+	}
+
+	uint32_t quantizePos(float value, float min, float scale)
+	{
+		if (scale <= 0.f) {
+			return 0;
+		}
+		float quant = std::round((value - min) / scale);
+		return (uint32_t)std::clamp(quant, 0.f, (float)posComponentMask);
+	}
+
+	std::pair<uint32_t, uint32_t> packPosCompact(Vec3 pos, const ClusterBounds& bounds, uint32_t clusterIndex)
+	{
+		return {
+			PosHigh::pack(quantizePos(pos.y, bounds.posMin.y, bounds.posScale.y))
+			| PosLow::pack(quantizePos(pos.x, bounds.posMin.x, bounds.posScale.x)),
+			PosClusterIndex::pack(clusterIndex)
+			| PosLow::pack(quantizePos(pos.z, bounds.posMin.z, bounds.posScale.z))
+		};
+	}
+
+	Vec3 unpackPosCompact(std::pair<uint32_t, uint32_t> packed, const ClusterBounds& bounds)
+	{
+		return {
+			bounds.posMin.x + PosLow::unpack(packed.first) * bounds.posScale.x,
+			bounds.posMin.y + PosHigh::unpack(packed.first) * bounds.posScale.y,
+			bounds.posMin.z + PosLow::unpack(packed.second) * bounds.posScale.z,
+		};
+	}
+
+	uint32_t unpackClusterIndex(std::pair<uint32_t, uint32_t> packed)
+	{
+		return PosClusterIndex::unpack(packed.second);
+	}
+
+	float signNotZero(float value)
+	{
+		return value >= 0.f ? 1.f : -1.f;
+	}
+
+	uint32_t packNormalOct(Vec3 raw)
+	{
+		float lengthL1 = std::abs(raw.x) + std::abs(raw.y) + std::abs(raw.z);
+		if (lengthL1 <= 0.f) {
+			return packNormalOct({ 0.f, 1.f, 0.f });
+		}
+		float x = raw.x / lengthL1;
+		float z = raw.z / lengthL1;
+		if (raw.y < 0.f) {
+			// fold lower hemisphere over diagonals
+			float xFolded = (1.f - std::abs(z)) * signNotZero(x);
+			z = (1.f - std::abs(x)) * signNotZero(z);
+			x = xFolded;
+		}
+		int32_t xQuant = std::lround(std::clamp(x, -1.f, 1.f) * octComponentMax);
+		int32_t zQuant = std::lround(std::clamp(z, -1.f, 1.f) * octComponentMax);
+		return ((uint32_t)zQuant & octComponentMask) << octComponentBits
+			| ((uint32_t)xQuant & octComponentMask);
+	}
+
+	Vec3 unpackNormalOct(uint32_t packed)
+	{
+		float x = std::max((int16_t)(packed & octComponentMask) / octComponentMax, -1.f);
+		float z = std::max((int16_t)(packed >> octComponentBits) / octComponentMax, -1.f);
+		float y = 1.f - std::abs(x) - std::abs(z);
+		float unfold = std::max(-y, 0.f);
+		x += x >= 0.f ? -unfold : unfold;
+		z += z >= 0.f ? -unfold : unfold;
+
+		float invLength = 1.f / std::sqrt(x * x + y * y + z * z);
+		return { x * invLength, y * invLength, z * invLength };
+	}
+
+	uint32_t packLightCompact(VertexLightType type, Color colLight, Uvi uviLightmap, uint32_t instanceId)
+	{
+		uint32_t typeBits = LightType::pack((uint32_t)type);
+		if (type == VertexLightType::WORLD_LIGHTMAP) {
+			return typeBits
+				| LightmapIndexCompact::pack((uint32_t)(uviLightmap.i + 0.5f))
+				| LightmapUCompact::pack(quantizeUnorm(uviLightmap.u, lightmapUvBitsCompact))
+				| LightmapVCompact::pack(quantizeUnorm(uviLightmap.v, lightmapUvBitsCompact));
+		}
+		else if (type == VertexLightType::OBJECT_COLOR) {
+			return typeBits | LightInstanceId::pack(instanceId);
+		}
+		else {
+			return typeBits
+				| LightColorRCompact::pack(quantizeUnorm(colLight.r, lightColorBitsCompact))
+				| LightColorGCompact::pack(quantizeUnorm(colLight.g, lightColorBitsCompact))
+				| LightColorBCompact::pack(quantizeUnorm(colLight.b, lightColorBitsCompact));
+		}
+	}
+
+	VertexLightType unpackLightTypeCompact(uint32_t packed)
+	{
+		return (VertexLightType)LightType::unpack(packed);
+	}
+
+	uint32_t unpackInstanceIdCompact(uint32_t packed)
+	{
+		if (unpackLightTypeCompact(packed) == VertexLightType::OBJECT_COLOR) {
+			return LightInstanceId::unpack(packed);
+		}
+		return instanceIdNone;
+	}
+
+	Color unpackLightColorCompact(uint32_t packed)
+	{
+		switch (unpackLightTypeCompact(packed)) {
+		case VertexLightType::WORLD_LIGHTMAP:
+		case VertexLightType::OBJECT_COLOR:
+			return Color(0.f, 0.f, 0.f, 1.f);
+		default:
+			return Color(
+				dequantizeUnorm(LightColorRCompact::unpack(packed), lightColorBitsCompact),
+				dequantizeUnorm(LightColorGCompact::unpack(packed), lightColorBitsCompact),
+				dequantizeUnorm(LightColorBCompact::unpack(packed), lightColorBitsCompact),
+				1.f
+			);
+		}
+	}
+
+	Uvi unpackLightmapCompact(uint32_t packed)
+	{
+		if (unpackLightTypeCompact(packed) != VertexLightType::WORLD_LIGHTMAP) {
+			return { .u = 0.f, .v = 0.f, .i = -1.f };
+		}
+		return {
+			.u = dequantizeUnorm(LightmapUCompact::unpack(packed), lightmapUvBitsCompact),
+			.v = dequantizeUnorm(LightmapVCompact::unpack(packed), lightmapUvBitsCompact),
+			.i = (float)LightmapIndexCompact::unpack(packed),
 		};
 	}
 }
\ No newline at end of file
@@ -2,16 +2,65 @@
 
 #include "render/basic/Primitives.h"
 
+#include <span>
+
 namespace render
 {
+	// Limits of packed formats, must be checked at load time (see VertexPacker.cpp for bit layouts)
+	constexpr uint32_t instanceIdCountMax = 1 << 30;
+	constexpr uint32_t instanceIdNone = UINT32_MAX;
+	constexpr uint32_t lightmapCountMax = 1 << 16;
+
 	uint32_t packNormal(Vec3 normal);
 	Vec3 unpackNormal(uint32_t packed);
 	uint32_t packUv(Uv uv);
 	Uv unpackUv(uint32_t packed);
 
-	std::pair<uint32_t, uint32_t> packLight(VertexLightType type, Color colLight, Uvi uviLightmap, uint16_t instanceId);
+	// OBJECT_COLOR light only stores instance ID, light color is stored per instance (see StaticInstanceFeatures)
+	std::pair<uint32_t, uint32_t> packLight(VertexLightType type, Color colLight, Uvi uviLightmap, uint32_t instanceId);
 	VertexLightType unpackLightType(std::pair<uint32_t, uint32_t> packed);
-	uint16_t unpackInstanceId(std::pair<uint32_t, uint32_t> packed);
+	uint32_t unpackInstanceId(std::pair<uint32_t, uint32_t> packed);
 	Color unpackLightColor(std::pair<uint32_t, uint32_t> packed);
 	Uvi unpackLightmap(std::pair<uint32_t, uint32_t> packed);
+
+	// Batch packing of SoA streams, all streams of a call must have equal size. Results are bit-exact to packing each
+	// vertex with the functions above (for finite inputs). Uses AVX2 when available, remaining verts are packed scalar.
+	void packNormals(std::span<const float> x, std::span<const float> y, std::span<const float> z, std::span<uint32_t> packed);
+	void packUvs(std::span<const float> u, std::span<const float> v, std::span<uint32_t> packed);
+
+	struct LightStreams {
+		std::span<const VertexLightType> type;
+		std::span<const float> colR;
+		std::span<const float> colG;
+		std::span<const float> colB;
+		std::span<const float> lightmapU;
+		std::span<const float> lightmapV;
+		std::span<const float> lightmapI;
+		std::span<const uint32_t> instanceId;
+	};
+	void packLights(const LightStreams& lights, std::span<uint32_t> packedFirst, std::span<uint32_t> packedSecond);
+
+	// Compact format
+
+	constexpr uint32_t lightmapCountMaxCompact = 1 << 8;
+	constexpr uint32_t clusterCountMaxCompact = 1 << 16;// per batch
+
+	// quantization bounds of all verts of a single vertex cluster, uploaded as structured buffer (must match HLSL struct)
+	struct ClusterBounds {
+		Vec3 posMin;
+		Vec3 posScale;
+	};
+	ClusterBounds createClusterBounds(Vec3 posMin, Vec3 posMax);
+
+	std::pair<uint32_t, uint32_t> packPosCompact(Vec3 pos, const ClusterBounds& bounds, uint32_t clusterIndex);
+	Vec3 unpackPosCompact(std::pair<uint32_t, uint32_t> packed, const ClusterBounds& bounds);
+	uint32_t unpackClusterIndex(std::pair<uint32_t, uint32_t> packed);
+	uint32_t packNormalOct(Vec3 normal);
+	Vec3 unpackNormalOct(uint32_t packed);
+
+	uint32_t packLightCompact(VertexLightType type, Color colLight, Uvi uviLightmap, uint32_t instanceId);
+	VertexLightType unpackLightTypeCompact(uint32_t packed);
+	uint32_t unpackInstanceIdCompact(uint32_t packed);
+	Color unpackLightColorCompact(uint32_t packed);
+	Uvi unpackLightmapCompact(uint32_t packed);
 }
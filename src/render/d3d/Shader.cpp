@@ -122,7 +122,7 @@ namespace render::d3d
 		Vertex, Pixel, Compute
 	};
 
-	ID3D10Blob* compile(D3d d3d, const std::string& source, ShaderType type, bool isVertexInputPacked)
+	ID3D10Blob* compile(D3d d3d, const std::string& source, ShaderType type, bool isVertexInputPacked, bool isVertexInputCompact = false)
 	{
 		LPCSTR profile = type == ShaderType::Vertex ? "vs_5_0" : type == ShaderType::Pixel ? "ps_5_0" : "cs_5_0";
 		LPCSTR entry = type == ShaderType::Vertex ? "VS_Main" : type == ShaderType::Pixel ? "PS_Main" : "CS_Main";
@@ -132,6 +132,7 @@ namespace render::d3d
 
 		const D3D_SHADER_MACRO defines[] = {
 			{"VERTEX_INPUT_RAW", isVertexInputPacked ? "0" : "1" },
+			{"VERTEX_INPUT_COMPACT", isVertexInputCompact ? "1" : "0" },
 			{nullptr, nullptr},
 		};
 		auto hr = D3DCompileFromFile(
@@ -144,8 +145,11 @@ namespace render::d3d
 		return result;
 	}
 
-	void createShader(D3d d3d, Shader& target, const std::string& shaderName, const std::vector<VertexAttributeDesc>& inputLayout, bool vsOnly)
+	void createShader(D3d d3d, Shader& target, const std::string& shaderName, const std::vector<VertexAttributeDesc>& inputLayout, bool vsOnly, VertexFormat vertexFormat)
 	{
+		bool isCompact = vertexFormat == VertexFormat::COMPACT;
+		assert(!isCompact || PACK_VERTEX_ATTRIBUTES);
+
 		bool success = true;
 
 		std::string sourceFile = filePath(shaderName);
@@ -153,11 +157,11 @@ namespace render::d3d
 
 		// compile both shaders
 		std::wstring sourceFileW = util::utf8ToWide(sourceFile);
-		ID3D10Blob* VS = compile(d3d, sourceFile, ShaderType::Vertex, PACK_VERTEX_ATTRIBUTES);
+		ID3D10Blob* VS = compile(d3d, sourceFile, ShaderType::Vertex, PACK_VERTEX_ATTRIBUTES, isCompact);
 		success = VS != nullptr && success;
 		ID3D10Blob* PS = nullptr;
 		if (!vsOnly) {
-			PS = compile(d3d, sourceFile, ShaderType::Pixel, PACK_VERTEX_ATTRIBUTES);
+			PS = compile(d3d, sourceFile, ShaderType::Pixel, PACK_VERTEX_ATTRIBUTES, isCompact);
 			success = PS != nullptr && success;
 		}
 
@@ -30,5 +30,6 @@ namespace render::d3d
 
 	std::vector<VertexAttributeDesc> buildInputLayoutDesc(const std::initializer_list<VertexAttributes>& buffers);
 
-	void createShader(D3d d3d, Shader& target, const std::string& sourceFile, const std::vector<VertexAttributeDesc>& inputLayout, bool vsOnly = false);
+	void createShader(D3d d3d, Shader& target, const std::string& sourceFile, const std::vector<VertexAttributeDesc>& inputLayout,
+		bool vsOnly = false, VertexFormat vertexFormat = VertexFormat::DEFAULT);
 }
\ No newline at end of file
@@ -145,10 +145,7 @@ namespace render::d3d
 	{
 		assert(usage != BufferUsage::IMMUTABLE);
 		release(*target);
-		// TODO maybe we should make it possible to initialize an immutable array by passing createTexture2dBuf with initialMipsAndSlices
-		// and maybe createTextureFromGothicTex can be passed a lamda that decides how/if to initialize anything
-		// Maybe createTextureFromGothicTex can allocate all data pointers on the heap that need to persist until texture creation
-		// and put them into a cleanup vector that is also passed by the caller?
+		// prefer createTexture2dArrayBuf with initial data if CPU data for all slices is available
 
 		// we assume here that all original buffers have an identical buffer description
 		D3D11_TEXTURE2D_DESC bufferDesc;
@@ -192,4 +189,41 @@ namespace render::d3d
 		auto hr = d3d.device->CreateShaderResourceView(buffer, &srvDesc, targetSrv);
 		::util::throwOnError(hr, "createTexture2dArraySrv failed!");
 	}
-}
\ No newline at end of file
+
+	void createTexture2dArrayBuf(
+		D3d d3d, ID3D11Texture2D** target, BufferSize size, DXGI_FORMAT format,
+		const std::vector<std::vector<InitialData>>& initialSlicesMips, BufferUsage usage)
+	{
+		release(*target);
+		assert(!initialSlicesMips.empty());
+		uint32_t mipCount = initialSlicesMips.at(0).size();
+
+		D3D11_TEXTURE2D_DESC desc = {};
+		desc.Width = size.width;
+		desc.Height = size.height;
+		desc.ArraySize = initialSlicesMips.size();
+		desc.MipLevels = mipCount;
+		desc.Format = format;
+		desc.SampleDesc.Count = 1;
+		desc.SampleDesc.Quality = 0;
+		desc.Usage = (D3D11_USAGE) usage;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+		// subresource order is all mips of first slice, then all mips of second slice etc.
+		std::vector<D3D11_SUBRESOURCE_DATA> initialData;
+		initialData.reserve(initialSlicesMips.size() * mipCount);
+		for (const auto& initialMips : initialSlicesMips) {
+			assert(initialMips.size() == mipCount);
+			for (const auto& initialMip : initialMips) {
+				const auto& surface = initialMip.surface;
+				initialData.push_back({
+					.pSysMem = initialMip.dataPtr,
+					.SysMemPitch = surface.bytesPerRow,
+					.SysMemSlicePitch = surface.bytesPerRow * surface.rowCount,
+				});
+			}
+		}
+		auto hr = d3d.device->CreateTexture2D(&desc, initialData.data(), target);
+		::util::throwOnError(hr, "createTexture2dArrayBuf failed!");
+	}
+}
@@ -42,6 +42,7 @@ namespace render::pass::world
 	ShaderContext diffuseOnly;
 	ShaderContext wireframe;
 	ShaderContext debug;
+	VertexFormat shaderVertexFormat = VertexFormat::DEFAULT;
 
 	enum CbLodRangeType {
 		NONE,
@@ -62,15 +63,29 @@ namespace render::pass::world
 
 	d3d::ConstantBuffer<CbLodRange> lodRangeCb = {};
 
+	// SV_VertexID does not include BaseVertexLocation of indexed draws, needed by VS to look up TexIndexRange by vertex
+	__declspec(align(16)) struct CbDrawBaseVertex {
+		static uint16_t slot() {
+			return 6;
+		}
+
+		uint32_t baseVertex;
+	};
+
+	d3d::ConstantBuffer<CbDrawBaseVertex> baseVertexCb = {};
+	uint32_t currentCbBaseVertex = UINT32_MAX;
+
 	struct DrawRange {
 		uint32_t start;
 		uint32_t count;
+		uint32_t baseVertex = 0;
 	};
 
 	struct MergedDrawsBuilder {
 	private:
 		bool currentRangeActive = false;
 		uint32_t currentRangeStart = 0;
+		uint32_t currentBaseVertex = 0;
 
 	public:
 		std::vector<DrawRange> draws;
@@ -91,28 +106,34 @@ namespace render::pass::world
 				currentRangeActive = false;
 				uint32_t drawCount = drawEndExlusive - currentRangeStart;
 				if (drawCount > 0) {
-					draws.push_back({ currentRangeStart, drawCount });
+					draws.push_back({ currentRangeStart, drawCount, currentBaseVertex });
 				}
 			}
 		}
 
-		void createOrFinalizeRange(bool isActive, uint32_t drawStart)
+		void createOrFinalizeRange(bool isActive, uint32_t drawStart, uint32_t baseVertex)
 		{
 			// TODO chunks with very few verts should be allowed to be enabled if range is active currently, if that helps joining ranges (test!)
 			uint32_t ignoreChunkVertThreshold = 500;// TODO
 
 			assert(drawStart >= currentRangeStart);
+			if (!isActive || baseVertex != currentBaseVertex) {
+				// indices of clusters with different base vertex cannot be drawn with a single draw call
+				finalizeRange(drawStart);
+			}
 			if (!currentRangeActive && isActive) {
 				// range start
 				currentRangeStart = drawStart;
+				currentBaseVertex = baseVertex;
 				currentRangeActive = true;
 			}
-			if (!isActive) {
-				finalizeRange(drawStart);
-			}
 		}
 	};
 
+	// use two so we can render close geometry before far geometry for better early-z, re-used to prevent allocations
+	MergedDrawsBuilder mergedDraws;
+	MergedDrawsBuilder mergedDrawsClose;
+
 	float minLodStart = 0.00001f;
 	float minLodWidth = 0.001f;// since this is added to potentially bigger number, we have less precision
 
@@ -197,7 +218,20 @@ namespace render::pass::world
 	}
 
 	LoadWorldResult loadWorld(D3d d3d, const std::string& level) {
-		return loadZenLevel(d3d, level);
+		VertexFormat vertexFormat = worldSettings.compactVertexFormat ? VertexFormat::COMPACT : VertexFormat::DEFAULT;
+		assets::setLoadMemoryBudget((uint64_t) worldSettings.loadMemoryBudgetMb * 1024 * 1024);
+		uint64_t assetCacheBudget = (uint64_t) worldSettings.assetCacheBudgetMb * 1024 * 1024;
+		LoadWorldResult result = loadZenLevel(d3d, level, vertexFormat, assetCacheBudget);
+		if (result.loaded && world.vertexFormat != shaderVertexFormat) {
+			reinitShaders(d3d);
+		}
+		return result;
+	}
+
+	void preloadWorld(D3d d3d, const std::string& level) {
+		assets::setLoadMemoryBudget((uint64_t) worldSettings.loadMemoryBudgetMb * 1024 * 1024);
+		uint64_t assetCacheBudget = (uint64_t) worldSettings.assetCacheBudgetMb * 1024 * 1024;
+		preloadZenLevel(d3d, level, assetCacheBudget);
 	}
 
 	void updateObjects(float deltaTime)
@@ -248,53 +282,61 @@ namespace render::pass::world
 
 		//d3d::createConstantBuf(d3d, worldSettingsCb, BufferUsage::WRITE_GPU);
 		d3d::createConstantBuf(d3d, lodRangeCb, BufferUsage::WRITE_GPU);
+		d3d::createConstantBuf(d3d, baseVertexCb, BufferUsage::WRITE_GPU);
+		currentCbBaseVertex = UINT32_MAX;
 
 		sky::initConstantBuffers(d3d);
 	}
 
 	void reinitShaders(D3d d3d)
 	{
+		// input layouts must match vertex buffers of currently loaded level
+		VertexFormat format = world.vertexFormat;
+		bool isCompact = format == VertexFormat::COMPACT;
+		VertexAttributes layoutPos = isCompact ? inputLayout<VertexPosCompact>() : inputLayout<VertexPos>();
+		VertexAttributes layoutNorUv = isCompact ? inputLayout<VertexNorUvCompact>() : inputLayout<VertexNorUv>();
+		VertexAttributes layoutOther = isCompact ? inputLayout<VertexLightCompact>() : inputLayout<VertexBasic>();
+		shaderVertexFormat = format;
+
 		std::initializer_list fullLayout = {
-			inputLayout<VertexPos>(),
-			inputLayout<VertexNorUv>(),
-			inputLayout<TexIndex>(),
-			inputLayout<VertexBasic>(),
+			layoutPos,
+			layoutNorUv,
+			layoutOther,
 		};
 		GetVertexBuffers getFullBuffers = [](const MeshBatch& mesh) -> vector<VertexBuffer> {
 			return {
 				mesh.vbPos,
 				mesh.vbNormalUv,
-				mesh.vbTexIndices,
 				mesh.vbOther,
 			};
 		};
-		main = ShaderContext::init(d3d, "forward/world", fullLayout, getFullBuffers);
-		debug = ShaderContext::init(d3d, "forward/worldDebug", fullLayout, getFullBuffers);
+		main = ShaderContext::init(d3d, "forward/world", fullLayout, getFullBuffers, format);
+		debug = ShaderContext::init(d3d, "forward/worldDebug", fullLayout, getFullBuffers, format);
 
 		diffuseOnly = ShaderContext::init(d3d, "forward/worldDiffuseOnly",
 			{
-				inputLayout<VertexPos>(),
-				inputLayout<VertexNorUv>(),
-				inputLayout<TexIndex>(),
+				layoutPos,
+				layoutNorUv,
 			},
 			[](const MeshBatch& mesh) -> vector<VertexBuffer> {
 				return {
 					mesh.vbPos,
 					mesh.vbNormalUv,
-					mesh.vbTexIndices
 				};
-			}
+			},
+			format
 		);
 
 		wireframe = ShaderContext::init(d3d, "forward/wireframe",
 			{
-				inputLayout<VertexPos>(),
+				layoutPos,
 			},
 			[](const MeshBatch& mesh) -> vector<VertexBuffer> {
 				return {
 					mesh.vbPos,
 				};
-			}
+			},
+			format
 		);
 
 		sky::reinitShaders(d3d);
@@ -345,12 +387,24 @@ namespace render::pass::world
 		return { cbLodRange.rangeBegin, cbLodRange.rangeEnd };
 	}
 
+	void updateBaseVertexCb(D3d d3d, uint32_t baseVertex)
+	{
+		// consecutive draws mostly share the same base vertex, so buffer is only rewritten on change
+		if (baseVertex != currentCbBaseVertex) {
+			CbDrawBaseVertex cbBaseVertex;
+			cbBaseVertex.baseVertex = baseVertex;
+			d3d::updateConstantBuf(d3d, baseVertexCb, cbBaseVertex);
+			currentCbBaseVertex = baseVertex;
+		}
+	}
+
 	DrawStats draw(D3d d3d, DrawRange range, bool indexed)
 	{
 		DrawStats stats;
 		if (!worldSettings.debugSingleDrawEnabled || worldSettings.debugSingleDrawIndex == currentDrawCall) {
+			updateBaseVertexCb(d3d, indexed ? range.baseVertex : 0);
 			if (indexed) {
-				d3d.deviceContext->DrawIndexed(range.count, range.start, 0);
+				d3d.deviceContext->DrawIndexed(range.count, range.start, range.baseVertex);
 			}
 			else {
 				d3d.deviceContext->Draw(range.count, range.start);
@@ -364,17 +418,6 @@ namespace render::pass::world
 		return stats;
 	}
 
-	DrawStats drawAllMeshClusters(D3d d3d, const vector<ChunkVertCluster>& vertClusters, uint32_t drawCount, bool indexed)
-	{
-		CbLodRange cbLodRange;
-		cbLodRange.rangeType = CbLodRangeType::NONE;
-
-		d3d::updateConstantBuf(d3d, lodRangeCb, cbLodRange);
-		d3d.deviceContext->PSSetConstantBuffers(CbLodRange::slot(), 1, &lodRangeCb.buffer);
-
-		return draw(d3d, { vertClusters.at(0).vertStartIndex, drawCount }, indexed);
-	}
-
 	DrawStats draw(D3d d3d, const std::vector<DrawRange>& drawList, bool indexed)
 	{
 		DrawStats stats;
@@ -386,6 +429,26 @@ namespace render::pass::world
 		return stats;
 	}
 
+	DrawStats drawAllMeshClusters(
+		D3d d3d, MergedDrawsBuilder& builder, const vector<ChunkVertCluster>& vertClusters, uint32_t drawCount, bool indexed)
+	{
+		CbLodRange cbLodRange;
+		cbLodRange.rangeType = CbLodRangeType::NONE;
+
+		d3d::updateConstantBuf(d3d, lodRangeCb, cbLodRange);
+		d3d.deviceContext->PSSetConstantBuffers(CbLodRange::slot(), 1, &lodRangeCb.buffer);
+		d3d.deviceContext->VSSetConstantBuffers(CbDrawBaseVertex::slot(), 1, &baseVertexCb.buffer);
+
+		// clusters are only split into multiple draws if they use different base vertices
+		builder.reinit(vertClusters.size());
+		for (const ChunkVertCluster& cluster : vertClusters) {
+			builder.createOrFinalizeRange(true, cluster.vertStartIndex, cluster.baseVertex);
+		}
+		builder.finalizeRange(vertClusters.at(0).vertStartIndex + drawCount);
+
+		return draw(d3d, builder.draws, indexed);
+	}
+
 	void createMeshClusterDraws(
 		D3d d3d,
 		MergedDrawsBuilder& drawsBuilder,
@@ -402,6 +465,7 @@ namespace render::pass::world
 
 		auto [lodRadiusBegin, lodRadiusEnd] = updateLodRangeCb(d3d, ignoreLodRadius, isLodNear);
 		d3d.deviceContext->PSSetConstantBuffers(CbLodRange::slot(), 1, &lodRangeCb.buffer);
+		d3d.deviceContext->VSSetConstantBuffers(CbDrawBaseVertex::slot(), 1, &baseVertexCb.buffer);
 
 		float lodRadiusSq = std::pow(worldSettings.lodRadius, 2);
 		float lodRadiusBeginSq = std::pow(lodRadiusBegin, 2);
@@ -415,6 +479,7 @@ namespace render::pass::world
 		for (uint32_t i = 0; i < vertClusters.size(); i++) {
 			const GridPos& gridPos = vertClusters[i].gridPos;
 			uint32_t vertStartIndex = vertClusters[i].vertStartIndex;
+			uint32_t baseVertex = vertClusters[i].baseVertex;
 
 			auto gridIndex = chunkgrid::getIndex(gridPos);
 			auto camera = chunkgrid::getCameraInfoInner(gridIndex.innerIndex);
@@ -443,8 +508,8 @@ namespace render::pass::world
 
 			bool isClose = splitCloseCells && worldSettings.renderCloseFirst && camera.intersectsFrustumClose;
 
-			drawsBuilder.createOrFinalizeRange(currentChunkActive && !isClose, vertStartIndex);
-			drawsBuilderClose.createOrFinalizeRange(currentChunkActive && isClose, vertStartIndex);
+			drawsBuilder.createOrFinalizeRange(currentChunkActive && !isClose, vertStartIndex, baseVertex);
+			drawsBuilderClose.createOrFinalizeRange(currentChunkActive && isClose, vertStartIndex, baseVertex);
 		}
 		// end last range
 		drawsBuilder.finalizeRange(drawOffset + drawCount);
@@ -461,7 +526,12 @@ namespace render::pass::world
 			}
 
 			d3d::setVertexBuffers(d3d, shaderContext.getVertexBuffers(mesh));
+			if (mesh.clusterBoundsSb != nullptr) {
+				d3d.deviceContext->VSSetShaderResources(3, 1, &mesh.clusterBoundsSb);
+			}
 			if (bindTexColor) {
+				d3d.deviceContext->VSSetShaderResources(4, 1, &mesh.texIndicesSb);
+				d3d.deviceContext->VSSetShaderResources(5, 1, &mesh.texIndexBucketsSb);
 				d3d.deviceContext->PSSetShaderResources(0, 1, &mesh.texColorArray);
 			}
 
@@ -473,21 +543,17 @@ namespace render::pass::world
 			if (drawAllChunks) {
 				// for small number of verts per batch we ignore the clusters to save draw calls / LOD overhead
 				if (worldSettings.lodDisplayMode != LodMode::FAR) {
-					stats += drawAllMeshClusters(d3d, mesh.vertClusters, mesh.drawCount, indexed);
+					stats += drawAllMeshClusters(d3d, mergedDraws, mesh.vertClusters, mesh.drawCount, indexed);
 				}
 			}
 			else {
 				bool drawLod = indexed && hasLod && worldSettings.enableLod;
 
-				// use two so we can render close geometry before far geometry for better early-z, re-used to prevent allocations
-				static MergedDrawsBuilder builder;
-				static MergedDrawsBuilder builderClose;
-
 				if (worldSettings.lodDisplayMode != LodMode::FAR) {
 					d3d.annotation->BeginEvent(L"LOD High");
-					createMeshClusterDraws(d3d, builder, builderClose, mesh.vertClusters, mesh.drawCount, true, !drawLod, hasOccluders);
-					stats += draw(d3d, builderClose.draws, indexed);
-					stats += draw(d3d, builder.draws, indexed);
+					createMeshClusterDraws(d3d, mergedDraws, mergedDrawsClose, mesh.vertClusters, mesh.drawCount, true, !drawLod, hasOccluders);
+					stats += draw(d3d, mergedDrawsClose.draws, indexed);
+					stats += draw(d3d, mergedDraws.draws, indexed);
 					d3d.annotation->EndEvent();
 				}
 				if (drawLod && worldSettings.lodDisplayMode != LodMode::NEAR) {
@@ -496,9 +562,9 @@ namespace render::pass::world
 						stats.stateChanges++; 
 					}
 					d3d.annotation->BeginEvent(L"LOD Low");
-					createMeshClusterDraws(d3d, builder, builderClose, mesh.vertClustersLod, mesh.drawLodCount, false, false, hasOccluders);
-					stats += draw(d3d, builderClose.draws, indexed);
-					stats += draw(d3d, builder.draws, indexed);
+					createMeshClusterDraws(d3d, mergedDraws, mergedDrawsClose, mesh.vertClustersLod, mesh.drawLodCount, false, false, hasOccluders);
+					stats += draw(d3d, mergedDrawsClose.draws, indexed);
+					stats += draw(d3d, mergedDraws.draws, indexed);
 					d3d.annotation->EndEvent();
 				}
 			}
@@ -563,8 +629,10 @@ namespace render::pass::world
 	{
 		sky::clean();
 		clearZenLevel();
+		clearTextureCache();
 		release(samplerState);
 		lodRangeCb.release();
+		baseVertexCb.release();
 
 		main.release();
 		diffuseOnly.release();
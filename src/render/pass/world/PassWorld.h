@@ -11,6 +11,7 @@
 namespace render::pass::world
 {
 	LoadWorldResult loadWorld(D3d d3d, const std::string& level);
+	void preloadWorld(D3d d3d, const std::string& level);
 	void updateObjects(float deltaTime);
 	void updateSettings(bool showAdvancedSettings);
 	void updatePrepareDraws(D3d d3d, const DirectX::BoundingFrustum& cameraFrustum, bool hasCameraChanged);
@@ -8,6 +8,10 @@
 
 #include <imgui.h>
 
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 // TODO rename namespace
 namespace render::pass::world::chunkgrid
 {
@@ -18,10 +22,23 @@ namespace render::pass::world::chunkgrid
 
 	bool isInitialized = false;
 	Grid grid;
-	uint16_t baseCellsInUse = 0;
+	uint32_t baseCellsInUse = 0;
+	bool distancesInitialized = false;
 
 	grid::LayeredCells<CellCameraInfo, LayerCellCameraInfo> cellsCamera;
 
+	// Base cells are culled in batches. Bounds are stored as SoA and padded to a multiple of batch size, padding
+	// cells are never in use and results for them are discarded.
+	constexpr uint32_t cellBatchSize = 8;
+
+	struct CellBoundsSoa {
+		vector<float> centerX, centerY, centerZ;
+		vector<float> extentX, extentY, extentZ;
+	} cellBounds;
+
+	// plane normals are pointing outwards (see BoundingFrustum::GetPlanes)
+	using FrustumPlanes = std::array<XMFLOAT4, 6>;
+
 	struct Stats {
 		uint32_t intersects = 0;
 		stats::SamplerId intersectsSampler;
@@ -29,7 +46,7 @@ namespace render::pass::world::chunkgrid
 	} stats;
 
 
-	uint16_t init(const Grid& gridParam)
+	uint32_t init(const Grid& gridParam)
 	{
 		stats.intersectsSampler = stats::createSampler();
 		stats.intersectsTime = stats::createTimeSampler();
@@ -57,10 +74,26 @@ namespace render::pass::world::chunkgrid
 		grid = gridParam;
 		grid::propagateBoundsToLayer(grid);
 		cellsCamera.resize(grid);
+
+		uint32_t paddedCount = ((grid.cellCount + cellBatchSize - 1) / cellBatchSize) * cellBatchSize;
+		for (auto* component : { &cellBounds.centerX, &cellBounds.centerY, &cellBounds.centerZ,
+				&cellBounds.extentX, &cellBounds.extentY, &cellBounds.extentZ }) {
+			component->assign(paddedCount, 0.f);
+		}
+		for (uint32_t i = 0; i < grid.cellCount; i++) {
+			const BoundingBox& bbox = grid.cells.base[i].bbox;
+			cellBounds.centerX[i] = bbox.Center.x;
+			cellBounds.centerY[i] = bbox.Center.y;
+			cellBounds.centerZ[i] = bbox.Center.z;
+			cellBounds.extentX[i] = bbox.Extents.x;
+			cellBounds.extentY[i] = bbox.Extents.y;
+			cellBounds.extentZ[i] = bbox.Extents.z;
+		}
 		for (uint32_t i = 0; i < grid.cellCount; i++) {
 			if (grid.cells.base[i].isInUse) baseCellsInUse++;
 		}
 		isInitialized = true;
+		distancesInitialized = false;
 		return grid.cellCount;
 	}
 
@@ -87,14 +120,14 @@ namespace render::pass::world::chunkgrid
 		float size = grid.cellCountXY;
 		std::string buffer((size * cellSize) + cellSize, ' ');
 
-		for (uint8_t x = 0; x < size; x++) {
+		for (uint16_t x = 0; x < size; x++) {
 			strplace(buffer, (x * cellSize) + cellSize, ::util::leftPad(std::to_string(x), cellSize));
 		}
 		LOG(DEBUG) << buffer;
 
-		for (uint8_t y = 0; y < size; y++) {
+		for (uint16_t y = 0; y < size; y++) {
 			strplace(buffer, 0, ::util::leftPad(std::to_string(y), cellSize));
-			for (uint8_t x = 0; x < size; x++) {
+			for (uint16_t x = 0; x < size; x++) {
 				uint32_t index = grid::getIndex({ x, y });
 				std::string cellValue = cellsCamera.base[index].intersectsFrustum ? "X" : "O";
 				//std::string cellValue = toStr(chunks[index].second.Extents);
@@ -104,37 +137,144 @@ namespace render::pass::world::chunkgrid
 		}
 	}
 
-	inline bool isBaseCellIntersectOrContain(const grid::CellInfo& baseCell, uint32_t& intersectCount, const BoundingFrustum& cameraFrustum)
+	FrustumPlanes getPlanes(const BoundingFrustum& frustum)
 	{
-		return baseCell.isInUse && cameraFrustum.Intersects(baseCell.bbox) && (++intersectCount);
+		std::array<XMVECTOR, 6> planesXm;
+		frustum.GetPlanes(&planesXm[0], &planesXm[1], &planesXm[2], &planesXm[3], &planesXm[4], &planesXm[5]);
+		FrustumPlanes planes;
+		for (uint32_t i = 0; i < planes.size(); i++) {
+			XMStoreFloat4(&planes[i], planesXm[i]);
+		}
+		return planes;
 	}
 
-	inline bool isBaseCellIntersectOrContain(const grid::CellInfo& baseCell, uint32_t& intersectCount, const BoundingFrustum& cameraFrustum, ContainmentType parentIntersect)
+	// Returns bitmask of all cells in batch that are completely outside of any frustum plane. Like BoundingFrustum::Contains,
+	// this only tests the planes, so a few cells close to frustum edges might not be detected as disjoint (conservative).
+	uint32_t getDisjointMask(uint32_t batchStart, const FrustumPlanes& planes)
 	{
-		return baseCell.isInUse
-			&& parentIntersect != ContainmentType::DISJOINT
-			&& (parentIntersect == ContainmentType::CONTAINS || (cameraFrustum.Intersects(baseCell.bbox) && (++intersectCount)));
+#ifdef __AVX2__
+		__m256 centerX = _mm256_loadu_ps(&cellBounds.centerX[batchStart]);
+		__m256 centerY = _mm256_loadu_ps(&cellBounds.centerY[batchStart]);
+		__m256 centerZ = _mm256_loadu_ps(&cellBounds.centerZ[batchStart]);
+		__m256 extentX = _mm256_loadu_ps(&cellBounds.extentX[batchStart]);
+		__m256 extentY = _mm256_loadu_ps(&cellBounds.extentY[batchStart]);
+		__m256 extentZ = _mm256_loadu_ps(&cellBounds.extentZ[batchStart]);
+
+		__m256 outside = _mm256_setzero_ps();
+		for (const XMFLOAT4& plane : planes) {
+			__m256 dist = _mm256_add_ps(
+				_mm256_add_ps(_mm256_mul_ps(centerX, _mm256_set1_ps(plane.x)), _mm256_mul_ps(centerY, _mm256_set1_ps(plane.y))),
+				_mm256_add_ps(_mm256_mul_ps(centerZ, _mm256_set1_ps(plane.z)), _mm256_set1_ps(plane.w)));
+			__m256 radius = _mm256_add_ps(
+				_mm256_add_ps(_mm256_mul_ps(extentX, _mm256_set1_ps(std::abs(plane.x))), _mm256_mul_ps(extentY, _mm256_set1_ps(std::abs(plane.y)))),
+				_mm256_mul_ps(extentZ, _mm256_set1_ps(std::abs(plane.z))));
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(dist, radius, _CMP_GT_OQ));
+		}
+		return _mm256_movemask_ps(outside);
+#else
+		uint32_t mask = 0;
+		for (uint32_t lane = 0; lane < cellBatchSize; lane++) {
+			uint32_t i = batchStart + lane;
+			for (const XMFLOAT4& plane : planes) {
+				float dist = cellBounds.centerX[i] * plane.x + cellBounds.centerY[i] * plane.y + cellBounds.centerZ[i] * plane.z + plane.w;
+				float radius = cellBounds.extentX[i] * std::abs(plane.x) + cellBounds.extentY[i] * std::abs(plane.y) + cellBounds.extentZ[i] * std::abs(plane.z);
+				if (dist > radius) {
+					mask |= 1 << lane;
+					break;
+				}
+			}
+		}
+		return mask;
+#endif
 	}
 
-	template<bool FROM_PARENT>
-	void updateInsersectForBaseCells(
-		uint32_t start, uint32_t count,
-		const BoundingFrustum& cameraFrustumNormal,
-		const BoundingFrustum& cameraFrustumClose,
-		OPT_PARAM<FROM_PARENT, ContainmentType> parentIntersectNormal,
-		OPT_PARAM<FROM_PARENT, ContainmentType> parentIntersectClose)
+	void updateIntersectForBatch(uint32_t batchStart, uint32_t batchEnd, const FrustumPlanes& planesNormal, const FrustumPlanes& planesClose)
 	{
-		for (uint32_t i = start; i < (start + count); i++) {
-			auto& baseCell = grid.cells.base[i];
-			auto& close = cellsCamera.base[i].intersectsFrustumClose;
-			auto& normal = cellsCamera.base[i].intersectsFrustum;
-			if constexpr (FROM_PARENT) {
-				close = isBaseCellIntersectOrContain(baseCell, stats.intersects, cameraFrustumClose, parentIntersectClose);
-				normal = close || isBaseCellIntersectOrContain(baseCell, stats.intersects, cameraFrustumNormal, parentIntersectNormal);
+		// without layer cells, every base cell behaves as if its parent intersects
+		std::array<ContainmentType, cellBatchSize> parentNormal;
+		std::array<ContainmentType, cellBatchSize> parentClose;
+		parentNormal.fill(ContainmentType::INTERSECTS);
+		parentClose.fill(ContainmentType::INTERSECTS);
+
+		// only test planes if any cell of the batch actually needs it
+		uint32_t testCountNormal = 0;
+		uint32_t testCountClose = 0;
+		for (uint32_t i = batchStart, lane = 0; i < batchEnd; i++, lane++) {
+			if (grid.groupSize > 0) {
+				const auto& layerCellCamera = cellsCamera.layer[i / grid.groupSize];
+				parentNormal[lane] = layerCellCamera.intersectFrustumType;
+				parentClose[lane] = layerCellCamera.intersectFrustumCloseType;
 			}
-			else {
-				close = isBaseCellIntersectOrContain(baseCell, stats.intersects, cameraFrustumClose);
-				normal = close || isBaseCellIntersectOrContain(baseCell, stats.intersects, cameraFrustumNormal);
+			if (grid.cells.base[i].isInUse) {
+				testCountNormal += parentNormal[lane] == ContainmentType::INTERSECTS;
+				testCountClose += parentClose[lane] == ContainmentType::INTERSECTS;
+			}
+		}
+		uint32_t disjointNormal = testCountNormal > 0 ? getDisjointMask(batchStart, planesNormal) : 0;
+		uint32_t disjointClose = testCountClose > 0 ? getDisjointMask(batchStart, planesClose) : 0;
+		stats.intersects += testCountNormal + testCountClose;
+
+		for (uint32_t i = batchStart, lane = 0; i < batchEnd; i++, lane++) {
+			bool isInUse = grid.cells.base[i].isInUse;
+			auto isIntersect = [&](ContainmentType parent, uint32_t disjointMask) -> bool {
+				return isInUse && (parent == ContainmentType::CONTAINS
+					|| (parent == ContainmentType::INTERSECTS && !(disjointMask & (1 << lane))));
+			};
+			auto& cellCamera = cellsCamera.base[i];
+			cellCamera.intersectsFrustumClose = isIntersect(parentClose[lane], disjointClose);
+			cellCamera.intersectsFrustum = cellCamera.intersectsFrustumClose || isIntersect(parentNormal[lane], disjointNormal);
+		}
+	}
+
+	void updateDistancesForBatch(uint32_t batchStart, uint32_t batchEnd, Vec3 cameraOrigin)
+	{
+		// for chunk-based LOD, 2D distance ignores y since grid is 2D and also there are some misplaced benches deep underground
+		// in G1 (3500m under burg) that mess up chunk center
+		std::array<float, cellBatchSize> distanceCenter2dSq;
+		std::array<float, cellBatchSize> distanceCornerNearSq;
+		std::array<float, cellBatchSize> distanceCornerFarSq;
+#ifdef __AVX2__
+		const __m256 signMask = _mm256_set1_ps(-0.f);
+		__m256 toCenterX = _mm256_sub_ps(_mm256_set1_ps(cameraOrigin.x), _mm256_loadu_ps(&cellBounds.centerX[batchStart]));
+		__m256 toCenterY = _mm256_sub_ps(_mm256_set1_ps(cameraOrigin.y), _mm256_loadu_ps(&cellBounds.centerY[batchStart]));
+		__m256 toCenterZ = _mm256_sub_ps(_mm256_set1_ps(cameraOrigin.z), _mm256_loadu_ps(&cellBounds.centerZ[batchStart]));
+
+		// extents are positive, so copysign is just taking over the sign bit
+		__m256 extentX = _mm256_or_ps(_mm256_loadu_ps(&cellBounds.extentX[batchStart]), _mm256_and_ps(toCenterX, signMask));
+		__m256 extentY = _mm256_or_ps(_mm256_loadu_ps(&cellBounds.extentY[batchStart]), _mm256_and_ps(toCenterY, signMask));
+		__m256 extentZ = _mm256_or_ps(_mm256_loadu_ps(&cellBounds.extentZ[batchStart]), _mm256_and_ps(toCenterZ, signMask));
+
+		auto lengthSq8 = [](__m256 x, __m256 y, __m256 z) -> __m256 {
+			return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+		};
+		_mm256_storeu_ps(distanceCenter2dSq.data(), _mm256_add_ps(_mm256_mul_ps(toCenterX, toCenterX), _mm256_mul_ps(toCenterZ, toCenterZ)));
+		_mm256_storeu_ps(distanceCornerNearSq.data(), lengthSq8(
+			_mm256_sub_ps(toCenterX, extentX), _mm256_sub_ps(toCenterY, extentY), _mm256_sub_ps(toCenterZ, extentZ)));
+		_mm256_storeu_ps(distanceCornerFarSq.data(), lengthSq8(
+			_mm256_add_ps(toCenterX, extentX), _mm256_add_ps(toCenterY, extentY), _mm256_add_ps(toCenterZ, extentZ)));
+#else
+		for (uint32_t i = batchStart, lane = 0; i < batchEnd; i++, lane++) {
+			Vec3 toCenter = { cameraOrigin.x - cellBounds.centerX[i], cameraOrigin.y - cellBounds.centerY[i], cameraOrigin.z - cellBounds.centerZ[i] };
+			Vec3 extent = {
+				std::copysign(cellBounds.extentX[i], toCenter.x),
+				std::copysign(cellBounds.extentY[i], toCenter.y),
+				std::copysign(cellBounds.extentZ[i], toCenter.z)
+			};
+			Vec3 toNear = sub(toCenter, extent);
+			Vec3 toFar = add(toCenter, extent);
+			distanceCenter2dSq[lane] = toCenter.x * toCenter.x + toCenter.z * toCenter.z;
+			distanceCornerNearSq[lane] = toNear.x * toNear.x + toNear.y * toNear.y + toNear.z * toNear.z;
+			distanceCornerFarSq[lane] = toFar.x * toFar.x + toFar.y * toFar.y + toFar.z * toFar.z;
+		}
+#endif
+		for (uint32_t i = batchStart, lane = 0; i < batchEnd; i++, lane++) {
+			if (grid.cells.base[i].isInUse) {
+				auto& cellCamera = cellsCamera.base[i];
+				cellCamera.distanceCenter2dSq = distanceCenter2dSq[lane];
+				cellCamera.distanceCornerNearSq = distanceCornerNearSq[lane];
+				cellCamera.distanceCornerFarSq = distanceCornerFarSq[lane];
+
+				assert(cellCamera.distanceCornerFarSq >= cellCamera.distanceCornerNearSq);
 			}
 		}
 	}
@@ -148,99 +288,74 @@ namespace render::pass::world::chunkgrid
 		BoundingFrustum closeFrustum = cameraFrustum;
 		closeFrustum.Far = closeFrustum.Near + closeRadius;
 
-		if (updateCulling || updateCloseIntersect) {
-			// if we have a hierarchical grid (layer cells) propagate intersection info from each layer cell to its contained base cells
-			if (grid.groupSize > 0) {
-				for (uint32_t layerIndex = 0, baseIndex = 0; layerIndex < grid.cells.layer.size(); layerIndex++, baseIndex += grid.groupSize) {
-					auto& layerCell = grid.cells.layer[layerIndex];
-					auto& layerCellCamera = cellsCamera.layer[layerIndex];
-
-					if (layerCell.isInUse) {
-						ContainmentType& containmentNormal = layerCellCamera.intersectFrustumType;
-						ContainmentType& containmentClose = layerCellCamera.intersectFrustumCloseType;
-						if (updateCulling) {
-							containmentNormal = cameraFrustum.Contains(layerCell.bbox);
-							stats.intersects++;
-						}
-						if (updateCloseIntersect) {
-							containmentClose = closeFrustum.Contains(layerCell.bbox);
-							stats.intersects++;
-						}
-
-						uint32_t groupStart = layerIndex * grid.groupSize;
-						updateInsersectForBaseCells<true>(groupStart, grid.groupSize, cameraFrustum, closeFrustum, containmentNormal, containmentClose);
+		bool updateIntersect = updateCulling || updateCloseIntersect;
+		// distances must be available even if camera did not change since grid was initialized
+		updateDistances = updateDistances || !distancesInitialized;
+		distancesInitialized = true;
+
+		// if we have a hierarchical grid (layer cells), base cells get intersection info from the layer cell containing them
+		if (updateIntersect && grid.groupSize > 0) {
+			for (uint32_t layerIndex = 0; layerIndex < grid.cells.layer.size(); layerIndex++) {
+				auto& layerCell = grid.cells.layer[layerIndex];
+				auto& layerCellCamera = cellsCamera.layer[layerIndex];
+
+				if (layerCell.isInUse) {
+					if (updateCulling) {
+						layerCellCamera.intersectFrustumType = cameraFrustum.Contains(layerCell.bbox);
+						stats.intersects++;
+					}
+					if (updateCloseIntersect) {
+						layerCellCamera.intersectFrustumCloseType = closeFrustum.Contains(layerCell.bbox);
+						stats.intersects++;
 					}
 				}
 			}
-			// otherwise we just have updat base cells one by one
-			else {
-				updateInsersectForBaseCells<false>(0, grid.cellCount, cameraFrustum, closeFrustum, {}, {});
-			}
 		}
 
-		stats.intersectsTime.sample();
-		stats::takeSample(stats.intersectsSampler, stats.intersects);
-
-		// distance
-		Vec3 cameraOrigin = toVec3(cameraFrustum.Origin);
-		// for chunk-based LOD, we ignore y since grid is 2D and also there are some misplaced benches deep underground in G1 (3500m under burg that mess up chunk center
-		Vec2 cameraOrigin2d = { cameraFrustum.Origin.x, cameraFrustum.Origin.z };
-
-		for (uint32_t i = 0; i < grid.cellCount; i++) {
-			auto& cell = grid.cells.base[i];
-			if (cell.isInUse) {
-				auto& cellCamera = cellsCamera.base[i];
-
-				// 2D (center)
-				Vec2 bboxCenter2d = { cell.bbox.Center.x, cell.bbox.Center.z };
-				Vec2 toBboxCenter2d = sub(cameraOrigin2d, bboxCenter2d);
-				cellCamera.distanceCenter2dSq = lengthSq(toBboxCenter2d);
-
-				// 3D (near/far corners)
-				Vec3 bboxCenter = toVec3(cell.bbox.Center);
-				Vec3 bboxExtents = toVec3(cell.bbox.Extents);
-				Vec3 toBboxCenter = sub(cameraOrigin, bboxCenter);
+		if (updateIntersect || updateDistances) {
+			FrustumPlanes planesNormal = getPlanes(cameraFrustum);
+			FrustumPlanes planesClose = getPlanes(closeFrustum);
+			Vec3 cameraOrigin = toVec3(cameraFrustum.Origin);
 
-				Vec3 bboxExtentsDirected = {
-					std::copysign(bboxExtents.x, toBboxCenter.x),
-					std::copysign(bboxExtents.y, toBboxCenter.y),
-					std::copysign(bboxExtents.z, toBboxCenter.z)
-				};
-				Vec3 tobboxFarCorner = add(toBboxCenter, bboxExtentsDirected);
-				Vec3 tobboxNearCorner = add(toBboxCenter, mul(bboxExtentsDirected, -1));
-
-				cellCamera.distanceCornerNearSq = lengthSq(tobboxNearCorner);
-				cellCamera.distanceCornerFarSq = lengthSq(tobboxFarCorner);
-
-				assert(cellCamera.distanceCornerFarSq >= cellCamera.distanceCornerNearSq);
+			for (uint32_t batchStart = 0; batchStart < grid.cellCount; batchStart += cellBatchSize) {
+				uint32_t batchEnd = std::min(batchStart + cellBatchSize, grid.cellCount);
+				if (updateIntersect) {
+					updateIntersectForBatch(batchStart, batchEnd, planesNormal, planesClose);
+				}
+				if (updateDistances) {
+					updateDistancesForBatch(batchStart, batchEnd, cameraOrigin);
+				}
 			}
 		}
+
+		stats.intersectsTime.sample();
+		stats::takeSample(stats.intersectsSampler, stats.intersects);
 	}
 
 	GridIndex getIndex(const GridPos& index)
 	{
-		uint16_t innerIndex = grid::getIndex(index);
+		uint32_t innerIndex = grid::getIndex(index);
 		return {
-			.outerIndex = (uint16_t)(grid.groupSize > 0 ? (innerIndex / grid.groupSize) : 0),
+			.outerIndex = grid.groupSize > 0 ? (innerIndex / grid.groupSize) : 0,
 			.innerIndex = innerIndex
 		};
 	}
 
 	// TODO should all of the below stuff return const references?
 
-	LayerCellCameraInfo getCameraInfoOuter(uint16_t outerIndex)
+	LayerCellCameraInfo getCameraInfoOuter(uint32_t outerIndex)
 	{
 		assert(isInitialized);
 		return cellsCamera.layer[outerIndex];
 	}
 
-	CellCameraInfo getCameraInfoInner(uint16_t innerIndex)
+	CellCameraInfo getCameraInfoInner(uint32_t innerIndex)
 	{
 		assert(isInitialized);
 		return cellsCamera.base[innerIndex];
 	}
 
-	grid::CellInfo getCellInfoInner(uint16_t innerIndex)
+	grid::CellInfo getCellInfoInner(uint32_t innerIndex)
 	{
 		assert(isInitialized);
 		return grid.cells.base[innerIndex];
@@ -7,8 +7,8 @@
 namespace render::pass::world::chunkgrid
 {
 	struct GridIndex {
-		uint16_t outerIndex;
-		uint16_t innerIndex;
+		uint32_t outerIndex;
+		uint32_t innerIndex;
 	};
 
 	struct CellCameraInfo {
@@ -24,12 +24,12 @@ namespace render::pass::world::chunkgrid
 		DirectX::ContainmentType intersectFrustumCloseType = DirectX::ContainmentType::DISJOINT;
 	};
 
-	uint16_t init(const grid::Grid& grid);
+	uint32_t init(const grid::Grid& grid);
 	std::pair<GridPos, GridPos> getIndexMinMax();
 	void updateCamera(const DirectX::BoundingFrustum& cameraFrustum, bool updateCulling, bool updateCloseIntersect, float closeRadius, bool updateDistances);
 
 	GridIndex getIndex(const GridPos& index);
-	LayerCellCameraInfo getCameraInfoOuter(uint16_t outerIndex);
-	CellCameraInfo getCameraInfoInner(uint16_t innerIndex);
-	grid::CellInfo getCellInfoInner(uint16_t innerIndex);
+	LayerCellCameraInfo getCameraInfoOuter(uint32_t outerIndex);
+	CellCameraInfo getCameraInfoInner(uint32_t innerIndex);
+	grid::CellInfo getCellInfoInner(uint32_t innerIndex);
 }
\ No newline at end of file
@@ -7,17 +7,23 @@
 #include "render/d3d/GeometryBuffer.h"
 #include "render/d3d/StructuredBuffer.h"
 #include "render/PerfStats.h"
+#include "render/basic/MeshUtil.h"
 #include "render/Loader.h"
 #include "render/WinDx.h"
 
 #include "assets/AssetCache.h"
 #include "assets/AssetFinder.h"
 #include "assets/ZenLoader.h"
+#include "assets/MeshLoader.h"
 #include "assets/TexLoader.h"
 
 #include "Logger.h"
 #include "Util.h"
 
+#include <future>
+#include <mutex>
+#include <format>
+
 namespace render::pass::world
 {
 	using namespace render;
@@ -45,63 +51,374 @@ namespace render::pass::world
 
 	const TexIndex texturesPerBatch = 512;
 	const uint32_t vertCountPerBatch = (20 * 1024 * 1024) / sizeof(VertexBasic);// 20 MB divided by biggest buffer element size
+	const uint32_t vertCountPerShortIndexSegment = UINT16_MAX + 1;
 
 	World world;
 
 	// Texture Ownership
-	// BaseColor textures are owned by textureCache
+	// BaseColor textures are owned by texture arrays in world batches (CPU-side mip data is owned by textureCache)
 	// Lightmap textures are owned by world
 	//   - debugTextures -> single textures used by ImGUI
 	//   - lightmapTexArray -> array used by forward renderer
 
-	unordered_map<TexId, Texture*> textureCache;
+	// Texture Residency
+	// Bucketing only needs TexInfo, which is probed from file headers without decoding. Texture arrays are then created directly
+	// from CPU-side mip data, so no single GPU textures are created. Decoded mip data stays resident so that switching between
+	// levels of the same game does not need to decode shared textures again. Every loaded level holds one reference
+	// to each texture it uses. When over budget, data of unreferenced textures is evicted first, then data of textures only
+	// referenced by already uploaded levels, least recently used first.
+	// The preload thread never accesses the residency cache. It decodes textures that are not resident into its own result,
+	// which is merged into the cache on the main thread once the preloaded level is actually loaded.
+
+	const uint64_t textureCacheBudgetBytes = sizeof(void*) == 4 ? (128 * 1024 * 1024) : (1024 * 1024 * 1024);
+
+	struct ResidentTexture {
+		std::optional<TexInfo> info;
+		std::optional<assets::TexData> data;
+		uint64_t bytes = 0;
+		uint32_t levelRefCount = 0;
+		uint32_t lastUsedGeneration = 0;
+	};
+
+	unordered_map<TexId, ResidentTexture> textureCache;
+	unordered_map<string, std::unordered_set<TexId>> levelToTextures;
+	uint64_t textureCacheBytes = 0;
+	uint32_t textureCacheGeneration = 0;
+
+	// Level that textures are currently loaded for, only accessed from main thread.
+	string textureLevel;
+	string displayedLevel;
+
+	struct PreloadResult {
+		std::optional<RenderData> data;
+		unordered_map<TexId, assets::TexData> textures;
+	};
+
+	// Mesh loader state (decal cache, loader arena, load stats) is shared between all loads, so level data is only ever
+	// loaded by one thread at a time. Asset lookups and the parsed asset cache are thread-safe.
+	std::mutex levelDataMutex;
+
+	struct PreloadedLevel {
+		string level;
+		std::future<PreloadResult> result;
+	};
+	std::optional<PreloadedLevel> preloaded;
+
+	// Maximum error of compact vertex data compared to default vertex data, logged after uploading a level.
+	// Values outside of the range supported by the compact format are clamped and only counted.
+	struct CompactErrorStats {
+		float posMax = 0;
+		float normalAngleMaxDeg = 0;
+		float lightmapUvMax = 0;
+		float colorMax = 0;
+		uint32_t lightmapUvClamped = 0;
+		uint32_t colorClamped = 0;
+	};
+	CompactErrorStats compactErrorStats;
+
+	ResidentTexture& getResidentTexture(TexId texId)
+	{
+		auto& resident = textureCache[texId];
+		resident.lastUsedGeneration = textureCacheGeneration;
+
+		auto [_, wasReferenced] = levelToTextures[textureLevel].insert(texId);
+		if (wasReferenced) {
+			resident.levelRefCount++;
+		}
+		return resident;
+	}
+
+	TexInfo getOrProbeTexture(TexId texId, bool srgb)
+	{
+		auto& resident = getResidentTexture(texId);
+		if (!resident.info.has_value()) {
+			std::string texName(::assets::getTexName(texId));
+			resident.info = assets::probeTextureOrDefault(texName, srgb);
+		}
+		return resident.info.value();
+	}
+
+	void setResidentData(ResidentTexture& resident, TexId texId, assets::TexData&& texData)
+	{
+		if (resident.info.has_value() && resident.info.value() != texData.info) {
+			// only happens if file header does not match file content, decoded info is used from now on
+			LOG(ERROR) << "Level: Texture does not match probed info, texture will be regrouped: " << ::assets::getTexName(texId);
+		}
+		resident.info = texData.info;
+		resident.bytes = texData.bytes();
+		textureCacheBytes += resident.bytes;
+		resident.data = std::move(texData);
+	}
 
-	Texture* getOrCreateTexture(D3d d3d, TexId texId, bool srgb)
+	const assets::TexData& getOrLoadTexture(TexId texId, bool srgb)
 	{
-		return ::util::createOrGet<TexId, Texture*>(textureCache, texId, [&](Texture*& ref) {
+		auto& resident = getResidentTexture(texId);
+		if (!resident.data.has_value()) {
 			std::string texName(::assets::getTexName(texId));
-			ref = assets::createTextureOrDefault(d3d, texName, srgb);
-		});
+			setResidentData(resident, texId, assets::loadTextureDataOrDefault(texName, srgb));
+		}
+		return resident.data.value();
+	}
+
+	void waitForPreload()
+	{
+		if (preloaded.has_value()) {
+			preloaded->result.wait();
+		}
+	}
+
+	void mergePreloadedTextures(unordered_map<TexId, assets::TexData>&& textures)
+	{
+		for (auto& [texId, texData] : textures) {
+			auto& resident = getResidentTexture(texId);
+			if (!resident.data.has_value()) {
+				setResidentData(resident, texId, std::move(texData));
+			}
+		}
+	}
+
+	void releaseLevelTextures(const string& level)
+	{
+		auto it = levelToTextures.find(level);
+		if (it == levelToTextures.end()) {
+			return;
+		}
+		for (TexId texId : it->second) {
+			textureCache.at(texId).levelRefCount--;
+		}
+		levelToTextures.erase(it);
+	}
+
+	void evictTexturesOverBudget()
+	{
+		// if the whole process is over load memory budget, texture data is evicted until the excess has been freed
+		uint64_t loadMemoryExcess = assets::sampleLoadMemoryExcess();
+		uint64_t budgetBytes = std::min(textureCacheBudgetBytes, textureCacheBytes - std::min(textureCacheBytes, loadMemoryExcess));
+		if (textureCacheBytes <= budgetBytes) {
+			return;
+		}
+		vector<std::tuple<bool, uint32_t, TexId>> candidates;
+		for (const auto& [texId, resident] : textureCache) {
+			if (resident.data.has_value()) {
+				candidates.push_back({ resident.levelRefCount > 0, resident.lastUsedGeneration, texId });
+			}
+		}
+		std::sort(candidates.begin(), candidates.end());
+
+		uint32_t evicted = 0;
+		for (const auto& [isReferenced, generation, texId] : candidates) {
+			if (textureCacheBytes <= budgetBytes) {
+				break;
+			}
+			auto it = textureCache.find(texId);
+			textureCacheBytes -= it->second.bytes;
+			if (isReferenced) {
+				// probed info is still needed to release references correctly and is cheap to keep
+				it->second.data.reset();
+				it->second.bytes = 0;
+			}
+			else {
+				textureCache.erase(it);
+			}
+			evicted++;
+		}
+		LOG(DEBUG) << "Level: Evicted " << evicted << " textures, resident: "
+			<< (textureCacheBytes / (1024 * 1024)) << " MB";
 	}
 
 	void createTexArray(D3d d3d, ID3D11ShaderResourceView** targetSrv, const TexInfo& info, const vector<TexId>& texIds)
 	{
-		vector<ID3D11Texture2D*> sourceBuffers;
+		vector<vector<d3d::InitialData>> slicesMips;
+		slicesMips.reserve(texIds.size());
 		for (const auto texId : texIds) {
-			sourceBuffers.push_back(nullptr);
-			const Texture* tex = getOrCreateTexture(d3d, texId, info.srgb);
-			tex->GetResourceView()->GetResource((ID3D11Resource**)&sourceBuffers.back());
+			const auto& texData = getOrLoadTexture(texId, info.srgb);
+			if (texData.info != info) {
+				// textures that do not match their probed info are regrouped before batches are created
+				::util::throwError("Level: Texture does not match texture array info: " + std::string(::assets::getTexName(texId)));
+			}
+			slicesMips.push_back(texData.mips);
 		}
 
 		ID3D11Texture2D* texArrayBuf = nullptr;
-		d3d::createTexture2dArrayBufByCopy(d3d, &texArrayBuf, sourceBuffers, BufferUsage::WRITE_GPU);
+		d3d::createTexture2dArrayBuf(d3d, &texArrayBuf, info.getSize(), (DXGI_FORMAT) info.format, slicesMips);
 		d3d::createTexture2dArraySrv(d3d, targetSrv, texArrayBuf);
-
 		release(texArrayBuf);
-		for (auto& sourceBuffer : sourceBuffers) {
-			release(sourceBuffer);
+
+		// while over load budget, decoded textures are not kept until the level is complete (later batches of the same
+		// level might need to decode them again)
+		if (assets::isLoadMemoryOverBudget()) {
+			evictTexturesOverBudget();
+		}
+	}
+
+	bool isUnorm(float value)
+	{
+		return value >= 0.f && value <= 1.f;
+	}
+
+	float maxAbsDiff(Vec3 lhs, Vec3 rhs)
+	{
+		return std::max({ std::abs(lhs.x - rhs.x), std::abs(lhs.y - rhs.y), std::abs(lhs.z - rhs.z) });
+	}
+
+	ClusterBounds computeClusterBounds(std::span<const VertexPos> positions)
+	{
+		if (positions.empty()) {
+			return createClusterBounds(Vec3{ 0, 0, 0 }, Vec3{ 0, 0, 0 });
+		}
+		XMVECTOR posMin = toXM4Pos(positions.front());
+		XMVECTOR posMax = posMin;
+		for (const VertexPos& pos : positions) {
+			XMVECTOR posXm = toXM4Pos(pos);
+			posMin = XMVectorMin(posMin, posXm);
+			posMax = XMVectorMax(posMax, posXm);
+		}
+		return createClusterBounds(toVec3(posMin), toVec3(posMax));
+	}
+
+	template <VERTEX_FEATURE F>
+	void createVertexBufsCompact(D3d d3d, MeshBatch& batch, const VertsBatch<F>& batchData)
+	{
+		auto& stats = compactErrorStats;
+		uint32_t vertCount = batchData.vecPos.size();
+		uint32_t clusterCount = batchData.vertClusterVertStarts.size();
+		// batches are split by range count and loadZenLevel falls back to default format if a single cell has too many ranges
+		assert(clusterCount <= clusterCountMaxCompact);
+
+		vector<ClusterBounds> clusterBounds;
+		clusterBounds.reserve(clusterCount);
+		vector<VertexPosCompact> vecPos;
+		vector<VertexNorUvCompact> vecNormalUv;
+		vector<VertexLightCompact> vecOther;
+		vecPos.reserve(vertCount);
+		vecNormalUv.reserve(vertCount);
+		vecOther.reserve(vertCount);
+
+		for (uint32_t clusterIndex = 0; clusterIndex < clusterCount; clusterIndex++) {
+			uint32_t begin = batchData.vertClusterVertStarts[clusterIndex];
+			uint32_t end = clusterIndex + 1 < clusterCount ? batchData.vertClusterVertStarts[clusterIndex + 1] : vertCount;
+
+			// bounds are computed from actual verts, cell bboxes of objects are based on instance bboxes and may not contain all verts
+			const ClusterBounds& bounds = clusterBounds.emplace_back(
+				computeClusterBounds(std::span(batchData.vecPos.data() + begin, end - begin)));
+
+			for (uint32_t i = begin; i < end; i++) {
+				const VertexPos& pos = batchData.vecPos[i];
+				const auto& posCompact = vecPos.emplace_back(pos, bounds, clusterIndex);
+				stats.posMax = std::max(stats.posMax, maxAbsDiff(pos, posCompact.pos(bounds)));
+
+				const VertexNorUv& normalUv = batchData.vecNormalUv[i];
+				const auto& normalUvCompact = vecNormalUv.emplace_back(normalUv.normal(), normalUv.uvDiffuse());
+				XMVECTOR cosAngle = XMVector3Dot(toXM4Dir(normalUv.normal()), toXM4Dir(normalUvCompact.normal()));
+				float angleDeg = XMConvertToDegrees(std::acos(std::clamp(XMVectorGetX(cosAngle), -1.f, 1.f)));
+				stats.normalAngleMaxDeg = std::max(stats.normalAngleMaxDeg, angleDeg);
+
+				// packed default format does not store unused values, so they are reset to what the constructor expects
+				const F& light = batchData.vecOther[i];
+				VertexLightType type = light.type();
+				bool isLightmap = type == VertexLightType::WORLD_LIGHTMAP;
+				Uvi uviLightmap = isLightmap ? light.uviLightmap() : Uvi{ 0.f, 0.f, -1.f };
+				uint32_t instanceId = type == VertexLightType::OBJECT_COLOR ? light.instanceId() : instanceIdNone;
+				Color colLight = light.colLight();
+				const auto& lightCompact = vecOther.emplace_back(type, colLight, uviLightmap, instanceId);
+
+				if (isLightmap) {
+					if (isUnorm(uviLightmap.u) && isUnorm(uviLightmap.v)) {
+						Uvi uviCompact = lightCompact.uviLightmap();
+						float error = std::max(std::abs(uviLightmap.u - uviCompact.u), std::abs(uviLightmap.v - uviCompact.v));
+						stats.lightmapUvMax = std::max(stats.lightmapUvMax, error);
+					}
+					else {
+						stats.lightmapUvClamped++;
+					}
+				}
+				else if (type != VertexLightType::OBJECT_COLOR) {
+					if (isUnorm(colLight.r) && isUnorm(colLight.g) && isUnorm(colLight.b)) {
+						Color colCompact = lightCompact.colLight();
+						float error = maxAbsDiff({ colLight.r, colLight.g, colLight.b }, { colCompact.r, colCompact.g, colCompact.b });
+						stats.colorMax = std::max(stats.colorMax, error);
+					}
+					else {
+						stats.colorClamped++;
+					}
+				}
+			}
+		}
+
+		batch.vbPos.stride = sizeof(VertexPosCompact);
+		batch.vbNormalUv.stride = sizeof(VertexNorUvCompact);
+		batch.vbOther.stride = sizeof(VertexLightCompact);
+		d3d::createVertexBuf(d3d, batch.vbPos, vecPos);
+		d3d::createVertexBuf(d3d, batch.vbNormalUv, vecNormalUv);
+		d3d::createVertexBuf(d3d, batch.vbOther, vecOther);
+
+		ID3D11Buffer* clusterBoundsBuf = nullptr;
+		d3d::createStructuredBuf(d3d, &clusterBoundsBuf, clusterBounds, BufferUsage::IMMUTABLE);
+		d3d::createStructuredSrv(d3d, &batch.clusterBoundsSb, clusterBoundsBuf);
+		release(clusterBoundsBuf);
+	}
+
+	// most buckets only contain verts of a single range, so vertex shader can mostly skip searching the ranges
+	vector<uint32_t> createTexIndexBuckets(const vector<TexIndexRange>& ranges, uint32_t vertCount)
+	{
+		uint32_t bucketCount = (vertCount + texIndexBucketVertCount - 1) / texIndexBucketVertCount;
+		vector<uint32_t> result;
+		result.reserve(bucketCount);
+		uint32_t rangeIndex = 0;
+		for (uint32_t bucket = 0; bucket < bucketCount; bucket++) {
+			uint32_t vertStart = bucket * texIndexBucketVertCount;
+			while (rangeIndex + 1 < ranges.size() && ranges[rangeIndex + 1].vertStart <= vertStart) {
+				rangeIndex++;
+			}
+			bool isUniform = rangeIndex + 1 == ranges.size() || ranges[rangeIndex + 1].vertStart >= vertStart + texIndexBucketVertCount;
+			assert(ranges[rangeIndex].texIndex < texIndexBucketUniform);
+			result.push_back(isUniform ? (ranges[rangeIndex].texIndex | texIndexBucketUniform) : rangeIndex);
 		}
+		return result;
 	}
 
 	template <VERTEX_FEATURE F>
-	void loadRenderBatch(D3d d3d, vector<MeshBatch>& target, TexInfo batchInfo, const VertsBatch<F>& batchData)
+	void loadRenderBatch(D3d d3d, vector<MeshBatch>& target, TexInfo batchInfo, VertsBatch<F>& batchData, VertexFormat vertexFormat)
 	{
 		MeshBatch batch;
 		batch.vertClusters = std::move(batchData.vertClusters);
 		batch.vertClustersLod = std::move(batchData.vertClustersLod);
-		batch.useIndices = !batchData.vecIndex.empty();
+		bool useShortIndices = !batchData.vecIndexShort.empty();
+		batch.useIndices = useShortIndices || !batchData.vecIndex.empty();
 		if (batch.useIndices) {
+			uint32_t indexCount = useShortIndices ? batchData.vecIndexShort.size() : batchData.vecIndex.size();
 			batch.drawCount = batchData.lodStart;
-			batch.drawLodCount = batchData.vecIndex.size() - batchData.lodStart;
-			d3d::createIndexBuf(d3d, batch.vbIndices, batchData.vecIndex);
+			batch.drawLodCount = indexCount - batchData.lodStart;
+			if (useShortIndices) {
+				batch.vbIndices.stride = sizeof(VertexIndexShort);
+				d3d::createIndexBuf(d3d, batch.vbIndices, batchData.vecIndexShort);
+			}
+			else {
+				d3d::createIndexBuf(d3d, batch.vbIndices, batchData.vecIndex);
+			}
 		}
 		else {
 			batch.drawCount = batchData.vecPos.size();
 		}
-		d3d::createVertexBuf(d3d, batch.vbPos, batchData.vecPos);
-		d3d::createVertexBuf(d3d, batch.vbNormalUv, batchData.vecNormalUv);
-		d3d::createVertexBuf(d3d, batch.vbOther, batchData.vecOther);
-		d3d::createVertexBuf(d3d, batch.vbTexIndices, batchData.texIndices);
+		if (vertexFormat == VertexFormat::COMPACT) {
+			createVertexBufsCompact(d3d, batch, batchData);
+		}
+		else {
+			d3d::createVertexBuf(d3d, batch.vbPos, batchData.vecPos);
+			d3d::createVertexBuf(d3d, batch.vbNormalUv, batchData.vecNormalUv);
+			d3d::createVertexBuf(d3d, batch.vbOther, batchData.vecOther);
+		}
+
+		ID3D11Buffer* texIndicesBuf = nullptr;
+		d3d::createStructuredBuf(d3d, &texIndicesBuf, batchData.texIndexRanges, BufferUsage::IMMUTABLE);
+		d3d::createStructuredSrv(d3d, &batch.texIndicesSb, texIndicesBuf);
+		release(texIndicesBuf);
+
+		ID3D11Buffer* texIndexBucketsBuf = nullptr;
+		d3d::createStructuredBuf(d3d, &texIndexBucketsBuf, createTexIndexBuckets(batchData.texIndexRanges, batchData.vecPos.size()), BufferUsage::IMMUTABLE);
+		d3d::createStructuredSrv(d3d, &batch.texIndexBucketsSb, texIndexBucketsBuf);
+		release(texIndexBucketsBuf);
+
 		createTexArray(d3d, &batch.texColorArray, batchInfo, batchData.texIndexedIds);
 		target.push_back(batch);
 
@@ -112,29 +429,48 @@ namespace render::pass::world
 		}
 	}
 
-	template <typename VERT_DATA>
-	vector<pair<TexInfo, vector<pair<Material, const VERT_DATA *>>>> groupByTexId(D3d d3d, const unordered_map<Material, const VERT_DATA *>& meshData, TexIndex maxTexturesPerBatch)
+	// decodes textures of given materials, materials whose texture does not match texInfo are appended to mismatched
+	template <VERTEX_FEATURE F>
+	vector<MatId> filterByDecodedTexInfo(const MeshData<F>& meshData, TexInfo texInfo, const vector<MatId>& matIds, vector<MatId>& mismatched)
+	{
+		vector<MatId> result;
+		result.reserve(matIds.size());
+		for (MatId matId : matIds) {
+			const Material& mat = meshData.materials[matId];
+			const auto& texData = getOrLoadTexture(mat.texBaseColor, mat.colorSpace == ColorSpace::SRGB);
+			if (texData.info == texInfo) {
+				result.push_back(matId);
+			}
+			else {
+				mismatched.push_back(matId);
+			}
+		}
+		return result;
+	}
+
+	template <VERTEX_FEATURE F>
+	vector<pair<TexInfo, vector<MatId>>> groupByTexId(const MeshData<F>& meshData, const vector<MatId>& matIds, TexIndex maxTexturesPerBatch)
 	{
 		// load and bucket all materials so textures that are texture-array-compatible are grouped in a single bucket
-		unordered_map<TexInfo, vector<Material>> texBuckets;
-		for (const auto& [mat, data] : meshData) {
+		unordered_map<TexInfo, vector<MatId>> texBuckets;
+		for (MatId matId : matIds) {
+			const Material& mat = meshData.materials[matId];
 			bool srgb = mat.colorSpace == ColorSpace::SRGB;
-			Texture* texture = getOrCreateTexture(d3d, mat.texBaseColor, srgb);
-			auto& vec = ::util::getOrCreateDefault(texBuckets, texture->getInfo());
-			vec.push_back(mat);
+			TexInfo info = getOrProbeTexture(mat.texBaseColor, srgb);
+			auto& vec = ::util::getOrCreateDefault(texBuckets, info);
+			vec.push_back(matId);
 		}
 
-		vector<pair<TexInfo, vector<pair<Material, const VERT_DATA *>>>> result;
+		vector<pair<TexInfo, vector<MatId>>> result;
 
 		// create batches
 		for (const auto& [texInfo, textures] : texBuckets) {
 
-			pair<TexInfo, vector<pair<Material, const VERT_DATA *>>> batch = { texInfo, {} };
+			pair<TexInfo, vector<MatId>> batch = { texInfo, {} };
 			TexIndex currentIndex = 0;
 
-			for (const auto mat : textures) {
-				const VERT_DATA* currentMatData = meshData.find(mat)->second;
-				batch.second.push_back(pair{ mat, currentMatData });
+			for (const MatId matId : textures) {
+				batch.second.push_back(matId);
 
 				// create and start new batch because we reached max texture size per batch
 				if (currentIndex + 1 >= maxTexturesPerBatch) {
@@ -158,168 +494,247 @@ namespace render::pass::world
 		return result;
 	}
 
-	template <VERTEX_FEATURE F>
-	bool compareByGridPos(pair<GridPos, vector<pair<Material, Verts<F>>>> const& lhs, pair<GridPos, vector<pair<Material, Verts<F>>>> const& rhs) {
-		const GridPos& lhsIndex = lhs.first;
-		const GridPos& rhsIndex = rhs.first;
-		if (lhsIndex.y == rhsIndex.y) {
-			return lhsIndex.x < rhsIndex.x;
-		}
-		return lhsIndex.y < rhsIndex.y;
-	}
+	// All ranges of a batch that are located in the same grid cell, [begin, end) indexes into SortedRanges::rangeIds.
+	struct CellRanges {
+		GridPos gridPos;
+		uint32_t begin = 0;
+		uint32_t end = 0;
+		uint32_t vertCount = 0;
+	};
 
+	struct SortedRanges {
+		vector<RangeId> rangeIds;
+		vector<CellRanges> cells;
+	};
+
+	// Indexed ranges with more verts than a 16-bit index segment can address are split from all other ranges, so that
+	// only batches containing such ranges need 32-bit indices.
 	template <VERTEX_FEATURE F>
-	vector<pair<GridPos, vector<pair<Material, Verts<F>>>>> groupAndSortByGridCell(const vector<pair<Material, const ChunkToVerts<F> *>>& batchData)
+	array<vector<RangeId>, 2> splitByIndexSize(const MeshData<F>& meshData, const vector<MatId>& batchData)
 	{
-		// use unordered_map to group
-		unordered_map<GridPos, vector<pair<Material, Verts<F>>>> chunkBuckets;
-
-		for (const auto& [mat, chunkData] : batchData) {
-			for (const auto& [gridPos, chunkVerts] : *chunkData) {
-
-				auto& vec = ::util::getOrCreateDefault(chunkBuckets, gridPos);
-				vec.push_back({ mat, chunkVerts });
+		array<vector<RangeId>, 2> result;// short indices, long indices
+		for (const MatId matId : batchData) {
+			auto [begin, end] = meshData.materialRanges[matId];
+			for (RangeId rangeId = begin; rangeId < end; rangeId++) {
+				const VertRange& range = meshData.ranges[rangeId];
+				bool needsLongIndices = range.useIndices && range.vertCount > vertCountPerShortIndexSegment;
+				result[needsLongIndices ? 1 : 0].push_back(rangeId);
 			}
 		}
+		return result;
+	}
 
-		// convert unordered_map to vector for sorting
-		vector<pair<GridPos, vector<pair<Material, Verts<F>>>>> result;
-		result.reserve(chunkBuckets.size());
-
-		for (const auto& [gridPos, chunkData] : chunkBuckets) {
-			result.push_back({gridPos, chunkData});
-		}
+	template <VERTEX_FEATURE F>
+	SortedRanges groupAndSortByGridCell(const MeshData<F>& meshData, vector<RangeId>&& rangeIds)
+	{
+		SortedRanges result;
+		result.rangeIds = std::move(rangeIds);
 
 		// ideally we would maybe sort by morton code or something like that (implement "uint32_t getMortonIndex(ChunkIndex)" in ChunkGrid or similar)
 		// for now we just sort by y then x which already reduces number of draw calls significantly (due to vert range merging of continuous active grid cells)
-		std::sort(result.begin(), result.end(), &compareByGridPos<F>);
+		auto getCellOrder = [&](RangeId rangeId) -> pair<uint16_t, uint16_t> {
+			GridPos gridPos = meshData.getGridPos(meshData.ranges[rangeId]);
+			return { gridPos.y, gridPos.x };
+		};
+		std::stable_sort(result.rangeIds.begin(), result.rangeIds.end(), [&](RangeId lhs, RangeId rhs) -> bool {
+			return getCellOrder(lhs) < getCellOrder(rhs);
+		});
 
+		// ranges are only referenced by ID, vertex data is not touched until it is written into the final batch
+		for (uint32_t i = 0; i < result.rangeIds.size(); i++) {
+			const VertRange& range = meshData.ranges[result.rangeIds[i]];
+			GridPos gridPos = meshData.getGridPos(range);
+			if (result.cells.empty() || result.cells.back().gridPos != gridPos) {
+				result.cells.push_back({ gridPos, i, i, 0 });
+			}
+			auto& cell = result.cells.back();
+			cell.end = i + 1;
+			cell.vertCount += range.vertCount;
+		}
 		return result;
 	}
 
+	// cells are never split into multiple batches, so batches cannot be split below this many ranges
 	template <VERTEX_FEATURE F>
-	vector<pair<uint32_t, vector<pair<GridPos, vector<pair<Material, Verts<F>>>>>>> splitByVertCount(
-		const vector<pair<GridPos, vector<pair<Material, Verts<F>>>>>& batchData, uint32_t maxVertCount)
+	uint32_t getMaxRangeCountPerCell(const MeshData<F>& meshData)
 	{
-		vector<pair<uint32_t, vector<pair<GridPos, vector<pair<Material, Verts<F>>>>>>> result;
+		vector<uint32_t> rangeCounts(meshData.cells.size(), 0);
+		for (const VertRange& range : meshData.ranges) {
+			rangeCounts[range.cellId]++;
+		}
+		return rangeCounts.empty() ? 0 : *std::max_element(rangeCounts.begin(), rangeCounts.end());
+	}
 
-		vector<pair<GridPos, vector<pair<Material, Verts<F>>>>> currentBatch;
-		uint32_t currentBatchVertCount = 0;
+	// every range starts at most one vertex cluster, so limiting ranges per batch also limits clusters per batch
+	vector<std::span<const CellRanges>> splitByVertCount(const vector<CellRanges>& cells, uint32_t maxVertCount, uint32_t maxRangeCount)
+	{
+		vector<std::span<const CellRanges>> result;
 
-		for (const auto& [gridPos, vertDataByMat] : batchData) {
+		uint32_t currentBatchStart = 0;
+		uint32_t currentBatchVertCount = 0;
+		uint32_t currentBatchRangeCount = 0;
 
-			uint32_t chunkVertCount = 0;
-			for (const auto& [material, vertData] : vertDataByMat) {
-				chunkVertCount += vertData.vecPos.size();
-			}
+		for (uint32_t i = 0; i < cells.size(); i++) {
+			uint32_t chunkVertCount = cells[i].vertCount;
+			uint32_t chunkRangeCount = cells[i].end - cells[i].begin;
 
 			// we never split a single chunk, so if the first chunk of a batch has more than maxVertCount verts we accept that
-			if (currentBatchVertCount != 0 && (currentBatchVertCount + chunkVertCount) > maxVertCount) {
-				result.push_back({ currentBatchVertCount, currentBatch });
-				currentBatch.clear();
+			if (currentBatchVertCount != 0 && ((currentBatchVertCount + chunkVertCount) > maxVertCount
+					|| (currentBatchRangeCount + chunkRangeCount) > maxRangeCount)) {
+				result.push_back({ cells.data() + currentBatchStart, i - currentBatchStart });
+				currentBatchStart = i;
 				currentBatchVertCount = 0;
+				currentBatchRangeCount = 0;
 			}
-			currentBatch.push_back({ gridPos, vertDataByMat });
 			currentBatchVertCount += chunkVertCount;
+			currentBatchRangeCount += chunkRangeCount;
 		}
 
 		if (currentBatchVertCount != 0) {
-			result.push_back({ currentBatchVertCount, currentBatch });
+			result.push_back({ cells.data() + currentBatchStart, cells.size() - currentBatchStart });
 		}
 
 		return result;
 	}
 
 	template <VERTEX_FEATURE F>
-	pair<VertsBatch<F>, LoadResult> flattenIntoBatch(const vector<pair<GridPos, vector<pair<Material, Verts<F>>>>>& batchData)
+	pair<VertsBatch<F>, LoadResult> flattenIntoBatch(
+		const MeshData<F>& meshData, const vector<RangeId>& rangeIds, std::span<const CellRanges> batchData)
 	{
 		LoadResult result;
 		result.states = 1;
 		VertsBatch<F> target;
 
-		uint32_t clusterCount = batchData.size();
-		result.draws = clusterCount;
-		target.vertClusters.reserve(clusterCount);
-
-		vector<VertexIndex> lodIndices;
-		unordered_map<Material, TexIndex> materialIndices;
-		vector<Material> materials;
-
-		// reserve to avoid over-allocation (because the resulting vert vectors are going to be very big)
-		bool useIndices = !batchData.empty() && batchData.at(0).second.at(0).second.useIndices;
+		// reserve exact sizes, so that every vertex and index is written exactly once into the buffers that are uploaded
+		bool useIndices = !batchData.empty() && meshData.ranges[rangeIds[batchData.front().begin]].useIndices;
 		uint32_t indexCount = 0;
 		uint32_t indexLodCount = 0;
 		uint32_t vertCount = 0;
-		for (const auto& [chunkIndex, vertDataByMat] : batchData) {
-			for (const auto& [material, vertData] : vertDataByMat) {
-				indexCount += vertData.vecIndex.size();
-				indexLodCount += vertData.vecIndexLod.size();
-				vertCount += vertData.vecPos.size();
+		bool useShortIndices = useIndices;
+		for (const CellRanges& cell : batchData) {
+			for (uint32_t i = cell.begin; i < cell.end; i++) {
+				const VertRange& range = meshData.ranges[rangeIds[i]];
+				indexCount += range.indexCount;
+				indexLodCount += range.indexLodCount;
+				useShortIndices = useShortIndices && range.vertCount <= vertCountPerShortIndexSegment;// see splitByIndexSize
 			}
+			vertCount += cell.vertCount;
+		}
+		if (useShortIndices) {
+			target.vecIndexShort.reserve(indexCount + indexLodCount);
+		}
+		else {
+			target.vecIndex.reserve(indexCount + indexLodCount);
 		}
-		target.vecIndex.reserve(indexCount + indexLodCount);
 		target.lodStart = indexCount;
-		lodIndices.reserve(indexLodCount);
 
 		target.vecPos.reserve(vertCount);
 		target.vecNormalUv.reserve(vertCount);
 		target.vecOther.reserve(vertCount);
-		target.texIndices.reserve(vertCount);
 
 		result.verts = useIndices ? indexCount : vertCount;
 		result.vertsLod = useIndices ? indexLodCount : vertCount;
 
-		for (const auto& [gridPos, vertDataByMat] : batchData) {
-			// set vertex data
-			uint32_t currentVertIndex = useIndices ? target.vecIndex.size() : target.vecPos.size();
-			uint32_t currentVertIndexLod = useIndices ? lodIndices.size() : 0;
-			target.vertClusters.push_back({ gridPos, currentVertIndex });
-			target.vertClustersLod.push_back({ gridPos, indexCount + currentVertIndexLod });
+		auto writtenIndexCount = [&]() -> uint32_t {
+			return useShortIndices ? target.vecIndexShort.size() : target.vecIndex.size();
+		};
+		auto writeIndices = [&](std::span<const VertexIndex> indices, uint32_t offset) -> void {
+			if (useShortIndices) {
+				for (VertexIndex index : indices) {
+					target.vecIndexShort.push_back((VertexIndexShort) (offset + index));
+				}
+			}
+			else {
+				for (VertexIndex index : indices) {
+					target.vecIndex.push_back(offset + index);
+				}
+			}
+		};
 
-			for (const auto& [material, vertData] : vertDataByMat) {
-				// rewrite indices
+		unordered_map<MatId, TexIndex> materialIndices;
+		uint32_t rangeCount = batchData.empty() ? 0 : batchData.back().end - batchData.front().begin;
+		vector<uint32_t> rangeVertStarts;// batch-relative, needed for rewriting LOD indices
+		vector<bool> rangeStartsCluster;// needed for splitting LOD clusters exactly like normal clusters
+		rangeVertStarts.reserve(rangeCount);
+		rangeStartsCluster.reserve(rangeCount);
+		target.texIndexRanges.reserve(rangeCount);
+		target.vertClusters.reserve(batchData.size());
+		target.vertClusterVertStarts.reserve(batchData.size());
+
+		// With short indices, indices are relative to the base vertex of a segment of consecutive ranges. If the next range
+		// does not fit into the current segment, a new segment and cluster is started, so merged draws never cross segments.
+		uint32_t baseVertex = 0;
+
+		for (const CellRanges& cell : batchData) {
+			bool isCellStart = true;
+
+			for (uint32_t i = cell.begin; i < cell.end; i++) {
+				const VertRange& range = meshData.ranges[rangeIds[i]];
 				uint32_t currentVertCount = target.vecPos.size();
-				for (VertexIndex index : vertData.vecIndex) {
-					target.vecIndex.push_back(currentVertCount + index);
+
+				bool isSegmentStart = useShortIndices
+					&& (currentVertCount + range.vertCount - baseVertex) > vertCountPerShortIndexSegment;
+				if (isSegmentStart) {
+					baseVertex = currentVertCount;
 				}
-				// rewrite LOD indices
-				for (VertexIndex index : vertData.vecIndexLod) {
-					lodIndices.push_back(currentVertCount + index);
+				if (isCellStart || isSegmentStart) {
+					uint32_t currentVertIndex = useIndices ? writtenIndexCount() : currentVertCount;
+					target.vertClusters.push_back({ cell.gridPos, currentVertIndex, baseVertex });
+					target.vertClusterVertStarts.push_back(currentVertCount);
 				}
+				rangeStartsCluster.push_back(isCellStart || isSegmentStart);
+				rangeVertStarts.push_back(currentVertCount - baseVertex);
+				isCellStart = false;
+
+				// rewrite indices
+				writeIndices(meshData.getIndices(range), currentVertCount - baseVertex);
 
 				// copy vertex data
-				::util::insert(target.vecPos, vertData.vecPos);
-				::util::insert(target.vecNormalUv, vertData.vecNormalUv);
-				::util::insert(target.vecOther, vertData.vecOther);
+				auto pos = meshData.getPos(range);
+				auto normalUv = meshData.getNormalUv(range);
+				auto other = meshData.getOther(range);
+				target.vecPos.insert(target.vecPos.end(), pos.begin(), pos.end());
+				target.vecNormalUv.insert(target.vecNormalUv.end(), normalUv.begin(), normalUv.end());
+				target.vecOther.insert(target.vecOther.end(), other.begin(), other.end());
 
 				// set batch-dependent vertex data
-				TexIndex texIndex = ::util::getOrCreate<Material, TexIndex>(materialIndices, material, [&]() -> TexIndex {
-					materials.push_back(material);
-					return (TexIndex) materials.size() - 1;
+				TexIndex texIndex = ::util::getOrCreate<MatId, TexIndex>(materialIndices, range.matId, [&]() -> TexIndex {
+					target.texIndexedIds.push_back(meshData.getMaterial(range).texBaseColor);
+					return (TexIndex) target.texIndexedIds.size() - 1;
 				});
-				target.texIndices.insert(target.texIndices.end(), vertData.vecPos.size(), texIndex);
+				if (target.texIndexRanges.empty() || target.texIndexRanges.back().texIndex != texIndex) {
+					target.texIndexRanges.push_back({ currentVertCount, texIndex });
+				}
 			}
 		}
-		// append LOD indices to indices
-		if (useIndices) {
-			util::insert(target.vecIndex, lodIndices);
-		}
-
-		for (const Material& material : materials) {
-			target.texIndexedIds.push_back(material.texBaseColor);
+		result.draws = target.vertClusters.size();
+
+		// all LOD indices are written after normal indices
+		target.vertClustersLod.reserve(target.vertClusters.size());
+		uint32_t rangeIndex = 0;
+		uint32_t clusterIndex = 0;
+		for (const CellRanges& cell : batchData) {
+			for (uint32_t i = cell.begin; i < cell.end; i++, rangeIndex++) {
+				if (rangeStartsCluster[rangeIndex]) {
+					const ChunkVertCluster& cluster = target.vertClusters[clusterIndex++];
+					uint32_t currentVertIndexLod = useIndices ? writtenIndexCount() - indexCount : 0;
+					target.vertClustersLod.push_back({ cluster.gridPos, indexCount + currentVertIndexLod, cluster.baseVertex });
+				}
+				const VertRange& range = meshData.ranges[rangeIds[i]];
+				writeIndices(meshData.getIndicesLod(range), rangeVertStarts[rangeIndex]);
+			}
 		}
 
-		return { target, result };
+		return { std::move(target), result };
 	}
 
-	template <typename VERT_DATA>
-	array<unordered_map<Material, const VERT_DATA *>, BLEND_TYPE_COUNT> splitByPass(const std::unordered_map<Material, VERT_DATA>& meshData)
+	template <VERTEX_FEATURE F>
+	array<vector<MatId>, BLEND_TYPE_COUNT> splitByPass(const MeshData<F>& meshData)
 	{
-		array<unordered_map<Material, const VERT_DATA *>, BLEND_TYPE_COUNT> result;
-		for (auto& [material, vertData] : meshData) {
-			uint8_t blendTypeIndex = (uint8_t)material.blendType;
-			auto& passData = result.at(blendTypeIndex);
-			passData.insert({ material, &vertData });
+		array<vector<MatId>, BLEND_TYPE_COUNT> result;
+		for (MatId matId = 0; matId < meshData.materials.size(); matId++) {
+			uint8_t blendTypeIndex = (uint8_t)meshData.materials[matId].blendType;
+			result.at(blendTypeIndex).push_back(matId);
 		}
 		return result;
 	}
@@ -335,34 +750,49 @@ namespace render::pass::world
 
 	template <VERTEX_FEATURE F>
 	LoadResult loadBatchVertexData(
-		D3d d3d, MeshBatches& targetAllPasses, const MatToChunksToVerts<F>& meshDataAllPasses, TexIndex maxTexturesPerBatch)
+		D3d d3d, MeshBatches& targetAllPasses, const MeshData<F>& meshDataAllPasses, TexIndex maxTexturesPerBatch, VertexFormat vertexFormat)
 	{
 		LoadResult result;
-		array<unordered_map<Material, const ChunkToVerts<F>* >, BLEND_TYPE_COUNT> perPassMeshData = splitByPass(meshDataAllPasses);
+		array<vector<MatId>, BLEND_TYPE_COUNT> perPassMeshData = splitByPass(meshDataAllPasses);
 
 		for (uint16_t passIndex = 0; passIndex < BLEND_TYPE_COUNT; passIndex++) {
 			const auto& meshData = perPassMeshData.at(passIndex);
 			auto& target = targetAllPasses.passes.at(passIndex);
 
 			
-			vector<pair<TexInfo, vector<pair<Material, const ChunkToVerts<F>*>>>> batchedMeshData = groupByTexId(d3d, meshData, maxTexturesPerBatch);
-			
-			for (const auto& [texInfo, batchData] : batchedMeshData) {
-				
-				vector<pair<GridPos, vector<pair<Material, Verts<F>>>>> batchDataByGridCell = groupAndSortByGridCell(batchData);
-				
-				// split current batch into multiple smaller batches along chunk boundaries if it contains too many verts to prevent OOM crashes
-				vector<pair<uint32_t, vector<pair<GridPos, vector<pair<Material, Verts<F>>>>>>> batchDataSplit =
-					splitByVertCount(batchDataByGridCell, vertCountPerBatch);
+			// Textures are decoded right before their batch is created. Textures whose content does not match their probed
+			// header info are left out and grouped again by their decoded info after all other batches have been created.
+			vector<MatId> regroupMatIds;
+			vector<pair<TexInfo, vector<MatId>>> batchedMeshData = groupByTexId(meshDataAllPasses, meshData, maxTexturesPerBatch);
+			for (size_t batchIndex = 0; batchIndex < batchedMeshData.size(); batchIndex++) {
+				const TexInfo texInfo = batchedMeshData[batchIndex].first;
+				vector<MatId> batchData = filterByDecodedTexInfo(meshDataAllPasses, texInfo, batchedMeshData[batchIndex].second, regroupMatIds);
+				if (batchIndex + 1 == batchedMeshData.size() && !regroupMatIds.empty()) {
+					auto regrouped = groupByTexId(meshDataAllPasses, regroupMatIds, maxTexturesPerBatch);
+					batchedMeshData.insert(batchedMeshData.end(), regrouped.begin(), regrouped.end());
+					regroupMatIds.clear();
+				}
+				if (batchData.empty()) {
+					continue;
+				}
 				
-				batchDataByGridCell.clear();// lots of memory that are no longer needed
-
-				for (const auto& [vertCount, batchData] : batchDataSplit) {
-					const auto [batchDataFlat, batchLoadResult] = flattenIntoBatch(batchData);
-					
-					//assert(vertCount == batchLoadResult.verts);
-					result += batchLoadResult;
-					loadRenderBatch(d3d, target, texInfo, batchDataFlat);
+				for (auto& rangeIds : splitByIndexSize(meshDataAllPasses, batchData)) {
+					if (rangeIds.empty()) {
+						continue;
+					}
+					SortedRanges batchDataByGridCell = groupAndSortByGridCell(meshDataAllPasses, std::move(rangeIds));
+
+					// split current batch into multiple smaller batches along chunk boundaries if it contains too many verts to prevent OOM crashes
+					uint32_t maxRangeCount = vertexFormat == VertexFormat::COMPACT ? clusterCountMaxCompact : UINT32_MAX;
+					vector<std::span<const CellRanges>> batchDataSplit = splitByVertCount(batchDataByGridCell.cells, vertCountPerBatch, maxRangeCount);
+
+					for (const auto& batchCells : batchDataSplit) {
+						auto [batchDataFlat, batchLoadResult] = flattenIntoBatch(meshDataAllPasses, batchDataByGridCell.rangeIds, batchCells);
+
+						result += batchLoadResult;
+						loadRenderBatch(d3d, target, texInfo, batchDataFlat, vertexFormat);
+						assets::sampleLoadMemory();// flattened batch is released after upload
+					}
 				}
 			}
 			
@@ -382,6 +812,19 @@ namespace render::pass::world
 		world.debugTextures.clear();
 		release(world.staticInstancesSb);
 		release(world.lightmapTexArray);
+
+		releaseLevelTextures(displayedLevel);
+		displayedLevel.clear();
+	}
+
+	void clearTextureCache()
+	{
+		waitForPreload();
+		preloaded.reset();
+		textureCache.clear();
+		levelToTextures.clear();
+		textureCacheBytes = 0;
+		assets::clearAssetCache();
 	}
 
 	void printLoadResult(const LoadResult& loadResult)
@@ -399,7 +842,116 @@ namespace render::pass::world
 		}
 	}
 
-	LoadWorldResult loadZenLevel(D3d d3d, const string& levelStr)
+	void printCompactErrorStats(const CompactErrorStats& stats)
+	{
+		LOG(INFO) << "Level: Compact vertex format max errors - Position: " << (stats.posMax * 1000) << "mm, Normal: "
+			<< stats.normalAngleMaxDeg << "deg, Lightmap UV: " << stats.lightmapUvMax << ", Light Color: " << stats.colorMax;
+		if (stats.lightmapUvClamped > 0 || stats.colorClamped > 0) {
+			LOG(WARNING) << "Level: Compact vertex format clamped values - Lightmap UVs: " << stats.lightmapUvClamped
+				<< ", Light Colors: " << stats.colorClamped;
+		}
+	}
+
+	std::optional<RenderData> loadZenLevelData(const string& level, uint64_t assetCacheBudget)
+	{
+		std::scoped_lock lock(levelDataMutex);
+		assets::LoadDebugFlags debugFlags {};
+		assets::setAssetCacheBudget(assetCacheBudget);
+		assets::AssetCacheLevelScope assetLevelScope(level);
+
+		if (::util::endsWith(level, ".zen")) {
+			auto levelFileOpt = assets::getIfExists(level);
+			if (levelFileOpt.has_value()) {
+				RenderData data;
+				assets::loadZen(data, levelFileOpt.value(), debugFlags);
+				assets::releaseLoadData();
+				return data;
+			}
+			else {
+				LOG(WARNING) << "Failed to find level file '" << level << "'!";
+			}
+		}
+		else {
+			LOG(WARNING) << "Level file format not supported: " << level;
+		}
+		return std::nullopt;
+	}
+
+	// runs on preload thread, textures that were resident when preloading started are skipped
+	template <VERTEX_FEATURE F>
+	void preloadTextures(
+		const MeshData<F>& meshData, const std::unordered_set<TexId>& residentTexIds, unordered_map<TexId, assets::TexData>& target)
+	{
+		for (const auto& mat : meshData.materials) {
+			// remaining textures are decoded on demand when the level is actually loaded
+			if (assets::isLoadMemoryOverBudget()) {
+				LOG(INFO) << "Level: Memory over load budget, stopped preloading textures";
+				return;
+			}
+			TexId texId = mat.texBaseColor;
+			if (residentTexIds.contains(texId) || target.contains(texId)) {
+				continue;
+			}
+			std::string texName(::assets::getTexName(texId));
+			target.emplace(texId, assets::loadTextureDataOrDefault(texName, mat.colorSpace == ColorSpace::SRGB));
+		}
+	}
+
+	void printLoadMemoryPeak()
+	{
+		uint64_t peakMb = assets::getLoadMemoryPeak() / (1024 * 1024);
+		uint64_t budgetMb = assets::getLoadMemoryBudget() / (1024 * 1024);
+		if (peakMb > budgetMb) {
+			LOG(WARNING) << "Level: Peak memory exceeded load budget - Peak: " << peakMb << " MB, Budget: " << budgetMb << " MB";
+		}
+		else {
+			LOG(INFO) << "Level: Peak memory - Peak: " << peakMb << " MB, Budget: " << budgetMb << " MB";
+		}
+	}
+
+	void preloadZenLevel(D3d d3d, const string& levelStr, uint64_t assetCacheBudget)
+	{
+		string level = ::util::asciiToLower(levelStr);
+		if (level == displayedLevel || (preloaded.has_value() && preloaded->level == level)) {
+			return;
+		}
+		if (preloaded.has_value()) {
+			waitForPreload();
+			assets::releaseAssetCacheLevel(preloaded->level);
+			preloaded.reset();
+		}
+		// a preloaded level is kept in addition to the displayed one, which would likely exceed the budget even further
+		if (assets::isLoadMemoryOverBudget()) {
+			LOG(INFO) << "Level: Memory over load budget, skipped preloading level: " << level;
+			return;
+		}
+		LOG(INFO) << "Level: Preloading level in background: " << level;
+		assets::resetLoadMemoryPeak();
+
+		std::unordered_set<TexId> residentTexIds;
+		for (const auto& [texId, resident] : textureCache) {
+			if (resident.data.has_value()) {
+				residentTexIds.insert(texId);
+			}
+		}
+
+		// textures are only decoded into CPU memory here, so no D3D access is needed on the preload thread
+		preloaded = PreloadedLevel{
+			.level = level,
+			.result = std::async(std::launch::async, [level, assetCacheBudget, residentTexIds = std::move(residentTexIds)]() -> PreloadResult {
+				PreloadResult result;
+				result.data = loadZenLevelData(level, assetCacheBudget);
+				if (result.data.has_value()) {
+					preloadTextures(result.data->worldMesh, residentTexIds, result.textures);
+					preloadTextures(result.data->staticMeshes, residentTexIds, result.textures);
+					LOG(INFO) << "Level: Preloading finished: " << level;
+				}
+				return result;
+			}),
+		};
+	}
+
+	LoadWorldResult loadZenLevel(D3d d3d, const string& levelStr, VertexFormat vertexFormat, uint64_t assetCacheBudget)
 	{
 		auto samplerTotal = render::stats::TimeSampler();
 		samplerTotal.start();
@@ -411,30 +963,34 @@ namespace render::pass::world
 		LOG(INFO) << "    Loading data";
 		LOG(INFO) << "    #########################################";
 
-		assets::LoadDebugFlags debugFlags {};
-
-		bool levelDataFound = false;
-		RenderData data;
 		string level = ::util::asciiToLower(levelStr);
 
-		if (::util::endsWith(level, ".zen")) {
-			auto levelFileOpt = assets::getIfExists(level);
-			if (levelFileOpt.has_value()) {
-				auto levelFile = levelFileOpt.value();
-				assets::loadZen(data, levelFile, debugFlags);
-				levelDataFound = true;
-			}
-			else {
-				LOG(WARNING) << "Failed to find level file '" << level << "'!";
-			}
+		std::optional<RenderData> dataOpt;
+		unordered_map<TexId, assets::TexData> preloadedTextures;
+		if (preloaded.has_value() && preloaded->level == level) {
+			LOG(INFO) << "Level: Using preloaded level data";
+			PreloadResult result = preloaded->result.get();
+			dataOpt = std::move(result.data);
+			preloadedTextures = std::move(result.textures);
+			preloaded.reset();
 		}
 		else {
-			LOG(WARNING) << "Level file format not supported: " << level;
+			waitForPreload();// keep preloaded data, a concurrent preload would only block loading anyway
+			assets::resetLoadMemoryPeak();
+			dataOpt = loadZenLevelData(level, assetCacheBudget);
 		}
 
-		if (!levelDataFound) {
+		if (!dataOpt.has_value()) {
+			if (level != displayedLevel) {
+				assets::releaseAssetCacheLevel(level);
+			}
 			return { .loaded = false };
 		}
+		if (level != displayedLevel) {
+			// parsed visuals shared with the new level stay resident, others are evicted first once over budget
+			assets::releaseAssetCacheLevel(displayedLevel);
+		}
+		RenderData& data = dataOpt.value();
 
 		sampler.logMillisAndRestart("Level: Loaded all data");
 
@@ -444,7 +1000,35 @@ namespace render::pass::world
 		LOG(INFO) << "    #########################################";
 
 		clearZenLevel();
+		displayedLevel = level;
+		textureLevel = level;
+		textureCacheGeneration++;
+		mergePreloadedTextures(std::move(preloadedTextures));
 		world.isOutdoorLevel = data.isOutdoorLevel;
+
+		if (data.worldMeshLightmaps.size() > lightmapCountMax) {
+			::util::throwError(std::format("Level: At most {} lightmaps are supported, level has {}!",
+				lightmapCountMax, data.worldMeshLightmaps.size()));
+		}
+		if (vertexFormat == VertexFormat::COMPACT) {
+			if (!PACK_VERTEX_ATTRIBUTES) {
+				LOG(WARNING) << "Level: Compact vertex format requires packed vertex attributes, using default format!";
+				vertexFormat = VertexFormat::DEFAULT;
+			}
+			else if (data.worldMeshLightmaps.size() > lightmapCountMaxCompact) {
+				LOG(WARNING) << "Level: Compact vertex format supports at most " << lightmapCountMaxCompact
+					<< " lightmaps, using default format!";
+				vertexFormat = VertexFormat::DEFAULT;
+			}
+			else if (getMaxRangeCountPerCell(data.worldMesh) > clusterCountMaxCompact
+					|| getMaxRangeCountPerCell(data.staticMeshes) > clusterCountMaxCompact) {
+				LOG(WARNING) << "Level: Compact vertex format supports at most " << clusterCountMaxCompact
+					<< " vertex clusters per batch, using default format!";
+				vertexFormat = VertexFormat::DEFAULT;
+			}
+		}
+		world.vertexFormat = vertexFormat;
+		compactErrorStats = {};
 		{
 			LOG(INFO) << "Level: Lightmap count: " << data.worldMeshLightmaps.size();
 			vector<Texture*> lightmaps = assets::createTexturesFromLightmaps(d3d, std::move(data.worldMeshLightmaps));
@@ -475,25 +1059,31 @@ namespace render::pass::world
 
 		LoadResult loadResult;
 
-		loadResult = loadBatchVertexData(d3d, world.meshBatchesWorld, data.worldMesh, texturesPerBatch);
+		// CPU-side mesh data is released as soon as it has been uploaded to reduce peak memory usage
+		loadResult = loadBatchVertexData(d3d, world.meshBatchesWorld, data.worldMesh, texturesPerBatch, vertexFormat);
+		data.worldMesh = {};
 		sampler.logMillisAndRestart("Level: Uploaded world mesh");
 		printLoadResult(loadResult);
 
-		loadResult = loadBatchVertexData(d3d, world.meshBatchesObjects, data.staticMeshes, texturesPerBatch);
+		loadResult = loadBatchVertexData(d3d, world.meshBatchesObjects, data.staticMeshes, texturesPerBatch, vertexFormat);
+		data.staticMeshes = {};
 
 		ID3D11Buffer* staticInstancesBuf = nullptr;
 		d3d::createStructuredBuf(d3d, &staticInstancesBuf, data.staticInstances, BufferUsage::IMMUTABLE);
 		d3d::createStructuredSrv(d3d, &world.staticInstancesSb, staticInstancesBuf);
 		release(staticInstancesBuf);
+		data.staticInstances = {};
 
 		sampler.logMillisAndRestart("Level: Uploaded static instances");
 		printLoadResult(loadResult);
 
-		// since single textures have been copied to texture arrays, we can release them
-		for (auto& tex : textureCache) {
-			delete tex.second;
+		if (vertexFormat == VertexFormat::COMPACT) {
+			printCompactErrorStats(compactErrorStats);
 		}
-		textureCache.clear();
+
+		// texture data has been uploaded to texture arrays, only keep it resident for other levels if within budget
+		evictTexturesOverBudget();
+		printLoadMemoryPeak();
 
 		samplerTotal.logMillisAndRestart("Level complete");
 
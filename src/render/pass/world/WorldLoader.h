@@ -25,6 +25,7 @@ namespace render::pass::world
 
 	struct World {
 		bool isOutdoorLevel = true;
+		VertexFormat vertexFormat = VertexFormat::DEFAULT;// format of all vertex buffers of loaded level
 		MeshBatches meshBatchesWorld;
 		MeshBatches meshBatchesObjects;
 
@@ -35,5 +36,11 @@ namespace render::pass::world
 	};
 
 	void clearZenLevel();
-	LoadWorldResult loadZenLevel(D3d d3d, const std::string& level);
+	void clearTextureCache();
+	// Asset cache budget is applied by the thread that loads the level data. Parsed assets are referenced by the displayed
+	// level and released by reference when switching, so assets shared between levels stay resident within the budget.
+	LoadWorldResult loadZenLevel(D3d d3d, const std::string& level, VertexFormat vertexFormat, uint64_t assetCacheBudget);
+
+	// Loads level data and textures on a background thread, so that a later loadZenLevel call for the same level is fast.
+	void preloadZenLevel(D3d d3d, const std::string& level, uint64_t assetCacheBudget);
 }
\ No newline at end of file
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "render/Loader.h"
+#include "assets/AssetCache.h"
+
 namespace render::pass::world
 {
 	enum LodMode {
@@ -18,6 +21,10 @@ namespace render::pass::world
 		bool drawStaticObjects = true;
 		bool drawSky = true;
 
+		bool compactVertexFormat = false;// applied when the next level is loaded, see VertexFormat::COMPACT
+		int32_t loadMemoryBudgetMb = (int32_t) (assets::loadMemoryBudgetDefault / (1024 * 1024));// applied when loading or preloading
+		int32_t assetCacheBudgetMb = (int32_t) (assets::assetCacheBudgetDefault / (1024 * 1024));// applied when loading or preloading
+
 		bool chunkedRendering = true;
 
 		bool renderCloseFirst = true;
@@ -41,7 +48,7 @@ namespace render::pass::world
 
 		bool chunkFilterXEnabled = false;
 		bool chunkFilterYEnabled = false;
-		int16_t chunkFilterX = 0;
-		int16_t chunkFilterY = 0;
+		uint16_t chunkFilterX = 0;// same type as GridPos
+		uint16_t chunkFilterY = 0;
 	};
 }
\ No newline at end of file
@@ -51,6 +51,11 @@ namespace render::pass::world::gui
 					ImGui::Checkbox("Draw World", &worldSettings.drawWorld);
 					ImGui::Checkbox("Draw VOBs/MOBs", &worldSettings.drawStaticObjects);
 					ImGui::Checkbox("Draw Sky", &worldSettings.drawSky);
+					ImGui::Checkbox("Compact Vertices (on load)", &worldSettings.compactVertexFormat);
+					ImGui::SliderInt("##LoadMemoryBudget", &worldSettings.loadMemoryBudgetMb, 256, 16384, "%d MB Load Memory Budget",
+						ImGuiSliderFlags_Logarithmic);
+					ImGui::SliderInt("##AssetCacheBudget", &worldSettings.assetCacheBudgetMb, 16, 4096, "%d MB Asset Cache Budget",
+						ImGuiSliderFlags_Logarithmic);
 					ImGui::VerticalSpacing();
 					ImGui::Checkbox("Chunked Rendering", &worldSettings.chunkedRendering);
 
@@ -8,6 +8,7 @@ namespace viewer
 	const std::string ARG_NO_LOG = "--noLog";
 	const std::string ARG_RDP_COMPAT = "--rdp";
 	const std::string ARG_LEVEL = "--level";
+	const std::string ARG_PRELOAD_LEVEL = "--preloadLevel";
 	const std::string ARG_ASSET_DIR = "--assetDir";
 	const std::string ARG_VDF_DIR = "--vdfDir";
 
@@ -16,6 +17,7 @@ namespace viewer
 		{ util::asciiToLower(ARG_NO_LOG), false },
 		{ util::asciiToLower(ARG_RDP_COMPAT), false },
 		{ util::asciiToLower(ARG_LEVEL), true },
+		{ util::asciiToLower(ARG_PRELOAD_LEVEL), true },
 		{ util::asciiToLower(ARG_ASSET_DIR), true },
 		{ util::asciiToLower(ARG_VDF_DIR), true },
 	};
@@ -25,6 +27,7 @@ namespace viewer
 		std::optional<std::filesystem::path> vdfFilesRoot;
 		std::optional<std::filesystem::path> assetFilesRoot;
 		std::optional<std::string> level;
+		std::optional<std::string> preloadLevel;
 	};
 
 	std::unordered_map<std::string, std::string> parseOptions(const std::vector<std::string> args, const std::unordered_map<std::string, bool> options);
@@ -21,6 +21,13 @@ namespace viewer
 	}
 	settings;
 
+	struct Levels {
+		std::optional<std::string> current;
+		std::optional<std::string> other;// preloaded in background, can be switched to
+		bool switchRequested = false;// switch is deferred to start of next frame, so it never happens while rendering a frame
+	}
+	levels;
+
 	struct FrameTimes {
 		render::stats::TimeSampler full;
 		render::stats::TimeSampler render;
@@ -126,17 +133,40 @@ namespace viewer
 			LOG(WARNING) << "Available level files:";
 			assets::printFoundZens();
 		}
+		levels.current = args.level;
+		levels.other = args.preloadLevel;
+		if (levels.other.has_value()) {
+			render::preloadLevel(levels.other.value());
+			render::gui::addSettings("Level", {
+				[]() -> void {
+					std::string label = "Switch to " + levels.other.value_or("");
+					if (ImGui::Button(label.c_str())) {
+						levels.switchRequested = true;
+					}
+				}
+			});
+		}
 
 		LOG(INFO);
 		LOG(INFO) << "#############################################";
 		sampler.logMillisAndRestart("ZenRen initialized total");
 		LOG(INFO) << "#############################################";
 
-		assets::cleanAssetSources();
-
 		frameTimes.full.start();
 	}
 
+	void switchLevelIfRequested()
+	{
+		if (levels.switchRequested) {
+			levels.switchRequested = false;
+			std::swap(levels.current, levels.other);
+			render::loadLevel(levels.current);
+			if (levels.other.has_value()) {
+				render::preloadLevel(levels.other.value());
+			}
+		}
+	}
+
 	void renderAndSleep()
 	{
 		// This render loop's latency is optimal as long as full frame time fits inside frame limit (limiter is adding sleep time).
@@ -144,6 +174,8 @@ namespace viewer
 		// See: https://gamedev.stackexchange.com/a/109400
 		// TODO: Visualize tradeoff. Maybe have both as an option (or select automatically if FPS increase makes up for increased latency)
 
+		switchLevelIfRequested();
+
 		// START RENDER
 		float deltaTime = (float) frameTimes.full.sampleRestart() / 1000000;
 		frameTimes.render.start(frameTimes.full.last);
@@ -193,6 +225,7 @@ namespace viewer
 	void cleanup()
 	{
 		render::cleanD3D();
+		assets::cleanAssetSources();
 		cleanupMicrosleep();
 		disablePreciseTimerResolution();
 	}
@@ -0,0 +1,156 @@
+#include "stdafx.h"
+#include "render/basic/VertexPacker.h"
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+// Compares batch packing (AVX2 kernels) against scalar packing on a fixed sweep of edge cases.
+// Returns non-zero if any packed value differs.
+
+using namespace render;
+
+// must match quantization in VertexPacker.cpp, only used to place edge cases on rounding boundaries
+constexpr uint32_t normalComponentMask = (1 << 14) - 1;
+constexpr uint32_t lightColorBits = 16;
+constexpr uint32_t uvExponentMask = (1 << 4) - 1;
+constexpr uint32_t uvScale = 1 << 13;
+
+uint32_t mismatchCount = 0;
+
+void check(const char* name, size_t index, uint32_t expected, uint32_t actual)
+{
+	if (expected != actual) {
+		if (mismatchCount < 20) {
+			std::cerr << "Batch packing mismatch: " << name << " at index " << index
+				<< " (expected " << expected << ", got " << actual << ")" << std::endl;
+		}
+		mismatchCount++;
+	}
+}
+
+// Values at which scalar and batch packing are most likely to differ: signed zero, clamping, UV exponent overflow and
+// values exactly at or next to .5 rounding boundaries of every quantization.
+std::vector<float> createPackingEdgeCases()
+{
+	std::vector<float> values = {
+		0.f, -0.f, 1e-8f, -1e-8f, 0.5f, -0.5f, 1.f, -1.f, 1.5f, -1.5f, 2.f, -2.f, 100.f, -100.f,
+		32767.f, 32768.f, -32768.f, 40000.f, -40000.f, 1e6f, -1e6f,
+	};
+	auto addWithNeighbours = [&](float value) -> void {
+		values.push_back(value);
+		values.push_back(std::nextafter(value, -INFINITY));
+		values.push_back(std::nextafter(value, INFINITY));
+		values.push_back(-value);
+	};
+	addWithNeighbours(1.f);
+	for (uint32_t quant : { 0u, 1u, 2u, 4095u, 8191u, normalComponentMask - 1 }) {
+		// normal quantization
+		addWithNeighbours((quant + 0.5f) / normalComponentMask);
+	}
+	for (uint32_t quant : { 1u, 2u, 32767u, 65535u }) {
+		// light color quantization
+		addWithNeighbours((quant - 0.5f) / ((1 << lightColorBits) - 1));
+	}
+	for (uint32_t exponent = 0; exponent <= uvExponentMask; exponent++) {
+		// UV mantissa rounding for every exponent
+		float factor = (float)(1 << exponent) / uvScale;
+		for (uint32_t quant : { 0u, 1u, 100u, uvScale / 2 - 1, uvScale - 1 }) {
+			addWithNeighbours((quant + 0.5f) * factor);
+		}
+	}
+	return values;
+}
+
+// all pairs of given values as two streams, third stream is a different combination of the same values
+std::array<std::vector<float>, 3> createPackingEdgeCasePairs(const std::vector<float>& values)
+{
+	const size_t valueCount = values.size();
+	std::array<std::vector<float>, 3> result;
+	for (auto& stream : result) {
+		stream.reserve(valueCount * valueCount);
+	}
+	for (size_t i = 0; i < valueCount; i++) {
+		for (size_t j = 0; j < valueCount; j++) {
+			result[0].push_back(values[i]);
+			result[1].push_back(values[j]);
+			result[2].push_back(values[(i + j) % valueCount]);
+		}
+	}
+	return result;
+}
+
+int main()
+{
+	// logging is not initialized, so UV overflow warnings (expected for some edge cases) are dropped
+	const std::vector<float> values = createPackingEdgeCases();
+	const size_t valueCount = values.size();
+	size_t checkedCount = 0;
+
+	// normals: scalar float to integer conversion is only defined for components that are roughly normalized
+	std::vector<float> normalValues;
+	std::copy_if(values.begin(), values.end(), std::back_inserter(normalValues), [](float value) -> bool {
+		return std::abs(value) <= 2.f;
+	});
+	{
+		const auto [x, y, z] = createPackingEdgeCasePairs(normalValues);
+		std::vector<uint32_t> packed(x.size());
+		packNormals(x, y, z, packed);
+		for (size_t i = 0; i < packed.size(); i++) {
+			check("normal", i, packNormal({ x[i], y[i], z[i] }), packed[i]);
+		}
+		checkedCount += packed.size();
+	}
+	// UVs: all pairs, including UVs that overflow the exponent
+	{
+		const auto [u, v, _] = createPackingEdgeCasePairs(values);
+		std::vector<uint32_t> packed(u.size());
+		packUvs(u, v, packed);
+		for (size_t i = 0; i < packed.size(); i++) {
+			check("uv", i, packUv({ u[i], v[i] }), packed[i]);
+		}
+		checkedCount += packed.size();
+	}
+
+	// lights: every type in every lane position, each with all edge cases for colors and lightmap UVs
+	const std::array types = {
+		VertexLightType::WORLD_COLOR, VertexLightType::WORLD_LIGHTMAP, VertexLightType::OBJECT_COLOR, VertexLightType::OBJECT_DECAL,
+	};
+	const std::array lightmapIndices = { 0.f, 1.f, 2.4999998f, 2.5f, (float)(lightmapCountMax - 1) };
+	const std::array instanceIds = { 0u, 1u, instanceIdCountMax - 1 };
+
+	const size_t lightCount = valueCount * types.size() * 3;
+	std::vector<VertexLightType> type(lightCount);
+	std::vector<float> colR(lightCount), colG(lightCount), colB(lightCount);
+	std::vector<float> lightmapU(lightCount), lightmapV(lightCount), lightmapI(lightCount);
+	std::vector<uint32_t> instanceId(lightCount);
+	for (size_t i = 0; i < lightCount; i++) {
+		size_t valueIndex = i / (types.size() * 3);
+		type[i] = types[(i + valueIndex) % types.size()];
+		colR[i] = values[valueIndex];
+		colG[i] = values[(valueIndex + 1) % valueCount];
+		colB[i] = values[(valueIndex + i) % valueCount];
+		lightmapU[i] = values[(valueIndex + 2 * i) % valueCount];
+		lightmapV[i] = values[valueIndex];
+		lightmapI[i] = lightmapIndices[i % lightmapIndices.size()];
+		instanceId[i] = type[i] == VertexLightType::OBJECT_COLOR ? instanceIds[i % instanceIds.size()] : instanceIdNone;
+	}
+	const LightStreams lights = { type, colR, colG, colB, lightmapU, lightmapV, lightmapI, instanceId };
+	std::vector<uint32_t> packedFirst(lightCount);
+	std::vector<uint32_t> packedSecond(lightCount);
+	packLights(lights, packedFirst, packedSecond);
+	for (size_t i = 0; i < lightCount; i++) {
+		auto [first, second] = packLight(
+			type[i], Color(colR[i], colG[i], colB[i], 1.f), { .u = lightmapU[i], .v = lightmapV[i], .i = lightmapI[i] }, instanceId[i]);
+		check("light (first)", i, first, packedFirst[i]);
+		check("light (second)", i, second, packedSecond[i]);
+	}
+	checkedCount += lightCount;
+
+	if (mismatchCount > 0) {
+		std::cerr << "Batch packing: " << mismatchCount << " mismatches in " << checkedCount << " edge cases" << std::endl;
+		return 1;
+	}
+	std::cout << "Batch packing matches scalar packing for " << checkedCount << " edge cases" << std::endl;
+	return 0;
+}